@@ -0,0 +1,314 @@
+/*
+ Copyright (c) 2019 Leo McCormack
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+/*
+ * Hardware-counter comparison of indexing through md_malloc's pointer tables
+ * (malloc2d..malloc6d) against flat buffers indexed by hand.
+ *
+ * For ranks 2..6, every element is read in row-major order (last index
+ * fastest), column-major order (first index fastest), and a random order
+ * (the same random permutation for both layouts, with the indices loaded from
+ * precomputed tables in both cases). Cycles, instructions, L1D/LLC misses,
+ * dTLB misses and branch misses (see md_perf.h) are reported per element;
+ * where counters are not available, only the time is reported.
+ *
+ * usage: md_access [--elems N] [--reps N] [--json FILE]
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+# define _GNU_SOURCE /* for the md_perf.h counters under -std=c99 */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define MD_MALLOC_ENABLE
+#include "../md_malloc.h"
+#define MD_PERF_ENABLE
+#include "../md_perf.h"
+
+#define ACCESS_MAX_RANK 6
+typedef unsigned int access_type; /* integer, so that the sums do not serialise on FP add latency */
+
+enum { PATTERN_ROW_MAJOR, PATTERN_COLUMN_MAJOR, PATTERN_RANDOM, NUM_PATTERNS };
+enum { LAYOUT_MD, LAYOUT_FLAT, NUM_LAYOUTS };
+static const char* pattern_names[NUM_PATTERNS] = { "row_major", "column_major", "random" };
+static const char* layout_names[NUM_LAYOUTS] = { "md_malloc", "flat" };
+
+static volatile size_t access_sink; /* keeps the loops from being optimised away */
+
+/* Loop nests over all elements, in row-major and column-major order */
+#define ROW_LOOP2 for(i=0; i<d0; i++) for(j=0; j<d1; j++)
+#define ROW_LOOP3 ROW_LOOP2 for(k=0; k<d2; k++)
+#define ROW_LOOP4 ROW_LOOP3 for(l=0; l<d3; l++)
+#define ROW_LOOP5 ROW_LOOP4 for(p=0; p<d4; p++)
+#define ROW_LOOP6 ROW_LOOP5 for(q=0; q<d5; q++)
+#define COL_LOOP2 for(j=0; j<d1; j++) for(i=0; i<d0; i++)
+#define COL_LOOP3 for(k=0; k<d2; k++) COL_LOOP2
+#define COL_LOOP4 for(l=0; l<d3; l++) COL_LOOP3
+#define COL_LOOP5 for(p=0; p<d4; p++) COL_LOOP4
+#define COL_LOOP6 for(q=0; q<d5; q++) COL_LOOP5
+
+/* Elements [i][j].. of the md arrays, and the flat buffer */
+#define MD_AT2 a2[i][j]
+#define MD_AT3 a3[i][j][k]
+#define MD_AT4 a4[i][j][k][l]
+#define MD_AT5 a5[i][j][k][l][p]
+#define MD_AT6 a6[i][j][k][l][p][q]
+#define FLAT_AT2 f[i*d1 + j]
+#define FLAT_AT3 f[(i*d1 + j)*d2 + k]
+#define FLAT_AT4 f[((i*d1 + j)*d2 + k)*d3 + l]
+#define FLAT_AT5 f[(((i*d1 + j)*d2 + k)*d3 + l)*d4 + p]
+#define FLAT_AT6 f[((((i*d1 + j)*d2 + k)*d3 + l)*d4 + p)*d5 + q]
+
+/* The m'th random index tuple */
+#define RAND_IDX2 i = idx[m]; j = idx[n+m];
+#define RAND_IDX3 RAND_IDX2 k = idx[2*n+m];
+#define RAND_IDX4 RAND_IDX3 l = idx[3*n+m];
+#define RAND_IDX5 RAND_IDX4 p = idx[4*n+m];
+#define RAND_IDX6 RAND_IDX5 q = idx[5*n+m];
+
+#define ACCESS_CASES(R, AT) \
+    case R*NUM_PATTERNS + PATTERN_ROW_MAJOR:    ROW_LOOP##R sum += AT##R; break; \
+    case R*NUM_PATTERNS + PATTERN_COLUMN_MAJOR: COL_LOOP##R sum += AT##R; break; \
+    case R*NUM_PATTERNS + PATTERN_RANDOM:       for(m=0; m<n; m++){ RAND_IDX##R sum += AT##R; } break;
+
+/* Reads every element of "ptr" (an md array if "layout" is LAYOUT_MD, otherwise
+ * a flat buffer) in the given order, and returns their sum */
+static size_t access_run(int layout, int pattern, size_t rank, const size_t* d,
+                         void* ptr, const unsigned int* idx, size_t n)
+{
+    size_t i, j, k, l, p, q, m, sum;
+    const size_t d0 = d[0], d1 = d[1], d2 = d[2], d3 = d[3], d4 = d[4], d5 = d[5];
+    access_type** a2 = (access_type**)ptr;
+    access_type*** a3 = (access_type***)ptr;
+    access_type**** a4 = (access_type****)ptr;
+    access_type***** a5 = (access_type*****)ptr;
+    access_type****** a6 = (access_type******)ptr;
+    access_type* f = (access_type*)ptr;
+    (void)d2; (void)d3; (void)d4; (void)d5;
+    sum = 0;
+    if(layout==LAYOUT_MD){
+        switch(rank*NUM_PATTERNS + pattern){
+            ACCESS_CASES(2, MD_AT)
+            ACCESS_CASES(3, MD_AT)
+            ACCESS_CASES(4, MD_AT)
+            ACCESS_CASES(5, MD_AT)
+            ACCESS_CASES(6, MD_AT)
+        }
+    }
+    else{
+        switch(rank*NUM_PATTERNS + pattern){
+            ACCESS_CASES(2, FLAT_AT)
+            ACCESS_CASES(3, FLAT_AT)
+            ACCESS_CASES(4, FLAT_AT)
+            ACCESS_CASES(5, FLAT_AT)
+            ACCESS_CASES(6, FLAT_AT)
+        }
+    }
+    return sum;
+}
+
+/* Splits "elems" into "rank" roughly equal dimensions (unused ones are 1) */
+static void access_shape(size_t elems, size_t rank, size_t* dims)
+{
+    size_t l, inner, base;
+    base = (size_t)floor(pow((double)elems, 1.0/(double)rank) + 1.0e-9);
+    if(base<1)
+        base = 1;
+    for(l=1, inner=1; l<rank; l++){
+        dims[l] = base;
+        inner *= base;
+    }
+    dims[0] = elems/inner < 1 ? 1 : elems/inner;
+    for(l=rank; l<ACCESS_MAX_RANK; l++)
+        dims[l] = 1;
+}
+
+/* Fills "idx" with the (per-dimension) indices of a random permutation of the
+ * "n" elements; idx[l*n+m] is the index of dimension "l" of the m'th element */
+static void access_random_order(size_t rank, const size_t* dims, size_t n, unsigned int* idx)
+{
+    size_t m, r, l, lin, tmp;
+    size_t* perm;
+    perm = (size_t*)malloc(n*sizeof(size_t));
+    for(m=0; m<n; m++)
+        perm[m] = m;
+    srand(1);
+    for(m=n-1; m>0; m--){
+        r = ((size_t)rand()*((size_t)RAND_MAX+1) + (size_t)rand()) % (m+1);
+        tmp = perm[m]; perm[m] = perm[r]; perm[r] = tmp;
+    }
+    for(m=0; m<n; m++){
+        lin = perm[m];
+        for(l=rank; l-->0;){
+            idx[l*n+m] = (unsigned int)(lin % dims[l]);
+            lin /= dims[l];
+        }
+    }
+    free(perm);
+}
+
+static int access_compare(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* Median of "n" samples (sorted in place) */
+static double access_median(double* samples, int n)
+{
+    qsort(samples, n, sizeof(double), access_compare);
+    return n%2 ? samples[n/2] : 0.5*(samples[n/2-1] + samples[n/2]);
+}
+
+int main(int argc, const char * argv[])
+{
+    int a, r, c, pattern, layout, reps, first, ncounters;
+    size_t l, rank, elems, n, sum, expected, dims[ACCESS_MAX_RANK];
+    const char* json_path;
+    FILE* json;
+    md_perf perf;
+    double elapsed, values[MD_PERF_NUM_COUNTERS];
+    double* samples[MD_PERF_NUM_COUNTERS+1];
+    unsigned int* idx;
+    void* ptr;
+    char label[64];
+
+    /* options */
+    elems = 4194304;
+    reps = 5;
+    json_path = NULL;
+    for(a=1; a<argc; a++){
+        if(strcmp(argv[a], "--elems")==0 && a+1<argc)
+            elems = (size_t)strtoul(argv[++a], NULL, 10);
+        else if(strcmp(argv[a], "--reps")==0 && a+1<argc)
+            reps = atoi(argv[++a]);
+        else if(strcmp(argv[a], "--json")==0 && a+1<argc)
+            json_path = argv[++a];
+        else{
+            fprintf(stderr, "usage: md_access [--elems N] [--reps N] [--json FILE]\n");
+            return EXIT_FAILURE;
+        }
+    }
+    if(elems<1 || reps<1){
+        fprintf(stderr, "usage: md_access [--elems N] [--reps N] [--json FILE]\n");
+        return EXIT_FAILURE;
+    }
+    json = NULL;
+    if(json_path!=NULL){
+        json = strcmp(json_path, "-")==0 ? stdout : fopen(json_path, "w");
+        if(json==NULL){
+            fprintf(stderr, "md_access: could not open \"%s\"\n", json_path);
+            return EXIT_FAILURE;
+        }
+    }
+#define ACCESS_LOG (json==stdout ? stderr : stdout)
+
+    ncounters = md_perf_open(&perf);
+    if(ncounters==0)
+        fprintf(ACCESS_LOG, "(hardware counters are not available; reporting time only)\n");
+    fprintf(ACCESS_LOG, "%zu elements per array; median of %d runs, per element\n\n", elems, reps);
+    if(json!=NULL)
+        fprintf(json, "{\n  \"benchmark\": \"md_access\",\n  \"elements\": %zu,\n  \"data_size\": %zu,\n"
+                      "  \"reps\": %d,\n  \"results\": [", elems, sizeof(access_type), reps);
+    for(c=0; c<=MD_PERF_NUM_COUNTERS; c++)
+        samples[c] = (double*)malloc(reps*sizeof(double));
+    idx = (unsigned int*)malloc(ACCESS_MAX_RANK*elems*sizeof(unsigned int));
+
+    first = 1;
+    for(rank=2; rank<=ACCESS_MAX_RANK; rank++){
+        access_shape(elems, rank, dims);
+        for(l=0, n=1; l<rank; l++)
+            n *= dims[l];
+        access_random_order(rank, dims, n, idx);
+        for(pattern=0; pattern<NUM_PATTERNS; pattern++){
+            for(layout=0; layout<NUM_LAYOUTS; layout++){
+                /* the same data in both layouts (element m = m) */
+                ptr = layout==LAYOUT_MD ? mallocNd(rank, dims, sizeof(access_type)) : malloc(n*sizeof(access_type));
+                if(ptr==NULL){
+                    fprintf(stderr, "md_access: out of memory\n");
+                    return EXIT_FAILURE;
+                }
+                {
+                    access_type* data = layout==LAYOUT_MD ? (access_type*)flattenNd(ptr, rank) : (access_type*)ptr;
+                    for(l=0, expected=0; l<n; l++){
+                        data[l] = (access_type)l;
+                        expected += (access_type)l;
+                    }
+                }
+
+                /* one warm-up run, then the measured ones */
+                access_sink += access_run(layout, pattern, rank, dims, ptr, idx, n);
+                for(r=0; r<reps; r++){
+                    md_perf_start(&perf);
+                    sum = access_run(layout, pattern, rank, dims, ptr, idx, n);
+                    md_perf_stop(&perf);
+                    if(sum!=expected){
+                        fprintf(stderr, "md_access: wrong sum (%s, %s, rank %zu)\n",
+                                layout_names[layout], pattern_names[pattern], rank);
+                        return EXIT_FAILURE;
+                    }
+                    for(c=0; c<MD_PERF_NUM_COUNTERS; c++)
+                        samples[c][r] = perf.values[c];
+                    samples[MD_PERF_NUM_COUNTERS][r] = perf.elapsed_ns;
+                }
+                free(ptr);
+
+                /* report the medians */
+                for(c=0; c<MD_PERF_NUM_COUNTERS; c++)
+                    perf.values[c] = values[c] = access_median(samples[c], reps);
+                perf.elapsed_ns = elapsed = access_median(samples[MD_PERF_NUM_COUNTERS], reps);
+                sprintf(label, "%zu-D %s %s", rank, pattern_names[pattern], layout_names[layout]);
+                md_perf_print(ACCESS_LOG, &perf, label, n);
+                if(json!=NULL){
+                    fprintf(json, "%s\n    { \"rank\": %zu, \"pattern\": \"%s\", \"layout\": \"%s\", \"dims\": [",
+                            first ? "" : ",", rank, pattern_names[pattern], layout_names[layout]);
+                    for(l=0; l<rank; l++)
+                        fprintf(json, l==0 ? "%zu" : ", %zu", dims[l]);
+                    fprintf(json, "], \"elapsed_ns\": %.0f,\n      \"counters\": {", elapsed);
+                    for(c=0; c<MD_PERF_NUM_COUNTERS; c++){
+                        if(md_perf_available(&perf, c))
+                            fprintf(json, "%s \"%s\": %.0f", c==0 ? "" : ",", md_perf_name(c), values[c]);
+                        else
+                            fprintf(json, "%s \"%s\": null", c==0 ? "" : ",", md_perf_name(c));
+                    }
+                    fprintf(json, " } }");
+                    first = 0;
+                }
+            }
+        }
+    }
+    if(json!=NULL){
+        fprintf(json, "\n  ]\n}\n");
+        if(json!=stdout)
+            fclose(json);
+    }
+#undef ACCESS_LOG
+
+    md_perf_close(&perf);
+    for(c=0; c<=MD_PERF_NUM_COUNTERS; c++)
+        free(samples[c]);
+    free(idx);
+    return 0;
+}
@@ -0,0 +1,427 @@
+/*
+ Copyright (c) 2019 Leo McCormack
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+/*
+ * Allocation/indexing benchmarks for md_malloc, against mangled (a[i*B+j])
+ * and C99-style (float (*a)[B]) arrays of the same shapes.
+ *
+ * For ranks 1..6 and malloc/calloc/realloc, each run is split into phases,
+ * which are timed separately (wall-clock):
+ *   alloc   the allocation call itself (minus "tables")
+ *   tables  building the pointer tables (md_malloc only; via md_stats)
+ *   fill    memset of the whole data block (incl. first-touch page faults)
+ *   access  reading every element through the array's own indexing
+ *   free    the free() call
+ * Each configuration is run "warmup" times untimed, and then "reps" times;
+ * the median and 99th percentile of each phase are reported, and may also be
+ * written out as JSON (--json), for tracking regressions between releases.
+ *
+ * usage: md_bench [--elems N] [--reps N] [--warmup N] [--json FILE]
+ */
+
+#if defined(__STRICT_ANSI__) && !defined(_POSIX_C_SOURCE) && !defined(_WIN32)
+# define _POSIX_C_SOURCE 199309L /* for clock_gettime() under -std=c99 */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#define MD_MALLOC_ENABLE
+#define MD_MALLOC_ENABLE_STATS  /* for timing the pointer-table construction separately */
+#include "../md_malloc.h"
+
+#if defined(__STDC_VERSION__) && __STDC_VERSION__>=199901L && !defined(__STDC_NO_VLA__) && !defined(_MSC_VER)
+# define BENCH_HAVE_VLA  /* C99-style baseline */
+#endif
+
+#define BENCH_MAX_RANK 6
+typedef float bench_type;
+
+enum { PHASE_ALLOC, PHASE_TABLES, PHASE_FILL, PHASE_ACCESS, PHASE_FREE, NUM_PHASES };
+enum { LAYOUT_MD, LAYOUT_MANGLED, LAYOUT_C99, NUM_LAYOUTS };
+static const char* phase_names[NUM_PHASES] = { "alloc", "tables", "fill", "access", "free" };
+static const char* layout_names[NUM_LAYOUTS] = { "md_malloc", "mangled", "c99" };
+static const char* mode_names[3] = { "malloc", "calloc", "realloc" }; /* indexed by MD_STATS_MALLOC.. */
+
+static volatile double bench_sink; /* keeps the access loops from being optimised away */
+
+/* Wall-clock time in nanoseconds */
+static double bench_time_ns(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER f, t;
+    QueryPerformanceFrequency(&f);
+    QueryPerformanceCounter(&t);
+    return (double)t.QuadPart*1.0e9/(double)f.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec*1.0e9 + (double)ts.tv_nsec;
+#elif defined(TIME_UTC)
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec*1.0e9 + (double)ts.tv_nsec;
+#else
+# error "no wall-clock timer available"
+#endif
+}
+
+static int bench_compare(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* Median and 99th percentile (nearest rank) of "n" samples (sorted in place) */
+static void bench_percentiles(double* samples, int n, double* median, double* p99)
+{
+    int rank99;
+    qsort(samples, n, sizeof(double), bench_compare);
+    *median = n%2 ? samples[n/2] : 0.5*(samples[n/2-1] + samples[n/2]);
+    rank99 = (int)ceil(0.99*n);
+    *p99 = samples[rank99 < 1 ? 0 : rank99-1];
+}
+
+/* Splits "elems" into "rank" roughly equal dimensions (the first taking up any slack;
+ * unused dimensions are set to 1) */
+static void bench_shape(size_t elems, size_t rank, size_t* dims)
+{
+    size_t l, inner, base;
+    base = (size_t)floor(pow((double)elems, 1.0/(double)rank) + 1.0e-9);
+    if(base<1)
+        base = 1;
+    for(l=1, inner=1; l<rank; l++){
+        dims[l] = base;
+        inner *= base;
+    }
+    dims[0] = elems/inner < 1 ? 1 : elems/inner;
+    for(l=rank; l<BENCH_MAX_RANK; l++)
+        dims[l] = 1;
+}
+
+/* Reads every element through md_malloc's pointer tables (the extents are
+ * copied into locals in all three access functions, so that they may be kept
+ * in registers) */
+static void bench_access_md(void* ptr, size_t rank, const size_t* d, bench_type* acc)
+{
+    size_t i, j, k, l, p, q;
+    const size_t d0 = d[0], d1 = d[1], d2 = d[2], d3 = d[3], d4 = d[4], d5 = d[5];
+    switch(rank){
+        case 1: { bench_type* a = (bench_type*)ptr;
+            for(i=0; i<d0; i++)
+                acc[i] += a[i];
+        } break;
+        case 2: { bench_type** a = (bench_type**)ptr;
+            for(i=0; i<d0; i++) for(j=0; j<d1; j++)
+                acc[j] += a[i][j];
+        } break;
+        case 3: { bench_type*** a = (bench_type***)ptr;
+            for(i=0; i<d0; i++) for(j=0; j<d1; j++) for(k=0; k<d2; k++)
+                acc[k] += a[i][j][k];
+        } break;
+        case 4: { bench_type**** a = (bench_type****)ptr;
+            for(i=0; i<d0; i++) for(j=0; j<d1; j++) for(k=0; k<d2; k++) for(l=0; l<d3; l++)
+                acc[l] += a[i][j][k][l];
+        } break;
+        case 5: { bench_type***** a = (bench_type*****)ptr;
+            for(i=0; i<d0; i++) for(j=0; j<d1; j++) for(k=0; k<d2; k++) for(l=0; l<d3; l++)
+                for(p=0; p<d4; p++)
+                    acc[p] += a[i][j][k][l][p];
+        } break;
+        case 6: { bench_type****** a = (bench_type******)ptr;
+            for(i=0; i<d0; i++) for(j=0; j<d1; j++) for(k=0; k<d2; k++) for(l=0; l<d3; l++)
+                for(p=0; p<d4; p++) for(q=0; q<d5; q++)
+                    acc[q] += a[i][j][k][l][p][q];
+        } break;
+    }
+}
+
+/* Reads every element of a mangled array (indices computed by hand) */
+static void bench_access_mangled(bench_type* a, size_t rank, const size_t* d, bench_type* acc)
+{
+    size_t i, j, k, l, p, q;
+    const size_t d0 = d[0], d1 = d[1], d2 = d[2], d3 = d[3], d4 = d[4], d5 = d[5];
+    switch(rank){
+        case 1:
+            for(i=0; i<d0; i++)
+                acc[i] += a[i];
+            break;
+        case 2:
+            for(i=0; i<d0; i++) for(j=0; j<d1; j++)
+                acc[j] += a[i*d1 + j];
+            break;
+        case 3:
+            for(i=0; i<d0; i++) for(j=0; j<d1; j++) for(k=0; k<d2; k++)
+                acc[k] += a[i*d1*d2 + j*d2 + k];
+            break;
+        case 4:
+            for(i=0; i<d0; i++) for(j=0; j<d1; j++) for(k=0; k<d2; k++) for(l=0; l<d3; l++)
+                acc[l] += a[i*d1*d2*d3 + j*d2*d3 + k*d3 + l];
+            break;
+        case 5:
+            for(i=0; i<d0; i++) for(j=0; j<d1; j++) for(k=0; k<d2; k++) for(l=0; l<d3; l++)
+                for(p=0; p<d4; p++)
+                    acc[p] += a[i*d1*d2*d3*d4 + j*d2*d3*d4 + k*d3*d4 + l*d4 + p];
+            break;
+        case 6:
+            for(i=0; i<d0; i++) for(j=0; j<d1; j++) for(k=0; k<d2; k++) for(l=0; l<d3; l++)
+                for(p=0; p<d4; p++) for(q=0; q<d5; q++)
+                    acc[q] += a[i*d1*d2*d3*d4*d5 + j*d2*d3*d4*d5 + k*d3*d4*d5 +
+                                l*d4*d5 + p*d5 + q];
+            break;
+    }
+}
+
+#ifdef BENCH_HAVE_VLA
+/* Reads every element of a C99-style array (pointer to variably modified rows) */
+static void bench_access_c99(void* ptr, size_t rank, const size_t* d, bench_type* acc)
+{
+    size_t i, j, k, l, p, q;
+    const size_t d0 = d[0], d1 = d[1], d2 = d[2], d3 = d[3], d4 = d[4], d5 = d[5];
+    switch(rank){
+        case 1: { bench_type* a = ptr;
+            for(i=0; i<d0; i++)
+                acc[i] += a[i];
+        } break;
+        case 2: { bench_type (*a)[d1] = ptr;
+            for(i=0; i<d0; i++) for(j=0; j<d1; j++)
+                acc[j] += a[i][j];
+        } break;
+        case 3: { bench_type (*a)[d1][d2] = ptr;
+            for(i=0; i<d0; i++) for(j=0; j<d1; j++) for(k=0; k<d2; k++)
+                acc[k] += a[i][j][k];
+        } break;
+        case 4: { bench_type (*a)[d1][d2][d3] = ptr;
+            for(i=0; i<d0; i++) for(j=0; j<d1; j++) for(k=0; k<d2; k++) for(l=0; l<d3; l++)
+                acc[l] += a[i][j][k][l];
+        } break;
+        case 5: { bench_type (*a)[d1][d2][d3][d4] = ptr;
+            for(i=0; i<d0; i++) for(j=0; j<d1; j++) for(k=0; k<d2; k++) for(l=0; l<d3; l++)
+                for(p=0; p<d4; p++)
+                    acc[p] += a[i][j][k][l][p];
+        } break;
+        case 6: { bench_type (*a)[d1][d2][d3][d4][d5] = ptr;
+            for(i=0; i<d0; i++) for(j=0; j<d1; j++) for(k=0; k<d2; k++) for(l=0; l<d3; l++)
+                for(p=0; p<d4; p++) for(q=0; q<d5; q++)
+                    acc[q] += a[i][j][k][l][p][q];
+        } break;
+    }
+}
+#endif
+
+/* One timed run of a configuration; "times" receives the duration of each phase */
+static void bench_run(int layout, int mode, size_t rank, const size_t* dims, size_t n,
+                      bench_type* acc, double* times)
+{
+    size_t l, half_dims[BENCH_MAX_RANK];
+    void* ptr;
+    void* old;
+    bench_type* data;
+    md_stats before, after;
+    double t0, t1;
+
+    /* realloc runs grow an array of half the first dimension (allocated untimed) */
+    old = NULL;
+    if(mode==MD_STATS_REALLOC){
+        for(l=0; l<rank; l++)
+            half_dims[l] = dims[l];
+        half_dims[0] = (dims[0]+1)/2;
+        old = layout==LAYOUT_MD ? mallocNd(rank, half_dims, sizeof(bench_type)) :
+                                  malloc((n/dims[0])*half_dims[0]*sizeof(bench_type));
+    }
+
+    /* alloc + tables */
+    md_stats_snapshot(&before);
+    t0 = bench_time_ns();
+    if(layout==LAYOUT_MD){
+        switch(mode){
+            case MD_STATS_CALLOC:  ptr = callocNd(rank, dims, sizeof(bench_type)); break;
+            case MD_STATS_REALLOC: ptr = reallocNd(old, rank, dims, sizeof(bench_type)); break;
+            default:               ptr = mallocNd(rank, dims, sizeof(bench_type)); break;
+        }
+    }
+    else{
+        switch(mode){
+            case MD_STATS_CALLOC:  ptr = calloc(n, sizeof(bench_type)); break;
+            case MD_STATS_REALLOC: ptr = realloc(old, n*sizeof(bench_type)); break;
+            default:               ptr = malloc(n*sizeof(bench_type)); break;
+        }
+    }
+    t1 = bench_time_ns();
+    md_stats_snapshot(&after);
+    if(ptr==NULL){
+        fprintf(stderr, "md_bench: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    times[PHASE_TABLES] = layout==LAYOUT_MD ? (double)(after.table_build_ns - before.table_build_ns) : 0.0;
+    times[PHASE_ALLOC] = t1 - t0 - times[PHASE_TABLES];
+    data = layout==LAYOUT_MD ? (bench_type*)flattenNd(ptr, rank) : (bench_type*)ptr;
+
+    /* fill */
+    t0 = bench_time_ns();
+    memset(data, 0, n*sizeof(bench_type));
+    times[PHASE_FILL] = bench_time_ns() - t0;
+
+    /* access */
+    memset(acc, 0, dims[rank-1]*sizeof(bench_type));
+    t0 = bench_time_ns();
+    switch(layout){
+        case LAYOUT_MD:      bench_access_md(ptr, rank, dims, acc); break;
+        case LAYOUT_MANGLED: bench_access_mangled(data, rank, dims, acc); break;
+#ifdef BENCH_HAVE_VLA
+        case LAYOUT_C99:     bench_access_c99(ptr, rank, dims, acc); break;
+#endif
+    }
+    times[PHASE_ACCESS] = bench_time_ns() - t0;
+    bench_sink += acc[dims[rank-1]-1];
+
+    /* free */
+    t0 = bench_time_ns();
+    free(ptr);
+    times[PHASE_FREE] = bench_time_ns() - t0;
+}
+
+static void bench_usage(void)
+{
+    fprintf(stderr, "usage: md_bench [--elems N] [--reps N] [--warmup N] [--json FILE]\n"
+                    "  --elems N    elements per array (default 4194304)\n"
+                    "  --reps N     timed runs per configuration (default 25)\n"
+                    "  --warmup N   untimed runs per configuration (default 3)\n"
+                    "  --json FILE  also write the results to FILE as JSON (\"-\" for stdout)\n");
+}
+
+int main(int argc, const char * argv[])
+{
+    int a, r, ph, layout, mode, reps, warmup, first;
+    size_t l, rank, elems, n, dims[BENCH_MAX_RANK];
+    const char* json_path;
+    FILE* json;
+    double times[NUM_PHASES], median[NUM_PHASES], p99[NUM_PHASES];
+    double* samples[NUM_PHASES];
+    bench_type* acc;
+
+    /* options */
+    elems = 4194304;
+    reps = 25;
+    warmup = 3;
+    json_path = NULL;
+    for(a=1; a<argc; a++){
+        if(strcmp(argv[a], "--elems")==0 && a+1<argc)
+            elems = (size_t)strtoul(argv[++a], NULL, 10);
+        else if(strcmp(argv[a], "--reps")==0 && a+1<argc)
+            reps = atoi(argv[++a]);
+        else if(strcmp(argv[a], "--warmup")==0 && a+1<argc)
+            warmup = atoi(argv[++a]);
+        else if(strcmp(argv[a], "--json")==0 && a+1<argc)
+            json_path = argv[++a];
+        else{
+            bench_usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if(elems<1 || reps<1 || warmup<0){
+        bench_usage();
+        return EXIT_FAILURE;
+    }
+    json = NULL;
+    if(json_path!=NULL){
+        json = strcmp(json_path, "-")==0 ? stdout : fopen(json_path, "w");
+        if(json==NULL){
+            fprintf(stderr, "md_bench: could not open \"%s\"\n", json_path);
+            return EXIT_FAILURE;
+        }
+        fprintf(json, "{\n  \"benchmark\": \"md_malloc\",\n  \"elements\": %zu,\n  \"data_size\": %zu,\n"
+                      "  \"reps\": %d,\n  \"warmup\": %d,\n  \"units\": \"ns\",\n  \"results\": [",
+                elems, sizeof(bench_type), reps, warmup);
+    }
+    for(ph=0; ph<NUM_PHASES; ph++)
+        samples[ph] = (double*)malloc(reps*sizeof(double));
+    acc = (bench_type*)malloc(elems*sizeof(bench_type));
+
+    /* human readable output goes to stderr when the JSON goes to stdout */
+#define BENCH_LOG (json==stdout ? stderr : stdout)
+    fprintf(BENCH_LOG, "%zu elements (%zu bytes) per array; median [p99] of %d runs, in microseconds\n\n",
+            elems, elems*sizeof(bench_type), reps);
+    fprintf(BENCH_LOG, "%-4s %-8s %-10s %-22s", "rank", "mode", "layout", "dims");
+    for(ph=0; ph<NUM_PHASES; ph++)
+        fprintf(BENCH_LOG, " %18s", phase_names[ph]);
+    fprintf(BENCH_LOG, "\n");
+
+    first = 1;
+    for(rank=1; rank<=BENCH_MAX_RANK; rank++){
+        bench_shape(elems, rank, dims);
+        for(l=0, n=1; l<rank; l++)
+            n *= dims[l];
+        for(mode=MD_STATS_MALLOC; mode<=MD_STATS_REALLOC; mode++){
+            for(layout=0; layout<NUM_LAYOUTS; layout++){
+                char shape[64];
+                size_t len;
+#ifndef BENCH_HAVE_VLA
+                if(layout==LAYOUT_C99)
+                    continue;
+#endif
+                for(r=0; r<warmup; r++)
+                    bench_run(layout, mode, rank, dims, n, acc, times);
+                for(r=0; r<reps; r++){
+                    bench_run(layout, mode, rank, dims, n, acc, times);
+                    for(ph=0; ph<NUM_PHASES; ph++)
+                        samples[ph][r] = times[ph];
+                }
+                for(ph=0; ph<NUM_PHASES; ph++)
+                    bench_percentiles(samples[ph], reps, &median[ph], &p99[ph]);
+
+                /* report */
+                for(l=0, len=0; l<rank && len<sizeof(shape); l++)
+                    len += (size_t)snprintf(shape+len, sizeof(shape)-len, l==0 ? "%zu" : "x%zu", dims[l]);
+                fprintf(BENCH_LOG, "%-4zu %-8s %-10s %-22s", rank, mode_names[mode], layout_names[layout], shape);
+                for(ph=0; ph<NUM_PHASES; ph++)
+                    fprintf(BENCH_LOG, " %8.1f [%7.1f]", median[ph]/1.0e3, p99[ph]/1.0e3);
+                fprintf(BENCH_LOG, "\n");
+                if(json!=NULL){
+                    fprintf(json, "%s\n    { \"rank\": %zu, \"mode\": \"%s\", \"layout\": \"%s\", \"dims\": [",
+                            first ? "" : ",", rank, mode_names[mode], layout_names[layout]);
+                    for(l=0; l<rank; l++)
+                        fprintf(json, l==0 ? "%zu" : ", %zu", dims[l]);
+                    fprintf(json, "],\n      \"phases\": {");
+                    for(ph=0; ph<NUM_PHASES; ph++)
+                        fprintf(json, "%s \"%s\": { \"median\": %.0f, \"p99\": %.0f }",
+                                ph==0 ? "" : ",", phase_names[ph], median[ph], p99[ph]);
+                    fprintf(json, " } }");
+                    first = 0;
+                }
+            }
+        }
+    }
+    if(json!=NULL){
+        fprintf(json, "\n  ]\n}\n");
+        if(json!=stdout)
+            fclose(json);
+    }
+#undef BENCH_LOG
+
+    for(ph=0; ph<NUM_PHASES; ph++)
+        free(samples[ph]);
+    free(acc);
+    return 0;
+}
@@ -0,0 +1,302 @@
+/*
+ Copyright (c) 2019 Leo McCormack
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+/*
+ * Multithreaded allocation benchmark for md_malloc: throughput and tail
+ * latency of mallocNd()/callocNd() + md_free() against the number of (OpenMP)
+ * threads, for each backend:
+ *   none    the system allocator only
+ *   global  the shared recycling cache (md_cache_set_limit())
+ *   thread  the per-thread caches (md_tcache_set_limit())
+ * and each pattern:
+ *   local   each thread frees the arrays it allocated
+ *   remote  each thread frees the arrays allocated by its neighbour
+ *
+ * Each thread runs "ops" operations, in rounds of "batch": it allocates
+ * "batch" arrays (cycling through a few 2-D/3-D shapes, and touching each),
+ * waits for the other threads, and then frees a batch (its own, or its
+ * neighbour's). Every allocation and free is timed individually; the median,
+ * 99th and 99.9th percentiles are reported, along with the total throughput
+ * (allocation/free pairs per second). Results may also be written out as JSON
+ * (--json).
+ *
+ * usage: md_threads [--threads N] [--ops N] [--batch N] [--json FILE]
+ */
+
+#if defined(__STRICT_ANSI__) && !defined(_POSIX_C_SOURCE) && !defined(_WIN32)
+# define _POSIX_C_SOURCE 200112L /* for clock_gettime() and pthreads under -std=c99 */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+#define MD_MALLOC_ENABLE
+#define MD_MALLOC_ENABLE_THREAD_CACHE
+#include "../md_malloc.h"
+
+#define BENCH_NUM_SHAPES 4
+#define BENCH_CACHE_BYTES (16<<20) /* per cache */
+
+enum { BACKEND_NONE, BACKEND_GLOBAL, BACKEND_THREAD, NUM_BACKENDS };
+enum { PATTERN_LOCAL, PATTERN_REMOTE, NUM_PATTERNS };
+enum { OP_ALLOC, OP_FREE, NUM_OPS };
+static const char* backend_names[NUM_BACKENDS] = { "none", "global", "thread" };
+static const char* pattern_names[NUM_PATTERNS] = { "local", "remote" };
+static const char* op_names[NUM_OPS] = { "alloc", "free" };
+
+/* The shapes cycled through: { ndims, dims... } (all float) */
+static const size_t bench_shapes[BENCH_NUM_SHAPES][4] = {
+    { 2, 32, 32, 0 }, { 3, 8, 16, 16 }, { 2, 64, 48, 0 }, { 3, 4, 32, 24 }
+};
+
+/* Wall-clock time in nanoseconds */
+static double bench_time_ns(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER f, t;
+    QueryPerformanceFrequency(&f);
+    QueryPerformanceCounter(&t);
+    return (double)t.QuadPart*1.0e9/(double)f.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec*1.0e9 + (double)ts.tv_nsec;
+#elif defined(TIME_UTC)
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec*1.0e9 + (double)ts.tv_nsec;
+#else
+# error "no wall-clock timer available"
+#endif
+}
+
+static int bench_compare(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* Percentile "p" (nearest rank) of "n" sorted samples */
+static double bench_percentile(const double* sorted, size_t n, double p)
+{
+    size_t rank = (size_t)ceil(p*(double)n);
+    return sorted[rank < 1 ? 0 : rank-1];
+}
+
+/* Runs one configuration with "nthreads" threads; "samples" holds ops*nthreads
+ * latencies for each of OP_ALLOC/OP_FREE. Returns the wall-clock time (ns),
+ * or a negative value if an allocation failed */
+static double bench_run(int backend, int pattern, int nthreads, size_t ops,
+                        size_t batch, void** slots, double* samples[NUM_OPS])
+{
+    double start, elapsed;
+    int failed;
+    failed = 0;
+    md_cache_set_limit(backend==BACKEND_GLOBAL ? BENCH_CACHE_BYTES : 0);
+    md_tcache_set_limit(backend==BACKEND_THREAD ? BENCH_CACHE_BYTES : 0);
+    start = bench_time_ns();
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(nthreads) reduction(|:failed)
+#endif
+    {
+        int t, victim;
+        size_t n, b, s, count;
+        double t0, t1;
+        void* a;
+#ifdef _OPENMP
+        t = omp_get_thread_num();
+#else
+        t = 0;
+#endif
+        victim = pattern==PATTERN_REMOTE ? (t+1)%nthreads : t;
+        for(n=0; n<ops; n+=batch){
+            count = ops-n < batch ? ops-n : batch;
+            for(b=0; b<count; b++){
+                s = (n+b)%BENCH_NUM_SHAPES;
+                t0 = bench_time_ns();
+                a = s%2 ? callocNd(bench_shapes[s][0], &bench_shapes[s][1], sizeof(float))
+                        : mallocNd(bench_shapes[s][0], &bench_shapes[s][1], sizeof(float));
+                t1 = bench_time_ns();
+                samples[OP_ALLOC][(size_t)t*ops + n+b] = t1-t0;
+                if(a==NULL)
+                    failed = 1;
+                else if(bench_shapes[s][0]==2)
+                    ((float**)a)[0][0] = 1.0f; /* touch */
+                else
+                    ((float***)a)[0][0][0] = 1.0f;
+                slots[(size_t)t*batch + b] = a;
+            }
+#ifdef _OPENMP
+            #pragma omp barrier
+#endif
+            for(b=0; b<count; b++){
+                t0 = bench_time_ns();
+                md_free(slots[(size_t)victim*batch + b]);
+                t1 = bench_time_ns();
+                samples[OP_FREE][(size_t)t*ops + n+b] = t1-t0;
+            }
+#ifdef _OPENMP
+            #pragma omp barrier
+#endif
+        }
+    }
+    elapsed = bench_time_ns() - start;
+    md_cache_set_limit(0);
+    md_tcache_set_limit(0);
+    return failed ? -1.0 : elapsed;
+}
+
+static void bench_usage(void)
+{
+    fprintf(stderr, "usage: md_threads [--threads N] [--ops N] [--batch N] [--json FILE]\n"
+                    "  --threads  maximum number of threads; runs 1, 2, 4, .. up to N (default: all)\n"
+                    "  --ops      allocations (and frees) per thread (default 100000)\n"
+                    "  --batch    arrays allocated by each thread before freeing (default 16)\n"
+                    "  --json     also write the results to FILE as JSON (\"-\" for stdout)\n");
+}
+
+int main(int argc, const char * argv[])
+{
+    int a, op, backend, pattern, nthreads, max_threads, first;
+    size_t ops, batch, n;
+    const char* json_path;
+    FILE* json;
+    double elapsed, throughput, p50[NUM_OPS], p99[NUM_OPS], p999[NUM_OPS];
+    double* samples[NUM_OPS];
+    void** slots;
+
+    /* options */
+#ifdef _OPENMP
+    max_threads = omp_get_max_threads();
+#else
+    max_threads = 1;
+#endif
+    ops = 100000;
+    batch = 16;
+    json_path = NULL;
+    for(a=1; a<argc; a++){
+        if(strcmp(argv[a], "--threads")==0 && a+1<argc)
+            max_threads = atoi(argv[++a]);
+        else if(strcmp(argv[a], "--ops")==0 && a+1<argc)
+            ops = (size_t)strtoul(argv[++a], NULL, 10);
+        else if(strcmp(argv[a], "--batch")==0 && a+1<argc)
+            batch = (size_t)strtoul(argv[++a], NULL, 10);
+        else if(strcmp(argv[a], "--json")==0 && a+1<argc)
+            json_path = argv[++a];
+        else{
+            bench_usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if(max_threads<1 || ops<1 || batch<1){
+        bench_usage();
+        return EXIT_FAILURE;
+    }
+#ifndef _OPENMP
+    max_threads = 1;
+#endif
+    json = NULL;
+    if(json_path!=NULL){
+        json = strcmp(json_path, "-")==0 ? stdout : fopen(json_path, "w");
+        if(json==NULL){
+            fprintf(stderr, "md_threads: could not open \"%s\"\n", json_path);
+            return EXIT_FAILURE;
+        }
+        fprintf(json, "{\n  \"benchmark\": \"md_threads\",\n  \"ops\": %zu,\n  \"batch\": %zu,\n"
+                      "  \"units\": \"ns\",\n  \"results\": [", ops, batch);
+    }
+    for(op=0; op<NUM_OPS; op++)
+        samples[op] = (double*)malloc((size_t)max_threads*ops*sizeof(double));
+    slots = (void**)malloc((size_t)max_threads*batch*sizeof(void*));
+    if(samples[OP_ALLOC]==NULL || samples[OP_FREE]==NULL || slots==NULL){
+        fprintf(stderr, "md_threads: out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    /* human readable output goes to stderr when the JSON goes to stdout */
+#define BENCH_LOG (json==stdout ? stderr : stdout)
+    fprintf(BENCH_LOG, "%zu allocations per thread, in batches of %zu; latencies in nanoseconds\n\n", ops, batch);
+    fprintf(BENCH_LOG, "%-7s %-7s %-7s %12s", "threads", "backend", "pattern", "Mops/s");
+    for(op=0; op<NUM_OPS; op++)
+        fprintf(BENCH_LOG, "  %5s p50 %5s p99 %4s p99.9", op_names[op], op_names[op], op_names[op]);
+    fprintf(BENCH_LOG, "\n");
+
+    first = 1;
+    for(nthreads=1; nthreads<=max_threads; nthreads = nthreads<max_threads && nthreads*2>max_threads ? max_threads : nthreads*2){
+        for(pattern=0; pattern<NUM_PATTERNS; pattern++){
+            if(pattern==PATTERN_REMOTE && nthreads==1)
+                continue; /* (the same as local) */
+            for(backend=0; backend<NUM_BACKENDS; backend++){
+#ifndef MD_MALLOC_HAVE_THREAD_CACHE
+                if(backend==BACKEND_THREAD)
+                    continue;
+#endif
+                elapsed = bench_run(backend, pattern, nthreads, ops, batch, slots, samples);
+                if(elapsed<0.0){
+                    fprintf(stderr, "md_threads: allocation failed\n");
+                    return EXIT_FAILURE;
+                }
+                n = (size_t)nthreads*ops;
+                for(op=0; op<NUM_OPS; op++){
+                    qsort(samples[op], n, sizeof(double), bench_compare);
+                    p50[op] = bench_percentile(samples[op], n, 0.5);
+                    p99[op] = bench_percentile(samples[op], n, 0.99);
+                    p999[op] = bench_percentile(samples[op], n, 0.999);
+                }
+                throughput = (double)n/elapsed*1.0e3; /* millions per second */
+
+                /* report */
+                fprintf(BENCH_LOG, "%-7d %-7s %-7s %12.2f", nthreads, backend_names[backend],
+                        pattern_names[pattern], throughput);
+                for(op=0; op<NUM_OPS; op++)
+                    fprintf(BENCH_LOG, "  %9.0f %9.0f %9.0f", p50[op], p99[op], p999[op]);
+                fprintf(BENCH_LOG, "\n");
+                if(json!=NULL){
+                    fprintf(json, "%s\n    { \"threads\": %d, \"backend\": \"%s\", \"pattern\": \"%s\", "
+                                  "\"mops_per_sec\": %.3f,\n      \"latency\": {",
+                            first ? "" : ",", nthreads, backend_names[backend], pattern_names[pattern], throughput);
+                    for(op=0; op<NUM_OPS; op++)
+                        fprintf(json, "%s \"%s\": { \"p50\": %.0f, \"p99\": %.0f, \"p999\": %.0f }",
+                                op==0 ? "" : ",", op_names[op], p50[op], p99[op], p999[op]);
+                    fprintf(json, " } }");
+                    first = 0;
+                }
+            }
+        }
+    }
+    if(json!=NULL){
+        fprintf(json, "\n  ]\n}\n");
+        if(json!=stdout)
+            fclose(json);
+    }
+#undef BENCH_LOG
+
+    for(op=0; op<NUM_OPS; op++)
+        free(samples[op]);
+    free(slots);
+    return 0;
+}
@@ -46,6 +46,8 @@
 #ifndef MD_MALLOC_INCLUDED
 #define MD_MALLOC_INCLUDED
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -93,6 +95,20 @@ extern "C" {
  */
 #define FLATTEN6D(A) (*****A) /* || (&A[0][0][0][0][0][0]) */
 
+/**
+ * Use this macro when passing a 7-D dynamic multi-dimensional array to
+ * memset, memcpy or any other function that expects a flat contiguous 1-D block
+ * of data
+ */
+#define FLATTEN7D(A) (******A) /* || (&A[0][0][0][0][0][0][0]) */
+
+/**
+ * Use this macro when passing an 8-D dynamic multi-dimensional array to
+ * memset, memcpy or any other function that expects a flat contiguous 1-D block
+ * of data (see also flattenNd() for any number of dimensions)
+ */
+#define FLATTEN8D(A) (*******A) /* || (&A[0][0][0][0][0][0][0][0]) */
+
 /** 1-D malloc (same as malloc, but with error checking) */
 void* malloc1d(size_t dim1_data_size);
 
@@ -102,30 +118,54 @@ void* calloc1d(size_t dim1, size_t data_size);
 /** 1-D realloc (same as realloc, but with error checking) */
 void* realloc1d(void* ptr, size_t dim1_data_size);
 
-/** 2-D malloc (contiguously allocated, so use free() as usual to deallocate) */
+/**
+ * 1-D free (same as free, but also keeps the md_stats live byte counts up to
+ * date; may be used to free any of the arrays allocated by this header)
+ */
+void free1d(void* ptr);
+
+/**
+ * 2-D malloc (contiguously allocated, so use free() as usual to deallocate;
+ * but NOT while a recycling cache or huge page threshold is set, see md_free())
+ */
 void** malloc2d(size_t dim1, size_t dim2, size_t data_size);
 
-/** 2-D calloc (contiguously allocated, so use free() as usual to deallocate) */
+/**
+ * 2-D calloc (contiguously allocated, so use free() as usual to deallocate;
+ * but NOT while a recycling cache or huge page threshold is set, see md_free())
+ */
 void** calloc2d(size_t dim1, size_t dim2, size_t data_size);
 
 /** 2-D realloc which does NOT retain previous data order */
 void** realloc2d(void** ptr, size_t dim1, size_t dim2, size_t data_size);
 
-/** 3-D malloc (contiguously allocated, so use free() as usual to deallocate) */
+/**
+ * 3-D malloc (contiguously allocated, so use free() as usual to deallocate;
+ * but NOT while a recycling cache or huge page threshold is set, see md_free())
+ */
 void*** malloc3d(size_t dim1, size_t dim2, size_t dim3, size_t data_size);
 
-/** 3-D calloc (contiguously allocated, so use free() as usual to deallocate) */
+/**
+ * 3-D calloc (contiguously allocated, so use free() as usual to deallocate;
+ * but NOT while a recycling cache or huge page threshold is set, see md_free())
+ */
 void*** calloc3d(size_t dim1, size_t dim2, size_t dim3, size_t data_size);
 
 /** 3-D realloc which does NOT retain previous data order */
 void*** realloc3d(void*** ptr, size_t dim1, size_t dim2, size_t dim3,
                   size_t data_size);
 
-/** 4-D malloc (contiguously allocated, so use free() as usual to deallocate) */
+/**
+ * 4-D malloc (contiguously allocated, so use free() as usual to deallocate;
+ * but NOT while a recycling cache or huge page threshold is set, see md_free())
+ */
 void**** malloc4d(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
                   size_t data_size);
 
-/** 4-D calloc (contiguously allocated, so use free() as usual to deallocate) */
+/**
+ * 4-D calloc (contiguously allocated, so use free() as usual to deallocate;
+ * but NOT while a recycling cache or huge page threshold is set, see md_free())
+ */
 void**** calloc4d(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
                   size_t data_size);
 
@@ -133,11 +173,17 @@ void**** calloc4d(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
 void**** realloc4d(void**** ptr, size_t dim1, size_t dim2, size_t dim3,
                    size_t dim4, size_t data_size);
 
-/** 5-D malloc (contiguously allocated, so use free() as usual to deallocate) */
+/**
+ * 5-D malloc (contiguously allocated, so use free() as usual to deallocate;
+ * but NOT while a recycling cache or huge page threshold is set, see md_free())
+ */
 void***** malloc5d(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
                    size_t dim5, size_t data_size);
 
-/** 5-D calloc (contiguously allocated, so use free() as usual to deallocate) */
+/**
+ * 5-D calloc (contiguously allocated, so use free() as usual to deallocate;
+ * but NOT while a recycling cache or huge page threshold is set, see md_free())
+ */
 void***** calloc5d(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
                    size_t dim5, size_t data_size);
 
@@ -145,11 +191,17 @@ void***** calloc5d(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
 void***** realloc5d(void***** ptr, size_t dim1, size_t dim2, size_t dim3,
                     size_t dim4, size_t dim5, size_t data_size);
 
-/** 6-D malloc (contiguously allocated, so use free() as usual to deallocate) */
+/**
+ * 6-D malloc (contiguously allocated, so use free() as usual to deallocate;
+ * but NOT while a recycling cache or huge page threshold is set, see md_free())
+ */
 void****** malloc6d(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
                     size_t dim5, size_t dim6, size_t data_size);
 
-/** 6-D malloc (contiguously allocated, so use free() as usual to deallocate) */
+/**
+ * 6-D calloc (contiguously allocated, so use free() as usual to deallocate;
+ * but NOT while a recycling cache or huge page threshold is set, see md_free())
+ */
 void****** calloc6d(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
                     size_t dim5, size_t dim6, size_t data_size);
 
@@ -157,459 +209,5745 @@ void****** calloc6d(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
 void****** realloc6d(void****** ptr, size_t dim1, size_t dim2, size_t dim3,
                      size_t dim4, size_t dim5, size_t dim6, size_t data_size);
 
+/**
+ * N-D malloc (contiguously allocated, so use free() as usual to deallocate;
+ * but NOT while a recycling cache or huge page threshold is set, see md_free())
+ *
+ * Allocates an array of any number of dimensions, "ndims", with lengths
+ * dims[0]..dims[ndims-1]. The pointer tables are laid out in the same way as
+ * for malloc2d()..malloc6d() (which are wrappers around this function), and
+ * each table level is filled in a single linear pass.
+ *
+ * e.g. an 8-D [band][ch][frame][tap][a][b][c][d] array:
+ * \code{.c}
+ *   size_t dims[8] = {4, 2, 10, 16, 2, 3, 2, 5};
+ *   float******** array8D = (float********)mallocNd(8, dims, sizeof(float));
+ *   array8D[3][1][9][15][1][2][1][4] = 1.0f;
+ *   memset(FLATTEN8D(array8D), 0, 4*2*10*16*2*3*2*5*sizeof(float));
+ *   free(array8D);
+ * \endcode
+ */
+void* mallocNd(size_t ndims, const size_t* dims, size_t data_size);
 
-#ifdef __cplusplus
-} /*extern "C"*/
-#endif
+/** N-D calloc (contiguously allocated, so use free() as usual to deallocate) */
+void* callocNd(size_t ndims, const size_t* dims, size_t data_size);
 
-#endif /* MD_MALLOC_INCLUDED */
+/** N-D realloc which does NOT retain previous data order */
+void* reallocNd(void* ptr, size_t ndims, const size_t* dims, size_t data_size);
 
+/**
+ * N-D realloc which DOES retain the previous data order
+ *
+ * The region [0..min(old_dims[0],new_dims[0])-1]...[0..min(old_dims[ndims-1],
+ * new_dims[ndims-1])-1], which is common to both the old and new shapes, is
+ * kept intact; any new elements are left uninitialised. The data is moved
+ * within the block itself (memmove, in the direction that does not overwrite
+ * rows yet to be moved), so no second block is ever allocated, and rows which
+ * stay put are not touched. Only for arrays with the default layout (i.e. not
+ * those from the aligned_ or _pitched functions).
+ *
+ * e.g.
+ * \code{.c}
+ *   float** array2D = (float**)malloc2d(10, 20, sizeof(float));
+ *   array2D[9][19] = 1.0f;
+ *   array2D = (float**)realloc2d_preserve((void**)array2D, 10, 20, 15, 25, sizeof(float));
+ *   // array2D[9][19] is still 1.0f
+ * \endcode
+ */
+void* reallocNd_preserve(void* ptr, size_t ndims, const size_t* old_dims,
+                         const size_t* new_dims, size_t data_size);
 
-/************
- * INTERNAL:
- ***********/
+/** 2-D realloc which retains the data order of the overlapping region */
+void** realloc2d_preserve(void** ptr, size_t old_dim1, size_t old_dim2,
+                          size_t new_dim1, size_t new_dim2, size_t data_size);
 
-#ifdef MD_MALLOC_ENABLE
+/** 3-D realloc which retains the data order of the overlapping region */
+void*** realloc3d_preserve(void*** ptr, size_t old_dim1, size_t old_dim2,
+                           size_t old_dim3, size_t new_dim1, size_t new_dim2,
+                           size_t new_dim3, size_t data_size);
 
-#include <stdio.h>
-#include <math.h>
-#include <stdlib.h>
-#include <string.h>
-#include "md_malloc.h"
+/** 4-D realloc which retains the data order of the overlapping region */
+void**** realloc4d_preserve(void**** ptr, size_t old_dim1, size_t old_dim2,
+                            size_t old_dim3, size_t old_dim4, size_t new_dim1,
+                            size_t new_dim2, size_t new_dim3, size_t new_dim4,
+                            size_t data_size);
 
-void* malloc1d(size_t dim1_data_size)
-{
-    void *ptr = malloc(dim1_data_size);
-#if !defined(NDEBUG)
-    if (ptr == NULL && dim1_data_size!=0)
-        fprintf(stderr, "Error: 'malloc1d' failed to allocate %zu bytes.\n", dim1_data_size);
-#endif
-    return ptr;
-}
+/** 5-D realloc which retains the data order of the overlapping region */
+void***** realloc5d_preserve(void***** ptr, size_t old_dim1, size_t old_dim2,
+                             size_t old_dim3, size_t old_dim4, size_t old_dim5,
+                             size_t new_dim1, size_t new_dim2, size_t new_dim3,
+                             size_t new_dim4, size_t new_dim5,
+                             size_t data_size);
 
-void* calloc1d(size_t dim1, size_t data_size)
-{
-    void *ptr = calloc(dim1, data_size);
-#if !defined(NDEBUG)
-    if (ptr == NULL && dim1!=0)
-        fprintf(stderr, "Error: 'calloc1d' failed to allocate %zu bytes.\n", dim1*data_size);
-#endif
-    return ptr;
-}
+/** 6-D realloc which retains the data order of the overlapping region */
+void****** realloc6d_preserve(void****** ptr, size_t old_dim1, size_t old_dim2,
+                              size_t old_dim3, size_t old_dim4, size_t old_dim5,
+                              size_t old_dim6, size_t new_dim1, size_t new_dim2,
+                              size_t new_dim3, size_t new_dim4, size_t new_dim5,
+                              size_t new_dim6, size_t data_size);
 
-void* realloc1d(void* ptr, size_t dim1_data_size)
-{
-    ptr = realloc(ptr, dim1_data_size);
-#if !defined(NDEBUG)
-    if (ptr == NULL && dim1_data_size!=0)
-        fprintf(stderr, "Error: 'realloc1d' failed to allocate %zu bytes.\n", dim1_data_size);
+/**
+ * Returns the number of bytes that mallocNd() would allocate for an "ndims"
+ * array (pointer tables plus data), without allocating anything. The number of
+ * these bytes which are taken by the pointer tables is returned via "overhead"
+ * (if not NULL)
+ */
+size_t md_sizeof(size_t ndims, const size_t* dims, size_t data_size,
+                 size_t* overhead);
+
+/**
+ * Returns the flat contiguous 1-D block of data of an "ndims" dynamic
+ * multi-dimensional array (i.e. the same as FLATTEN2D..FLATTEN8D)
+ */
+void* flattenNd(void* ptr, size_t ndims);
+
+/**
+ * Returns a deep copy of the "ndims" array "ptr" (pointer tables and data), or
+ * NULL if it could not be allocated
+ *
+ * Since the pointer tables hold absolute addresses, a plain memcpy() of the
+ * block would give a copy whose tables still point into the original. Here,
+ * the block is copied in one pass, with the table pointers rebased onto the
+ * new block along the way (in SIMD registers, if MD_MALLOC_ENABLE_SIMD is
+ * defined), rather than being rebuilt. "ptr" must have the default layout, as
+ * from mallocNd() (i.e. not aligned, pitched, sliced, mapped or from an arena);
+ * the copy is freed with md_free() (or free()) as usual:
+ * \code{.c}
+ *   float*** undo = (float***)md_clone3d((void***)X, nBands, nCH, nTime, sizeof(float));
+ *   ... // modify X
+ *   md_copy_into((void*)X, (void*)undo, 3, dims, sizeof(float)); // restore it
+ * \endcode
+ */
+void* md_cloneNd(void* ptr, size_t ndims, const size_t* dims,
+                 size_t data_size);
+
+/** 2-D deep copy (see md_cloneNd()) */
+void** md_clone2d(void** ptr, size_t dim1, size_t dim2, size_t data_size);
+
+/** 3-D deep copy (see md_cloneNd()) */
+void*** md_clone3d(void*** ptr, size_t dim1, size_t dim2, size_t dim3,
+                   size_t data_size);
+
+/** 4-D deep copy (see md_cloneNd()) */
+void**** md_clone4d(void**** ptr, size_t dim1, size_t dim2, size_t dim3,
+                    size_t dim4, size_t data_size);
+
+/** 5-D deep copy (see md_cloneNd()) */
+void***** md_clone5d(void***** ptr, size_t dim1, size_t dim2, size_t dim3,
+                     size_t dim4, size_t dim5, size_t data_size);
+
+/** 6-D deep copy (see md_cloneNd()) */
+void****** md_clone6d(void****** ptr, size_t dim1, size_t dim2, size_t dim3,
+                      size_t dim4, size_t dim5, size_t dim6, size_t data_size);
+
+/**
+ * Copies the "ndims" array "src" (pointer tables and data, as md_cloneNd())
+ * into the block "dst", which must hold at least md_sizeof(ndims, dims,
+ * data_size, NULL) bytes (e.g. an array of the same shape, or one from
+ * malloc1d()) and not overlap "src". Returns "dst", which is then an array of
+ * the same shape as "src" (or NULL, if "src" does not have the default layout)
+ */
+void* md_copy_into(void* dst, void* src, size_t ndims, const size_t* dims,
+                   size_t data_size);
+
+/**
+ * Rounds "x" up to the next multiple of "a" (which must be a power of 2)
+ *
+ * e.g. the row stride (in bytes) of an array allocated with "align_rows" set:
+ * \code{.c}
+ *   float** array2D = (float**)aligned_malloc2d(10, 37, sizeof(float), 32, 1);
+ *   size_t stride = MD_ALIGN_UP(37*sizeof(float), 32); // 160 bytes
+ * \endcode
+ */
+#define MD_ALIGN_UP(x, a) (((x) + ((a) - 1)) & ~((size_t)(a) - 1))
+
+/**
+ * 2-D aligned malloc (contiguously allocated, so use free() as usual to
+ * deallocate)
+ *
+ * The data block (i.e. FLATTEN2D(ptr)) starts on an "alignment" byte boundary,
+ * which must be a power of 2 (e.g. 16, 32, 64 or 4096). If "align_rows" is
+ * non-zero, then the innermost rows are each also padded to start on an
+ * "alignment" boundary; note that the data is then no longer one flat block
+ * of dim1*dim2 elements, but of dim1 rows with a stride of
+ * MD_ALIGN_UP(dim2*data_size, alignment) bytes.
+ */
+void** aligned_malloc2d(size_t dim1, size_t dim2, size_t data_size,
+                        size_t alignment, int align_rows);
+
+/** 2-D aligned calloc (see aligned_malloc2d()) */
+void** aligned_calloc2d(size_t dim1, size_t dim2, size_t data_size,
+                        size_t alignment, int align_rows);
+
+/** 2-D aligned realloc which does NOT retain previous data order */
+void** aligned_realloc2d(void** ptr, size_t dim1, size_t dim2,
+                         size_t data_size, size_t alignment, int align_rows);
+
+/** 3-D aligned malloc (see aligned_malloc2d()) */
+void*** aligned_malloc3d(size_t dim1, size_t dim2, size_t dim3,
+                         size_t data_size, size_t alignment, int align_rows);
+
+/** 3-D aligned calloc (see aligned_malloc2d()) */
+void*** aligned_calloc3d(size_t dim1, size_t dim2, size_t dim3,
+                         size_t data_size, size_t alignment, int align_rows);
+
+/** 3-D aligned realloc which does NOT retain previous data order */
+void*** aligned_realloc3d(void*** ptr, size_t dim1, size_t dim2, size_t dim3,
+                          size_t data_size, size_t alignment, int align_rows);
+
+/** 4-D aligned malloc (see aligned_malloc2d()) */
+void**** aligned_malloc4d(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
+                          size_t data_size, size_t alignment, int align_rows);
+
+/** 4-D aligned calloc (see aligned_malloc2d()) */
+void**** aligned_calloc4d(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
+                          size_t data_size, size_t alignment, int align_rows);
+
+/** 4-D aligned realloc which does NOT retain previous data order */
+void**** aligned_realloc4d(void**** ptr, size_t dim1, size_t dim2, size_t dim3,
+                           size_t dim4, size_t data_size, size_t alignment,
+                           int align_rows);
+
+/** 5-D aligned malloc (see aligned_malloc2d()) */
+void***** aligned_malloc5d(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
+                           size_t dim5, size_t data_size, size_t alignment,
+                           int align_rows);
+
+/** 5-D aligned calloc (see aligned_malloc2d()) */
+void***** aligned_calloc5d(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
+                           size_t dim5, size_t data_size, size_t alignment,
+                           int align_rows);
+
+/** 5-D aligned realloc which does NOT retain previous data order */
+void***** aligned_realloc5d(void***** ptr, size_t dim1, size_t dim2,
+                            size_t dim3, size_t dim4, size_t dim5,
+                            size_t data_size, size_t alignment, int align_rows);
+
+/** 6-D aligned malloc (see aligned_malloc2d()) */
+void****** aligned_malloc6d(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
+                            size_t dim5, size_t dim6, size_t data_size,
+                            size_t alignment, int align_rows);
+
+/** 6-D aligned calloc (see aligned_malloc2d()) */
+void****** aligned_calloc6d(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
+                            size_t dim5, size_t dim6, size_t data_size,
+                            size_t alignment, int align_rows);
+
+/** 6-D aligned realloc which does NOT retain previous data order */
+void****** aligned_realloc6d(void****** ptr, size_t dim1, size_t dim2,
+                             size_t dim3, size_t dim4, size_t dim5, size_t dim6,
+                             size_t data_size, size_t alignment,
+                             int align_rows);
+
+
+/**
+ * 2-D pitched malloc (contiguously allocated, so use free() as usual to
+ * deallocate)
+ *
+ * Each innermost row is padded to a multiple of "pitch_multiple" bytes (e.g. a
+ * 64 byte cache line), and of data_size. If "avoid_aliasing" is non-zero, then
+ * rows are further padded to an odd number of these multiples; so that power
+ * of 2 row lengths (e.g. 1024 floats) do not map to the same cache sets when
+ * walking down a column. The data block starts on the largest power of 2 that
+ * divides the row stride.
+ *
+ * The resulting row stride (in elements) is returned via "pitch" (if not
+ * NULL), which may then be passed as the leading dimension to e.g. CBLAS:
+ * \code{.c}
+ *   size_t lda;
+ *   float** A = (float**)malloc2d_pitched(64, 1024, sizeof(float), 64, 1, &lda);
+ *   // lda == 1040; element [i][j] is at FLATTEN2D(A)[i*lda + j]
+ *   cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, 64, N, 1024, 1.0f,
+ *               FLATTEN2D(A), (int)lda, B, N, 0.0f, C, N);
+ * \endcode
+ */
+void** malloc2d_pitched(size_t dim1, size_t dim2, size_t data_size,
+                        size_t pitch_multiple, int avoid_aliasing,
+                        size_t* pitch);
+
+/** 2-D pitched calloc, padding included (see malloc2d_pitched()) */
+void** calloc2d_pitched(size_t dim1, size_t dim2, size_t data_size,
+                        size_t pitch_multiple, int avoid_aliasing,
+                        size_t* pitch);
+
+/** 3-D pitched malloc (see malloc2d_pitched()) */
+void*** malloc3d_pitched(size_t dim1, size_t dim2, size_t dim3,
+                         size_t data_size, size_t pitch_multiple,
+                         int avoid_aliasing, size_t* pitch);
+
+/** 3-D pitched calloc, padding included (see malloc2d_pitched()) */
+void*** calloc3d_pitched(size_t dim1, size_t dim2, size_t dim3,
+                         size_t data_size, size_t pitch_multiple,
+                         int avoid_aliasing, size_t* pitch);
+
+/** 4-D pitched malloc (see malloc2d_pitched()) */
+void**** malloc4d_pitched(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
+                          size_t data_size, size_t pitch_multiple,
+                          int avoid_aliasing, size_t* pitch);
+
+/** 4-D pitched calloc, padding included (see malloc2d_pitched()) */
+void**** calloc4d_pitched(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
+                          size_t data_size, size_t pitch_multiple,
+                          int avoid_aliasing, size_t* pitch);
+
+/** 5-D pitched malloc (see malloc2d_pitched()) */
+void***** malloc5d_pitched(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
+                           size_t dim5, size_t data_size, size_t pitch_multiple,
+                           int avoid_aliasing, size_t* pitch);
+
+/** 5-D pitched calloc, padding included (see malloc2d_pitched()) */
+void***** calloc5d_pitched(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
+                           size_t dim5, size_t data_size, size_t pitch_multiple,
+                           int avoid_aliasing, size_t* pitch);
+
+/** 6-D pitched malloc (see malloc2d_pitched()) */
+void****** malloc6d_pitched(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
+                            size_t dim5, size_t dim6, size_t data_size,
+                            size_t pitch_multiple, int avoid_aliasing,
+                            size_t* pitch);
+
+/** 6-D pitched calloc, padding included (see malloc2d_pitched()) */
+void****** calloc6d_pitched(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
+                            size_t dim5, size_t dim6, size_t data_size,
+                            size_t pitch_multiple, int avoid_aliasing,
+                            size_t* pitch);
+
+/**
+ * Maximum number of dimensions of an md_view (the pointer-table based
+ * functions, e.g. mallocNd(), have no such limit)
+ */
+#ifndef MD_MAX_NDIMS
+# define MD_MAX_NDIMS ( 8 )
 #endif
-    return ptr;
-}
 
-void** malloc2d(size_t dim1, size_t dim2, size_t data_size)
-{
-    size_t i, stride;
-    void** ptr;
-    unsigned char* p2;
-    stride = dim2*data_size;
-    ptr = malloc1d(dim1*sizeof(void*) + dim1*stride);
-    p2 = (unsigned char*)(ptr + dim1);
-    for(i=0; i<dim1; i++)
-        ptr[i] = &p2[i*stride];
-    return ptr;
-}
+/**
+ * A pointer-table free, strided, description of a multi-dimensional array
+ *
+ * Element [i][j]..[k] is found at data[i*strides[0] + j*strides[1] + ... +
+ * k*strides[ndims-1]] (strides are in elements, not bytes). Since no pointer
+ * tables are involved, each access is a single load; and for high-rank arrays
+ * with small inner dimensions, the memory that the tables would have otherwise
+ * occupied (which may exceed that of the data) is also saved.
+ *
+ * Views share the same contiguous row-major data layout as the FLATTENnD()
+ * block of the md arrays, so the two may be used interchangeably:
+ * \code{.c}
+ *   md_view view;
+ *   size_t dims[3] = {10, 20, 5};
+ *   float*** example3D = (float***)malloc3d(10, 20, 5, sizeof(float));
+ *   md_view_wrap(&view, FLATTEN3D(example3D), 3, dims, sizeof(float));
+ *   MD_VIEW_AT3D(float, &view, 3, 19, 2) = 22.0f; // same as example3D[3][19][2]
+ *   free(example3D);
+ *
+ *   // Or, without any pointer tables at all:
+ *   md_view_malloc(&view, 3, dims, sizeof(float));
+ *   memset(view.data, 0, 10*20*5*sizeof(float));
+ *   MD_VIEW_AT3D(float, &view, 3, 19, 2) = 22.0f;
+ *   md_view_free(&view);
+ * \endcode
+ */
+typedef struct _md_view {
+    void* data;                    /**< Flat contiguous 1-D block of data */
+    size_t ndims;                  /**< Number of dimensions */
+    size_t data_size;              /**< Size of each element, in bytes */
+    size_t dims[MD_MAX_NDIMS];     /**< Length of each dimension */
+    size_t strides[MD_MAX_NDIMS];  /**< Stride of each dimension, in elements */
+} md_view;
 
-void** calloc2d(size_t dim1, size_t dim2, size_t data_size)
-{
-    size_t i, stride;
-    void** ptr;
-    unsigned char* p2;
-    stride = dim2*data_size;
-    ptr = calloc1d(dim1, sizeof(void*) + stride);
-    p2 = (unsigned char*)(ptr + dim1);
-    for(i=0; i<dim1; i++)
-        ptr[i] = &p2[i*stride];
-    return ptr;
-}
+/** Offset (in elements) of element [i][j] of a 2-D md_view */
+#define MD_VIEW_OFFSET2D(V, i, j) \
+    ((i)*(V)->strides[0] + (j)*(V)->strides[1])
 
-void** realloc2d(void** ptr, size_t dim1, size_t dim2, size_t data_size)
-{
-    size_t i, stride;
-    unsigned char* p2;
-    stride = dim2*data_size;
-    ptr = realloc1d(ptr, dim1*sizeof(void*) + dim1*stride);
-    p2 = (unsigned char*)(ptr + dim1);
-    for(i=0;i<dim1;i++)
-        ptr[i] = &p2[i*stride];
-    return ptr;
-}
+/** Offset (in elements) of element [i][j][k] of a 3-D md_view */
+#define MD_VIEW_OFFSET3D(V, i, j, k) \
+    (MD_VIEW_OFFSET2D(V, i, j) + (k)*(V)->strides[2])
 
-void*** malloc3d(size_t dim1, size_t dim2, size_t dim3, size_t data_size)
-{
-    size_t i, j, stride1, stride2;
-    void*** ptr;
-    void** p2;
-    unsigned char* p3;
-    stride1 = dim2*dim3*data_size;
-    stride2 = dim3*data_size;
-    ptr = malloc1d(dim1*sizeof(void**) + dim1*dim2*sizeof(void*) + dim1*stride1);
-    p2 = (void**)(ptr + dim1);
-    p3 = (unsigned char*)(p2 + dim1*dim2);
-    for(i=0;i<dim1;i++)
-        ptr[i] = &p2[i*dim2];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            p2[i*dim2+j] = &p3[i*stride1 + j*stride2];
-    return ptr;
-}
+/** Offset (in elements) of element [i][j][k][l] of a 4-D md_view */
+#define MD_VIEW_OFFSET4D(V, i, j, k, l) \
+    (MD_VIEW_OFFSET3D(V, i, j, k) + (l)*(V)->strides[3])
 
-void*** calloc3d(size_t dim1, size_t dim2, size_t dim3, size_t data_size)
-{
-    size_t i, j, stride1, stride2;
-    void*** ptr;
-    void** p2;
-    unsigned char* p3;
-    stride1 = dim2*dim3*data_size;
-    stride2 = dim3*data_size;
-    ptr = calloc1d(dim1, sizeof(void**) + dim2*sizeof(void*) + stride1);
-    p2 = (void**)(ptr + dim1);
-    p3 = (unsigned char*)(p2 + dim1*dim2);
-    for(i=0;i<dim1;i++)
-        ptr[i] = &p2[i*dim2];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            p2[i*dim2+j] = &p3[i*stride1 + j*stride2];
-    return ptr;
-}
+/** Offset (in elements) of element [i][j][k][l][p] of a 5-D md_view */
+#define MD_VIEW_OFFSET5D(V, i, j, k, l, p) \
+    (MD_VIEW_OFFSET4D(V, i, j, k, l) + (p)*(V)->strides[4])
 
-void*** realloc3d(void*** ptr, size_t new_dim1, size_t new_dim2, size_t new_dim3, size_t data_size)
-{
-    size_t i, j, stride1, stride2;
-    void** p2;
-    unsigned char* p3;
-    stride1 = new_dim2*new_dim3*data_size;
-    stride2 = new_dim3*data_size;
-    ptr = realloc1d(ptr, new_dim1*sizeof(void**) + new_dim1*new_dim2*sizeof(void*) + new_dim1*stride1);
-    p2 = (void**)(ptr + new_dim1);
-    p3 = (unsigned char*)(p2 + new_dim1*new_dim2);
-    for(i=0;i<new_dim1;i++)
-        ptr[i] = &p2[i*new_dim2];
-    for(i=0;i<new_dim1;i++)
-        for(j=0;j<new_dim2;j++)
-            p2[i*new_dim2+j] = &p3[i*stride1 + j*stride2];
-    return ptr;
-}
+/** Offset (in elements) of element [i][j][k][l][p][q] of a 6-D md_view */
+#define MD_VIEW_OFFSET6D(V, i, j, k, l, p, q) \
+    (MD_VIEW_OFFSET5D(V, i, j, k, l, p) + (q)*(V)->strides[5])
 
-void**** malloc4d(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t data_size)
-{
-    size_t i, j, k, stride1, stride2, stride3;
-    void**** ptr;
-    void*** p2;
-    void** p3;
-    unsigned char* p4;
-    stride1 = dim2*dim3*dim4*data_size;
-    stride2 = dim3*dim4*data_size;
-    stride3 = dim4*data_size;
-    ptr = malloc1d(dim1*sizeof(void***) + dim1*dim2*sizeof(void**) + dim1*dim2*dim3*sizeof(void*) + dim1*stride1);
-    p2 = (void***)(ptr + dim1);
-    p3 = (void**)(p2 + dim1*dim2);
-    p4 = (unsigned char*)(p3 + dim1*dim2*dim3);
-    for(i=0;i<dim1;i++)
-        ptr[i] = &p2[i*dim2];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            p2[i*dim2+j] = &p3[i*dim2*dim3 + j*dim3];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            for(k=0;k<dim3;k++)
-                p3[i*dim2*dim3+j*dim3+k] = &p4[i*stride1 + j*stride2 + k*stride3];
-    return ptr;
-}
+/** Element [i][j] of a 2-D md_view of type "T" (may also be assigned to) */
+#define MD_VIEW_AT2D(T, V, i, j) \
+    (((T*)(V)->data)[MD_VIEW_OFFSET2D(V, i, j)])
 
-void**** calloc4d(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t data_size)
-{
-    size_t i, j, k, stride1, stride2, stride3;
-    void**** ptr;
-    void*** p2;
-    void** p3;
-    unsigned char* p4;
-    stride1 = dim2*dim3*dim4*data_size;
-    stride2 = dim3*dim4*data_size;
-    stride3 = dim4*data_size;
-    ptr = calloc1d(dim1, sizeof(void***) + dim2*sizeof(void**) + dim2*dim3*sizeof(void*) + stride1);
-    p2 = (void***)(ptr + dim1);
-    p3 = (void**)(p2 + dim1*dim2);
-    p4 = (unsigned char*)(p3 + dim1*dim2*dim3);
-    for(i=0;i<dim1;i++)
-        ptr[i] = &p2[i*dim2];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            p2[i*dim2+j] = &p3[i*dim2*dim3 + j*dim3];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            for(k=0;k<dim3;k++)
-                p3[i*dim2*dim3+j*dim3+k] = &p4[i*stride1 + j*stride2 + k*stride3];
-    return ptr;
-}
+/** Element [i][j][k] of a 3-D md_view of type "T" */
+#define MD_VIEW_AT3D(T, V, i, j, k) \
+    (((T*)(V)->data)[MD_VIEW_OFFSET3D(V, i, j, k)])
 
-void**** realloc4d(void**** ptr, size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t data_size)
-{
-    size_t i, j, k, stride1, stride2, stride3;
-    void*** p2;
-    void** p3;
-    unsigned char* p4;
-    stride1 = dim2*dim3*dim4*data_size;
-    stride2 = dim3*dim4*data_size;
-    stride3 = dim4*data_size;
-    ptr = realloc1d(ptr, dim1*sizeof(void***) + dim1*dim2*sizeof(void**) + dim1*dim2*dim3*sizeof(void*) + dim1*stride1);
-    p2 = (void***)(ptr + dim1);
-    p3 = (void**)(p2 + dim1*dim2);
-    p4 = (unsigned char*)(p3 + dim1*dim2*dim3);
-    for(i=0;i<dim1;i++)
-        ptr[i] = &p2[i*dim2];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            p2[i*dim2+j] = &p3[i*dim2*dim3 + j*dim3];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            for(k=0;k<dim3;k++)
-                p3[i*dim2*dim3+j*dim3+k] = &p4[i*stride1 + j*stride2 + k*stride3];
-    return ptr;
-}
+/** Element [i][j][k][l] of a 4-D md_view of type "T" */
+#define MD_VIEW_AT4D(T, V, i, j, k, l) \
+    (((T*)(V)->data)[MD_VIEW_OFFSET4D(V, i, j, k, l)])
 
-void***** malloc5d(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t data_size)
-{
-    size_t i, j, k, l, stride1, stride2, stride3, stride4;
-    void***** ptr;
-    void**** p2;
-    void*** p3;
-    void** p4;
-    unsigned char* p5;
-    stride1 = dim2*dim3*dim4*dim5*data_size;
-    stride2 = dim3*dim4*dim5*data_size;
-    stride3 = dim4*dim5*data_size;
-    stride4 = dim5*data_size;
-    ptr = malloc1d(dim1*sizeof(void****) + dim1*dim2*sizeof(void***) + dim1*dim2*dim3*sizeof(void**) + dim1*dim2*dim3*dim4*sizeof(void*) + dim1*stride1);
-    p2 = (void****)(ptr + dim1);
-    p3 = (void***)(p2 + dim1*dim2);
-    p4 = (void**)(p3 + dim1*dim2*dim3);
-    p5 = (unsigned char*)(p4 + dim1*dim2*dim3*dim4);
-    for(i=0;i<dim1;i++)
-        ptr[i] = &p2[i*dim2];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            p2[i*dim2+j] = &p3[i*dim2*dim3 + j*dim3];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            for(k=0;k<dim3;k++)
-                p3[i*dim2*dim3 + j*dim3 + k] = &p4[i*dim2*dim3*dim4 + j*dim3*dim4 + k*dim4];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            for(k=0;k<dim3;k++)
-                for(l=0;l<dim4;l++)
-                    p4[i*dim2*dim3*dim4 + j*dim3*dim4 + k*dim4 + l] = &p5[i*stride1 + j*stride2 + k*stride3 + l*stride4];
-    return ptr;
-}
+/** Element [i][j][k][l][p] of a 5-D md_view of type "T" */
+#define MD_VIEW_AT5D(T, V, i, j, k, l, p) \
+    (((T*)(V)->data)[MD_VIEW_OFFSET5D(V, i, j, k, l, p)])
 
-void***** calloc5d(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t data_size)
-{
-    size_t i, j, k, l, stride1, stride2, stride3, stride4;
-    void***** ptr;
-    void**** p2;
-    void*** p3;
-    void** p4;
-    unsigned char* p5;
-    stride1 = dim2*dim3*dim4*dim5*data_size;
-    stride2 = dim3*dim4*dim5*data_size;
-    stride3 = dim4*dim5*data_size;
-    stride4 = dim5*data_size;
-    ptr = calloc1d(dim1, sizeof(void****) + dim2*sizeof(void***) + dim2*dim3*sizeof(void**) + dim2*dim3*dim4*sizeof(void*) + stride1);
-    p2 = (void****)(ptr + dim1);
-    p3 = (void***)(p2 + dim1*dim2);
-    p4 = (void**)(p3 + dim1*dim2*dim3);
-    p5 = (unsigned char*)(p4 + dim1*dim2*dim3*dim4);
-    for(i=0;i<dim1;i++)
-        ptr[i] = &p2[i*dim2];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            p2[i*dim2+j] = &p3[i*dim2*dim3 + j*dim3];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            for(k=0;k<dim3;k++)
-                p3[i*dim2*dim3 + j*dim3 + k] = &p4[i*dim2*dim3*dim4 + j*dim3*dim4 + k*dim4];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            for(k=0;k<dim3;k++)
-                for(l=0;l<dim4;l++)
-                    p4[i*dim2*dim3*dim4 + j*dim3*dim4 + k*dim4 + l] = &p5[i*stride1 + j*stride2 + k*stride3 + l*stride4];
-    return ptr;
-}
+/** Element [i][j][k][l][p][q] of a 6-D md_view of type "T" */
+#define MD_VIEW_AT6D(T, V, i, j, k, l, p, q) \
+    (((T*)(V)->data)[MD_VIEW_OFFSET6D(V, i, j, k, l, p, q)])
 
-void***** realloc5d(void***** ptr, size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t data_size)
-{
-    size_t i, j, k, l, stride1, stride2, stride3, stride4;
-    void**** p2;
-    void*** p3;
-    void** p4;
-    unsigned char* p5;
-    stride1 = dim2*dim3*dim4*dim5*data_size;
-    stride2 = dim3*dim4*dim5*data_size;
-    stride3 = dim4*dim5*data_size;
-    stride4 = dim5*data_size;
-    ptr = realloc1d(ptr, dim1*sizeof(void****) + dim1*dim2*sizeof(void***) + dim1*dim2*dim3*sizeof(void**) + dim1*dim2*dim3*dim4*sizeof(void*) + dim1*stride1);
-    p2 = (void****)(ptr + dim1);
-    p3 = (void***)(p2 + dim1*dim2);
-    p4 = (void**)(p3 + dim1*dim2*dim3);
-    p5 = (unsigned char*)(p4 + dim1*dim2*dim3*dim4);
-    for(i=0;i<dim1;i++)
-        ptr[i] = &p2[i*dim2];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            p2[i*dim2+j] = &p3[i*dim2*dim3 + j*dim3];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            for(k=0;k<dim3;k++)
-                p3[i*dim2*dim3 + j*dim3 + k] = &p4[i*dim2*dim3*dim4 + j*dim3*dim4 + k*dim4];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            for(k=0;k<dim3;k++)
-                for(l=0;l<dim4;l++)
-                    p4[i*dim2*dim3*dim4 + j*dim3*dim4 + k*dim4 + l] = &p5[i*stride1 + j*stride2 + k*stride3 + l*stride4];
-    return ptr;
-}
+/**
+ * Describes the existing flat contiguous block "data" (e.g. FLATTEN3D() of an
+ * md array) as an "ndims" md_view with row-major strides (no memory is
+ * allocated)
+ */
+void md_view_wrap(md_view* view, void* data, size_t ndims, const size_t* dims,
+                  size_t data_size);
 
-void****** malloc6d(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t dim6, size_t data_size)
-{
-    size_t i, j, k, l, p, stride1, stride2, stride3, stride4, stride5;
-    void****** ptr;
-    void***** p2;
-    void**** p3;
-    void*** p4;
-    void** p5;
-    unsigned char* p6;
-    stride1 = dim2*dim3*dim4*dim5*dim6*data_size;
-    stride2 = dim3*dim4*dim5*dim6*data_size;
-    stride3 = dim4*dim5*dim6*data_size;
-    stride4 = dim5*dim6*data_size;
-    stride5 = dim6*data_size;
-    ptr = malloc1d(dim1*sizeof(void*****) + dim1*dim2*sizeof(void****) + dim1*dim2*dim3*sizeof(void***) +
-                   dim1*dim2*dim3*dim4*sizeof(void**) + dim1*dim2*dim3*dim4*dim5*sizeof(void*) + dim1*stride1);
-    p2 = (void*****)(ptr + dim1);
-    p3 = (void****)(p2 + dim1*dim2);
-    p4 = (void***)(p3 + dim1*dim2*dim3);
-    p5 = (void**)(p4 + dim1*dim2*dim3*dim4);
-    p6 = (unsigned char*)(p5 + dim1*dim2*dim3*dim4*dim5);
-    for(i=0;i<dim1;i++)
-        ptr[i] = &p2[i*dim2];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            p2[i*dim2+j] = &p3[i*dim2*dim3 + j*dim3];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            for(k=0;k<dim3;k++)
-                p3[i*dim2*dim3 + j*dim3 + k] = &p4[i*dim2*dim3*dim4 + j*dim3*dim4 + k*dim4];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            for(k=0;k<dim3;k++)
-                for(p=0;p<dim4;p++)
-                    p4[i*dim2*dim3*dim4 + j*dim3*dim4 + k*dim4 + p] = &p5[i*dim2*dim3*dim4*dim5 + j*dim3*dim4*dim5 + k*dim4*dim5 + p*dim5];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            for(k=0;k<dim3;k++)
-                for(l=0;l<dim4;l++)
-                    for(p=0;p<dim5;p++)
-                         p5[i*dim2*dim3*dim4*dim5 + j*dim3*dim4*dim5 + k*dim4*dim5 + l*dim5 + p] = &p6[i*stride1 + j*stride2 + k*stride3 + l*stride4 + p*stride5];
-    return ptr;
-}
+/**
+ * Allocates the data block of an "ndims" md_view, using malloc1d() (returns
+ * view->data, or NULL if this failed); use md_view_free() to deallocate
+ */
+void* md_view_malloc(md_view* view, size_t ndims, const size_t* dims,
+                     size_t data_size);
 
-void****** calloc6d(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t dim6, size_t data_size)
-{
-    size_t i, j, k, l, p, stride1, stride2, stride3, stride4, stride5;
-    void****** ptr;
-    void***** p2;
-    void**** p3;
-    void*** p4;
-    void** p5;
-    unsigned char* p6;
-    stride1 = dim2*dim3*dim4*dim5*dim6*data_size;
-    stride2 = dim3*dim4*dim5*dim6*data_size;
-    stride3 = dim4*dim5*dim6*data_size;
-    stride4 = dim5*dim6*data_size;
-    stride5 = dim6*data_size;
-    ptr = calloc1d(dim1, sizeof(void*****) + dim2*sizeof(void****) + dim2*dim3*sizeof(void***) +
-                   dim2*dim3*dim4*sizeof(void**) + dim2*dim3*dim4*dim5*sizeof(void*) + stride1);
-    p2 = (void*****)(ptr + dim1);
-    p3 = (void****)(p2 + dim1*dim2);
-    p4 = (void***)(p3 + dim1*dim2*dim3);
-    p5 = (void**)(p4 + dim1*dim2*dim3*dim4);
-    p6 = (unsigned char*)(p5 + dim1*dim2*dim3*dim4*dim5);
-    for(i=0;i<dim1;i++)
-        ptr[i] = &p2[i*dim2];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            p2[i*dim2+j] = &p3[i*dim2*dim3 + j*dim3];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            for(k=0;k<dim3;k++)
-                p3[i*dim2*dim3 + j*dim3 + k] = &p4[i*dim2*dim3*dim4 + j*dim3*dim4 + k*dim4];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            for(k=0;k<dim3;k++)
-                for(p=0;p<dim4;p++)
-                    p4[i*dim2*dim3*dim4 + j*dim3*dim4 + k*dim4 + p] = &p5[i*dim2*dim3*dim4*dim5 + j*dim3*dim4*dim5 + k*dim4*dim5 + p*dim5];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            for(k=0;k<dim3;k++)
-                for(l=0;l<dim4;l++)
-                    for(p=0;p<dim5;p++)
-                         p5[i*dim2*dim3*dim4*dim5 + j*dim3*dim4*dim5 + k*dim4*dim5 + l*dim5 + p] = &p6[i*stride1 + j*stride2 + k*stride3 + l*stride4 + p*stride5];
-    return ptr;
-}
+/** Same as md_view_malloc(), but zero-initialised using calloc1d() */
+void* md_view_calloc(md_view* view, size_t ndims, const size_t* dims,
+                     size_t data_size);
 
-void****** realloc6d(void****** ptr, size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t dim6, size_t data_size)
-{
-    size_t i, j, k, l, p, stride1, stride2, stride3, stride4, stride5;
-    void***** p2;
-    void**** p3;
-    void*** p4;
-    void** p5;
-    unsigned char* p6;
-    stride1 = dim2*dim3*dim4*dim5*dim6*data_size;
-    stride2 = dim3*dim4*dim5*dim6*data_size;
-    stride3 = dim4*dim5*dim6*data_size;
-    stride4 = dim5*dim6*data_size;
-    stride5 = dim6*data_size;
-    ptr = realloc1d(ptr, dim1*sizeof(void*****) + dim1*dim2*sizeof(void****) + dim1*dim2*dim3*sizeof(void***) +
-                    dim1*dim2*dim3*dim4*sizeof(void**) + dim1*dim2*dim3*dim4*dim5*sizeof(void*) + dim1*stride1);
-    p2 = (void*****)(ptr + dim1);
-    p3 = (void****)(p2 + dim1*dim2);
-    p4 = (void***)(p3 + dim1*dim2*dim3);
-    p5 = (void**)(p4 + dim1*dim2*dim3*dim4);
-    p6 = (unsigned char*)(p5 + dim1*dim2*dim3*dim4*dim5);
-    for(i=0;i<dim1;i++)
-        ptr[i] = &p2[i*dim2];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            p2[i*dim2+j] = &p3[i*dim2*dim3 + j*dim3];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            for(k=0;k<dim3;k++)
-                p3[i*dim2*dim3 + j*dim3 + k] = &p4[i*dim2*dim3*dim4 + j*dim3*dim4 + k*dim4];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            for(k=0;k<dim3;k++)
-                for(p=0;p<dim4;p++)
-                    p4[i*dim2*dim3*dim4 + j*dim3*dim4 + k*dim4 + p] = &p5[i*dim2*dim3*dim4*dim5 + j*dim3*dim4*dim5 + k*dim4*dim5 + p*dim5];
-    for(i=0;i<dim1;i++)
-        for(j=0;j<dim2;j++)
-            for(k=0;k<dim3;k++)
-                for(l=0;l<dim4;l++)
-                    for(p=0;p<dim5;p++)
-                         p5[i*dim2*dim3*dim4*dim5 + j*dim3*dim4*dim5 + k*dim4*dim5 + l*dim5 + p] = &p6[i*stride1 + j*stride2 + k*stride3 + l*stride4 + p*stride5];
-    return ptr;
-}
+/** Frees the data block of an md_view allocated with md_view_malloc() */
+void md_view_free(md_view* view);
+
+/** Offset (in elements) of the element at index[0]..index[ndims-1] */
+size_t md_view_offset(const md_view* view, const size_t* index);
+
+/** Total number of elements described by an md_view */
+size_t md_view_numel(const md_view* view);
+
+/** The indices taken along one axis by md_slice() and md_view_slice() */
+typedef struct _md_range {
+    size_t start;  /**< First index */
+    size_t count;  /**< Number of indices (ignored if "step" is 0) */
+    size_t step;   /**< Step between the indices; 0 fixes the axis at "start",
+                    *   which is then removed from the slice */
+} md_range;
+
+/**
+ * Returns a slice of the "ndims" md array "ptr", which shares its data;
+ * only new pointer tables are allocated, so this costs O(number of pointers)
+ * rather than O(number of elements). Returns NULL if a range is out of bounds,
+ * or the slice cannot be expressed with pointer tables (see below)
+ *
+ * The slice has one dimension for each axis with a non-zero "step", of length
+ * "count". Since each row of an md array must be contiguous, the last axis
+ * must be taken with a step of 1, and at least 2 axes must remain (a single
+ * row is simply &ptr[i]..[j][start]). md_view_slice() has neither restriction.
+ * The source is read through its own pointer tables, so it may itself be a
+ * slice, or a pitched/aligned array. e.g. all [band][time] for one channel,
+ * and every other time frame of bands 2..5:
+ * \code{.c}
+ *   float*** X = (float***)malloc3d(nBands, nCH, nTime, sizeof(float));
+ *   size_t dims[3] = {nBands, nCH, nTime};
+ *   md_range ch[3]  = { {0, nBands, 1}, {ch, 0, 0}, {0, nTime, 1} };
+ *   md_range sub[3] = { {2, 4, 1}, {0, nCH, 1}, {0, nTime, 1} };
+ *   float** Xch = (float**)md_slice((void*)X, 3, dims, ch, sizeof(float));
+ *   // Xch[band][t] == X[band][ch][t]
+ *   float*** Xsub = (float***)md_slice((void*)X, 3, dims, sub, sizeof(float));
+ *   // Xsub[b][c][t] == X[2+b][c][t]
+ *   free(Xch);  // (only frees the slice's tables)
+ *   free(Xsub);
+ * \endcode
+ * The source must outlive the slice; and the slice must not be reallocated,
+ * or passed to FLATTENnD() (its data is not one contiguous block).
+ */
+void* md_slice(void* ptr, size_t ndims, const size_t* dims,
+               const md_range* ranges, size_t data_size);
+
+/**
+ * 2-D slice of a 3-D array, with "axis" (0 or 1) fixed at "index" (see
+ * md_slice())
+ */
+void** md_slice3d(void*** ptr, size_t dim1, size_t dim2, size_t dim3,
+                  size_t axis, size_t index, size_t data_size);
+
+/**
+ * The "count1" x "count2" sub-array of a 2-D array starting at [first1][first2]
+ * (see md_slice())
+ */
+void** md_subarray2d(void** ptr, size_t dim1, size_t dim2, size_t first1,
+                     size_t first2, size_t count1, size_t count2,
+                     size_t data_size);
+
+/**
+ * The "count1" x "count2" x "count3" sub-array of a 3-D array starting at
+ * [first1][first2][first3] (see md_slice())
+ */
+void*** md_subarray3d(void*** ptr, size_t dim1, size_t dim2, size_t dim3,
+                      size_t first1, size_t first2, size_t first3,
+                      size_t count1, size_t count2, size_t count3,
+                      size_t data_size);
+
+/**
+ * Describes a slice of "src" as "view" (see md_range), sharing its data; any
+ * axis may be fixed, and any may be strided. Nothing is allocated. On error
+ * (a range out of bounds), "view" is zeroed
+ */
+void md_view_slice(md_view* view, const md_view* src, const md_range* ranges);
+
+/** Maximum rank counted separately by md_stats (higher ranks are included in
+ *  the last entry) */
+#define MD_STATS_MAX_RANK ( 8 )
+
+/** Allocation statistics (see md_stats_snapshot()) */
+typedef struct _md_stats {
+    size_t calls[3][MD_STATS_MAX_RANK];       /**< Number of calls, per
+                                               *   [MD_STATS_MALLOC/CALLOC/
+                                               *   REALLOC][rank-1] */
+    size_t large_calls[3][MD_STATS_MAX_RANK]; /**< Same as "calls", but only
+                                               *   those requesting at least
+                                               *   MD_MALLOC_STATS_LARGE_BYTES */
+    size_t bytes_requested; /**< Total bytes requested (tables and data) */
+    size_t table_bytes;     /**< Of which, bytes taken by pointer tables */
+    size_t table_build_ns;  /**< Total time spent filling pointer tables */
+    size_t frees;           /**< Number of free1d() calls */
+    size_t live_bytes;      /**< Bytes currently allocated (see free1d()) */
+    size_t peak_live_bytes; /**< Peak of "live_bytes" */
+    size_t elapsed_ns;      /**< Time since the statistics were last reset */
+} md_stats;
+
+/** Indices into md_stats::calls */
+enum {
+    MD_STATS_MALLOC = 0,
+    MD_STATS_CALLOC,
+    MD_STATS_REALLOC
+};
+
+/**
+ * Takes a snapshot of the allocation statistics
+ *
+ * The statistics are only kept if MD_MALLOC_ENABLE_STATS is defined where the
+ * implementation is compiled (otherwise, everything is zero). All counters are
+ * updated atomically, and so are safe to use from multiple threads. Note that
+ * "live_bytes" only decreases for arrays which are freed with md_free() (or
+ * free1d()); arrays released with plain free() remain counted, and so inflate
+ * it (and "peak_live_bytes"). It is also only tracked on platforms which can
+ * report the size of a malloc'd block (Linux, macOS and Windows). The times
+ * are monotonic where available, but only wall-clock (gettimeofday()) when
+ * compiled in strict ISO C modes such as -std=c99.
+ *
+ * e.g. the share of memory taken by pointer tables, and the rate of large 3-D
+ * allocations:
+ * \code{.c}
+ *   md_stats stats;
+ *   md_stats_snapshot(&stats);
+ *   printf("%.1f%% overhead\n", 100.0*stats.table_bytes/stats.bytes_requested);
+ *   printf("%.1f calls/s\n", stats.large_calls[MD_STATS_MALLOC][2]/(stats.elapsed_ns*1e-9));
+ * \endcode
+ */
+void md_stats_snapshot(md_stats* stats);
+
+/**
+ * Resets the allocation statistics (except for "live_bytes", which continues
+ * to be tracked; "peak_live_bytes" is reset to the current "live_bytes")
+ */
+void md_stats_reset(void);
+
+/**
+ * A preallocated region of memory, from which md arrays may be allocated
+ * without calling the system allocator (e.g. from a real-time audio callback)
+ *
+ * Each allocation simply moves an offset forward and fills in the pointer
+ * tables; there are no locks, and (since the whole region is touched when it
+ * is created) no page faults. Arrays are not freed individually; instead, the
+ * whole arena is reset at once (e.g. at the start of each processing block),
+ * or rewound back to a previously taken mark (e.g. at the end of a nested
+ * scope):
+ * \code{.c}
+ *   md_arena arena;
+ *   md_arena_create(&arena, 1<<20, 32);    // during initialisation
+ *
+ *   // in the processing callback:
+ *   md_arena_reset(&arena);
+ *   float** X = (float**)calloc2d_arena(&arena, nCH, blocksize, sizeof(float));
+ *   {
+ *       size_t mark = md_arena_mark(&arena);
+ *       float*** tmp = (float***)malloc3d_arena(&arena, nBands, nCH, 2, sizeof(float));
+ *       ...
+ *       md_arena_rewind(&arena, mark);      // "tmp" is gone, "X" is not
+ *   }
+ *
+ *   md_arena_destroy(&arena);               // during clean-up
+ * \endcode
+ * A single arena must not be used by multiple threads at the same time.
+ */
+typedef struct _md_arena {
+    unsigned char* base;  /**< Start of the region */
+    size_t capacity;      /**< Size of the region, in bytes */
+    size_t offset;        /**< Bytes of the region currently in use */
+    size_t alignment;     /**< Alignment of the data block of each array */
+    void* block;          /**< What md_arena_destroy() frees (or NULL) */
+} md_arena;
+
+/**
+ * Allocates (and pre-faults) an arena of "capacity" bytes, in which the data
+ * block of each array will start on an "alignment" byte boundary (power of 2,
+ * or 0 for the default; returns arena->base, or NULL if this failed)
+ */
+void* md_arena_create(md_arena* arena, size_t capacity, size_t alignment);
 
+/**
+ * Uses the existing "buffer" of "capacity" bytes as an arena (e.g. a static
+ * buffer; md_arena_destroy() will not free it)
+ */
+void md_arena_wrap(md_arena* arena, void* buffer, size_t capacity,
+                   size_t alignment);
+
+/** Frees the memory of an arena allocated with md_arena_create() */
+void md_arena_destroy(md_arena* arena);
+
+/** Releases all arrays allocated from an arena (O(1)) */
+void md_arena_reset(md_arena* arena);
+
+/** Returns the current position of an arena, for md_arena_rewind() */
+size_t md_arena_mark(const md_arena* arena);
+
+/** Releases all arrays allocated from an arena since "mark" was taken */
+void md_arena_rewind(md_arena* arena, size_t mark);
+
+/** Number of bytes of an arena which are still free */
+size_t md_arena_remaining(const md_arena* arena);
+
+/**
+ * Allocates an "ndims" array from an arena (same layout as mallocNd()); returns
+ * NULL if the arena does not have enough room left (silently, even in debug
+ * builds; check md_arena_remaining()). The pointer tables are always filled in
+ * by the calling thread, regardless of MD_MALLOC_OPENMP_THRESHOLD
+ */
+void* mallocNd_arena(md_arena* arena, size_t ndims, const size_t* dims,
+                     size_t data_size);
+
+/** Same as mallocNd_arena(), but with the data zero-initialised */
+void* callocNd_arena(md_arena* arena, size_t ndims, const size_t* dims,
+                     size_t data_size);
+
+/** 2-D malloc from an arena (see md_arena) */
+void** malloc2d_arena(md_arena* arena, size_t dim1, size_t dim2,
+                      size_t data_size);
+
+/** 2-D calloc from an arena (see md_arena) */
+void** calloc2d_arena(md_arena* arena, size_t dim1, size_t dim2,
+                      size_t data_size);
+
+/** 3-D malloc from an arena (see md_arena) */
+void*** malloc3d_arena(md_arena* arena, size_t dim1, size_t dim2, size_t dim3,
+                       size_t data_size);
+
+/** 3-D calloc from an arena (see md_arena) */
+void*** calloc3d_arena(md_arena* arena, size_t dim1, size_t dim2, size_t dim3,
+                       size_t data_size);
+
+/** 4-D malloc from an arena (see md_arena) */
+void**** malloc4d_arena(md_arena* arena, size_t dim1, size_t dim2, size_t dim3,
+                        size_t dim4, size_t data_size);
+
+/** 4-D calloc from an arena (see md_arena) */
+void**** calloc4d_arena(md_arena* arena, size_t dim1, size_t dim2, size_t dim3,
+                        size_t dim4, size_t data_size);
+
+/** 5-D malloc from an arena (see md_arena) */
+void***** malloc5d_arena(md_arena* arena, size_t dim1, size_t dim2, size_t dim3,
+                         size_t dim4, size_t dim5, size_t data_size);
+
+/** 5-D calloc from an arena (see md_arena) */
+void***** calloc5d_arena(md_arena* arena, size_t dim1, size_t dim2, size_t dim3,
+                         size_t dim4, size_t dim5, size_t data_size);
+
+/** 6-D malloc from an arena (see md_arena) */
+void****** malloc6d_arena(md_arena* arena, size_t dim1, size_t dim2,
+                          size_t dim3, size_t dim4, size_t dim5, size_t dim6,
+                          size_t data_size);
+
+/** 6-D calloc from an arena (see md_arena) */
+void****** calloc6d_arena(md_arena* arena, size_t dim1, size_t dim2,
+                          size_t dim3, size_t dim4, size_t dim5, size_t dim6,
+                          size_t data_size);
+
+/** Bytes between the producer and consumer indices of an md_ring */
+#define MD_RING_PAD ( 64 )
+
+/**
+ * A lock-free single-producer/single-consumer queue of "nframes" preallocated
+ * md arrays ("frames") of one shape, for passing blocks between the threads of
+ * a pipeline (e.g. capture -> DSP -> output)
+ *
+ * All of the frames are allocated (and pre-faulted) in one block when the ring
+ * is created, each with the same layout as mallocNd() and starting on its own
+ * cache line. The producer thread then fills in the next free frame and
+ * commits it, and the consumer thread reads the oldest committed frame and
+ * releases it; neither side allocates, locks or copies anything:
+ * \code{.c}
+ *   md_ring ring;
+ *   size_t dims[2] = {nCH, blocksize};
+ *   md_ring_create(&ring, 8, 2, dims, sizeof(float));   // during initialisation
+ *
+ *   // capture thread:
+ *   float** in = (float**)md_ring_acquire_write(&ring);
+ *   if(in!=NULL){                                        // (NULL if full)
+ *       capture(in);
+ *       md_ring_commit_write(&ring);
+ *   }
+ *
+ *   // DSP thread:
+ *   float** x = (float**)md_ring_acquire_read(&ring);
+ *   if(x!=NULL){                                         // (NULL if empty)
+ *       process(x);
+ *       md_ring_release_read(&ring);
+ *   }
+ *
+ *   md_ring_destroy(&ring);                              // during clean-up
+ * \endcode
+ * The frame counters are updated with release stores and read with acquire
+ * loads, so a committed frame's contents are visible to the consumer, and a
+ * released frame is not overwritten while it is still being read. Each counter
+ * sits on its own cache line (along with the other side's last seen counter),
+ * so the two threads only share a line when one has to check on the other.
+ */
+typedef struct _md_ring {
+    unsigned char* base;   /**< The first frame */
+    size_t nframes;        /**< Number of frames */
+    size_t stride;         /**< Bytes from one frame to the next */
+    void* block;           /**< What md_ring_destroy() frees (or NULL) */
+    char pad0[MD_RING_PAD];
+    volatile size_t head;  /**< Frames committed (written by the producer) */
+    size_t tail_seen;      /**< The producer's last read of "tail" */
+    char pad1[MD_RING_PAD];
+    volatile size_t tail;  /**< Frames released (written by the consumer) */
+    size_t head_seen;      /**< The consumer's last read of "head" */
+    char pad2[MD_RING_PAD];
+} md_ring;
+
+/**
+ * Allocates a ring of "nframes" frames of the "ndims" shape "dims" (returns
+ * the first frame, or NULL if this failed). The frames are zero-initialised
+ */
+void* md_ring_create(md_ring* ring, size_t nframes, size_t ndims,
+                     const size_t* dims, size_t data_size);
+
+/** Frees the frames of a ring allocated with md_ring_create() */
+void md_ring_destroy(md_ring* ring);
+
+/**
+ * Returns the next frame to be filled in by the producer (the same frame until
+ * it is committed), or NULL if all of the frames are waiting to be read
+ */
+void* md_ring_acquire_write(md_ring* ring);
+
+/** Passes the frame from md_ring_acquire_write() on to the consumer */
+void md_ring_commit_write(md_ring* ring);
+
+/**
+ * Returns the oldest committed frame, for the consumer (the same frame until
+ * it is released), or NULL if there are none
+ */
+void* md_ring_acquire_read(md_ring* ring);
+
+/** Hands the frame from md_ring_acquire_read() back to the producer */
+void md_ring_release_read(md_ring* ring);
+
+/** Returns the number of frames committed, but not yet released */
+size_t md_ring_count(md_ring* ring);
+
+/**
+ * An md array whose first dimension may be appended to (e.g. frames which are
+ * accumulated into a [frame][sample] array), with room reserved for "capacity"
+ * slabs along dim1
+ *
+ * realloc2d_preserve() by one row at a time costs O(dim1*dim2) per append,
+ * since the pointer table at the front of the block grows, and so the data
+ * must be moved and every row pointer rebuilt. Here, the block (pointer tables
+ * and data) is laid out for "capacity" slabs up front, so appending within the
+ * capacity simply bumps dims[0]; once full, the capacity is doubled, which
+ * keeps the cost of appending amortised O(1) per slab. The array has the same
+ * layout as one from mallocNd() with dims[0] = capacity, and is indexed as
+ * usual:
+ * \code{.c}
+ *   md_grow grow;
+ *   size_t dims[2] = {0, frameLen};
+ *   md_grow_create(&grow, 2, dims, 64, sizeof(float)); // room for 64 frames
+ *   while(capture(frame))
+ *       md_grow_append(&grow, frame, 1);                 // copies 1 frame in
+ *   float** X = (float**)grow.array;                     // X[grow.dims[0]-1][frameLen-1]
+ *   md_grow_shrink_to_fit(&grow);                        // (optional)
+ *   md_grow_destroy(&grow);
+ * \endcode
+ * Note that "array" moves whenever the capacity changes, so any copies of it
+ * should be refreshed after each call that may grow or shrink the block.
+ */
+typedef struct _md_grow {
+    void* array;                /**< The array (as from mallocNd()) */
+    size_t ndims;               /**< Number of dimensions */
+    size_t data_size;           /**< Size of each element, in bytes */
+    size_t dims[MD_MAX_NDIMS];  /**< Current shape; dims[0] is the slab count */
+    size_t capacity;            /**< Slabs which fit before "array" must move */
+} md_grow;
+
+/**
+ * Allocates an array of the "ndims" shape "dims" (dims[0] may be 0), with room
+ * for at least "capacity" slabs along dim1 (returns the array, or NULL if this
+ * failed). The array is left uninitialised
+ */
+void* md_grow_create(md_grow* grow, size_t ndims, const size_t* dims,
+                     size_t capacity, size_t data_size);
+
+/** Frees an array allocated with md_grow_create() */
+void md_grow_destroy(md_grow* grow);
+
+/**
+ * Ensures there is room for at least "capacity" slabs, moving the array only
+ * if there is not (returns the array, or NULL if this failed; in which case
+ * it is left as it was)
+ */
+void* md_grow_reserve(md_grow* grow, size_t capacity);
+
+/**
+ * Sets the number of slabs to "dim1", growing the capacity geometrically if
+ * it is exceeded (returns the array, or NULL if this failed; in which case it
+ * is left as it was). Any new slabs are left uninitialised, and shrinking
+ * keeps the capacity
+ */
+void* md_grow_resize(md_grow* grow, size_t dim1);
+
+/**
+ * Appends "count" slabs to the end of the array, copied from the flat block
+ * "slabs" (of count*dims[1]*..*dims[ndims-1] elements), or left uninitialised
+ * if it is NULL (returns the array, or NULL if this failed; in which case it
+ * is left as it was)
+ */
+void* md_grow_append(md_grow* grow, const void* slabs, size_t count);
+
+/**
+ * Releases the capacity beyond the current number of slabs (returns the
+ * array, or NULL if this failed; in which case it is left as it was)
+ */
+void* md_grow_shrink_to_fit(md_grow* grow);
+
+/** Describes one of the arrays of a batch (see md_malloc_batch()) */
+typedef struct _md_batch_desc {
+    size_t ndims;         /**< Number of dimensions (1 for a flat array) */
+    const size_t* dims;   /**< The "ndims" dimension lengths */
+    size_t data_size;     /**< Size of each element, in bytes */
+    size_t alignment;     /**< Alignment of the data block (power of 2, or 0
+                           *   for the default) */
+} md_batch_desc;
+
+/**
+ * Allocates "count" arrays of different ranks and shapes (each with the same
+ * layout as mallocNd()) in one contiguous block; returns the block, or NULL
+ * if it could not be allocated, or a descriptor is invalid
+ *
+ * The pointer tables of all the arrays come first, followed by their data
+ * blocks, in the order given (each starting on its own "alignment" boundary);
+ * so arrays which are processed together are also adjacent in memory. The
+ * arrays are returned via "arrays", and are all freed at once by passing the
+ * returned block to md_free() (or free1d()/free()); they must not be freed or
+ * reallocated individually:
+ * \code{.c}
+ *   size_t xDims[2] = {nCH, blocksize}, hDims[3] = {nBands, nCH, nTaps};
+ *   md_batch_desc descs[2] = { {2, xDims, sizeof(float), 32},
+ *                              {3, hDims, sizeof(float), 32} };
+ *   void* arrays[2];
+ *   void* block = md_malloc_batch(2, descs, arrays);
+ *   float** X = (float**)arrays[0];
+ *   float*** H = (float***)arrays[1];
+ *   ...
+ *   md_free(block);
+ * \endcode
+ */
+void* md_malloc_batch(size_t count, const md_batch_desc* descs, void** arrays);
+
+/** Same as md_malloc_batch(), but with the data zero-initialised */
+void* md_calloc_batch(size_t count, const md_batch_desc* descs, void** arrays);
+
+/**
+ * Returns the number of bytes md_malloc_batch() would need for the arrays of
+ * "descs" (pointer tables, data, and alignment padding), or 0 if a descriptor
+ * is invalid
+ */
+size_t md_sizeof_batch(size_t count, const md_batch_desc* descs);
+
+/**
+ * Writes the transpose of the "dim1" x "dim2" array "src" into the "dim2" x
+ * "dim1" array "dst" (i.e. dst[j][i] = src[i][j]); if "dst" is NULL, it is
+ * allocated as with malloc2d() (but never from a recycling cache, nor huge
+ * page backed, so it may always be freed with free()). Returns "dst" (or NULL if it could not be
+ * allocated)
+ *
+ * This operates directly on the data blocks (FLATTEN2D), in cache-sized tiles,
+ * which are transposed in SIMD registers for 4, 8 (float, double, float
+ * complex) and 16 byte (double complex) elements, if MD_MALLOC_ENABLE_SIMD is
+ * defined; and is split across threads for large arrays, if
+ * MD_MALLOC_ENABLE_OPENMP is defined. Both arrays must have the default layout
+ * (i.e. not pitched or with aligned rows), and must not overlap.
+ */
+void** md_transpose2d(void** dst, void** src, size_t dim1, size_t dim2,
+                      size_t data_size);
+
+/**
+ * Writes a copy of the "ndims" array "src", with its axes reordered by "perm",
+ * into "dst"; or, if "dst" is NULL, into a new array allocated as with
+ * mallocNd() (but never from a recycling cache, nor huge page backed, so it
+ * may always be freed with free()). Returns "dst" (or NULL if it could not be
+ * allocated, or "perm" is not a permutation of 0..ndims-1)
+ *
+ * Axis "l" of "dst" is axis "perm[l]" of "src"; so "dst" must have the
+ * dimensions {dims[perm[0]], dims[perm[1]], ...}. For example, reordering
+ * [band][ch][time] into [ch][band][time]:
+ * \code{.c}
+ *   size_t perm[3] = {1, 0, 2};
+ *   float*** Y = (float***)md_permute3d(NULL, (void***)X, nBands, nCH, nTime, perm, sizeof(float));
+ *   // Y[ch][band][t] == X[band][ch][t]
+ * \endcode
+ * Axes which stay in order are merged and copied row by row; otherwise the
+ * data is transposed in tiles, as with md_transpose2d() (with the same
+ * requirements).
+ */
+void* md_permuteNd(void* dst, void* src, size_t ndims, const size_t* dims,
+                   const size_t* perm, size_t data_size);
+
+/** 3-D axis permutation (see md_permuteNd()) */
+void*** md_permute3d(void*** dst, void*** src, size_t dim1, size_t dim2,
+                     size_t dim3, const size_t* perm, size_t data_size);
+
+/** 4-D axis permutation (see md_permuteNd()) */
+void**** md_permute4d(void**** dst, void**** src, size_t dim1, size_t dim2,
+                      size_t dim3, size_t dim4, const size_t* perm,
+                      size_t data_size);
+
+/** 5-D axis permutation (see md_permuteNd()) */
+void***** md_permute5d(void***** dst, void***** src, size_t dim1, size_t dim2,
+                       size_t dim3, size_t dim4, size_t dim5,
+                       const size_t* perm, size_t data_size);
+
+/** 6-D axis permutation (see md_permuteNd()) */
+void****** md_permute6d(void****** dst, void****** src, size_t dim1,
+                        size_t dim2, size_t dim3, size_t dim4, size_t dim5,
+                        size_t dim6, const size_t* perm, size_t data_size);
+
+/** Alignment of the data planes of the _split_complex arrays, in bytes */
+#define MD_SPLIT_COMPLEX_ALIGNMENT ( 64 )
+
+/**
+ * Allocates an "ndims" complex array in split (planar) form: i.e. as two md
+ * arrays of the same shape, one holding the real parts and the other the
+ * imaginary parts, each of "real_size" bytes (e.g. sizeof(float)). Returns the
+ * real array, with the imaginary array returned via "im"; or NULL if it could
+ * not be allocated
+ *
+ * Both arrays (pointer tables and data) come from one block, which starts with
+ * the real array; so the pair is freed at once by passing the real array to
+ * md_free() (or free()). Each data plane is contiguous (FLATTENnD) and, for
+ * ndims>=2, starts on an MD_SPLIT_COMPLEX_ALIGNMENT byte boundary. This layout
+ * lets complex arithmetic be vectorised without shuffling the real and
+ * imaginary parts apart first:
+ * \code{.c}
+ *   float*** Xim;
+ *   float*** Xre = (float***)malloc3d_split_complex(nBands, nCH, nTime, sizeof(float), (void****)&Xim);
+ *   md_deinterleave_complex(FLATTEN3D(Xre), FLATTEN3D(Xim), FLATTEN3D(X), nBands*nCH*nTime, sizeof(float));
+ *   ... // Xre[band][ch][t], Xim[band][ch][t]
+ *   md_free(Xre);
+ * \endcode
+ */
+void* mallocNd_split_complex(size_t ndims, const size_t* dims,
+                             size_t real_size, void** im);
+
+/** Same as mallocNd_split_complex(), but with both planes zero-initialised */
+void* callocNd_split_complex(size_t ndims, const size_t* dims,
+                             size_t real_size, void** im);
+
+/** 2-D split complex malloc (see mallocNd_split_complex()) */
+void** malloc2d_split_complex(size_t dim1, size_t dim2, size_t real_size,
+                              void*** im);
+
+/** 2-D split complex calloc (see mallocNd_split_complex()) */
+void** calloc2d_split_complex(size_t dim1, size_t dim2, size_t real_size,
+                              void*** im);
+
+/** 3-D split complex malloc (see mallocNd_split_complex()) */
+void*** malloc3d_split_complex(size_t dim1, size_t dim2, size_t dim3,
+                               size_t real_size, void**** im);
+
+/** 3-D split complex calloc (see mallocNd_split_complex()) */
+void*** calloc3d_split_complex(size_t dim1, size_t dim2, size_t dim3,
+                               size_t real_size, void**** im);
+
+/** 4-D split complex malloc (see mallocNd_split_complex()) */
+void**** malloc4d_split_complex(size_t dim1, size_t dim2, size_t dim3,
+                                size_t dim4, size_t real_size, void***** im);
+
+/** 4-D split complex calloc (see mallocNd_split_complex()) */
+void**** calloc4d_split_complex(size_t dim1, size_t dim2, size_t dim3,
+                                size_t dim4, size_t real_size, void***** im);
+
+/** 5-D split complex malloc (see mallocNd_split_complex()) */
+void***** malloc5d_split_complex(size_t dim1, size_t dim2, size_t dim3,
+                                 size_t dim4, size_t dim5, size_t real_size,
+                                 void****** im);
+
+/** 5-D split complex calloc (see mallocNd_split_complex()) */
+void***** calloc5d_split_complex(size_t dim1, size_t dim2, size_t dim3,
+                                 size_t dim4, size_t dim5, size_t real_size,
+                                 void****** im);
+
+/** 6-D split complex malloc (see mallocNd_split_complex()) */
+void****** malloc6d_split_complex(size_t dim1, size_t dim2, size_t dim3,
+                                  size_t dim4, size_t dim5, size_t dim6,
+                                  size_t real_size, void******* im);
+
+/** 6-D split complex calloc (see mallocNd_split_complex()) */
+void****** calloc6d_split_complex(size_t dim1, size_t dim2, size_t dim3,
+                                  size_t dim4, size_t dim5, size_t dim6,
+                                  size_t real_size, void******* im);
+
+/**
+ * Splits "n" interleaved complex numbers ({re, im} pairs of "real_size" bytes
+ * each) into the separate planes "re" and "im"
+ *
+ * This is done in SIMD registers for float and double parts, if
+ * MD_MALLOC_ENABLE_SIMD is defined. The buffers must not overlap.
+ */
+void md_deinterleave_complex(void* re, void* im, const void* interleaved,
+                             size_t n, size_t real_size);
+
+/**
+ * Merges the planes "re" and "im" (of "n" parts of "real_size" bytes each) into
+ * "n" interleaved complex numbers (see md_deinterleave_complex())
+ */
+void md_interleave_complex(void* interleaved, const void* re, const void* im,
+                           size_t n, size_t real_size);
+
+/** Element types of the bulk operations (md_set(), md_copy(), ...) */
+enum {
+    MD_FLOAT = 0,      /**< float */
+    MD_DOUBLE,         /**< double */
+    MD_FLOAT_COMPLEX,  /**< {float re, im} pairs (e.g. float _Complex) */
+    MD_DOUBLE_COMPLEX  /**< {double re, im} pairs (e.g. double _Complex) */
+};
+
+/**
+ * Sets every element of the "ndims" array "ptr" to "*value" (of the element
+ * "type"; e.g. a float for MD_FLOAT, or two for MD_FLOAT_COMPLEX)
+ *
+ * The bulk operations (md_set(), md_copy(), md_scale(), md_axpy() and md_mul())
+ * run over the whole data block (FLATTENnD) in one pass, rather than through
+ * the pointer tables; so the arrays must have the default layout (i.e. not
+ * pitched or with aligned rows), and "ndims" may be 1 for flat arrays. They
+ * are vectorised with AVX-512/AVX2/SSE2 or NEON, if MD_MALLOC_ENABLE_SIMD is
+ * defined, and split across threads for large arrays, if
+ * MD_MALLOC_ENABLE_OPENMP is defined. Arrays which are only written to (by
+ * md_set(), md_copy(), and md_mul() into a separate array) and are larger than
+ * the stream threshold (see md_stream_set_threshold()) are written with
+ * non-temporal stores on x86-64; so that filling them does not evict the rest
+ * of the working set from the caches:
+ * \code{.c}
+ *   float zero = 0.0f, g = 0.5f;
+ *   size_t dims[3] = {nBands, nCH, nTime};
+ *   md_set((void*)Y, 3, dims, MD_FLOAT, &zero);
+ *   md_axpy((void*)Y, (void*)X, 3, dims, MD_FLOAT, &g);  // Y += 0.5*X
+ * \endcode
+ */
+void md_set(void* ptr, size_t ndims, const size_t* dims, int type,
+            const void* value);
+
+/** dst = src, element-wise; the arrays must not overlap (see md_set()) */
+void md_copy(void* dst, const void* src, size_t ndims, const size_t* dims,
+             int type);
+
+/** ptr = (*alpha)*ptr, element-wise (see md_set()) */
+void md_scale(void* ptr, size_t ndims, const size_t* dims, int type,
+              const void* alpha);
+
+/** y = y + (*alpha)*x, element-wise (see md_set()) */
+void md_axpy(void* y, const void* x, size_t ndims, const size_t* dims,
+             int type, const void* alpha);
+
+/**
+ * dst = a*b, element-wise (complex multiplication for the complex types);
+ * "dst" may be "a" or "b", but must not otherwise overlap them (see md_set())
+ */
+void md_mul(void* dst, const void* a, const void* b, size_t ndims,
+            const size_t* dims, int type);
+
+/**
+ * Sets the size (in bytes) of the arrays from which md_set(), md_copy() and
+ * md_mul() use non-temporal stores; (size_t)-1 disables them, and 0 restores
+ * the default: the size of the last-level cache, where it can be queried, or
+ * otherwise MD_MALLOC_STREAM_THRESHOLD (8 MiB)
+ */
+void md_stream_set_threshold(size_t bytes);
+
+/**
+ * Sets the maximum number of bytes kept by the recycling cache (0 disables it,
+ * which is the default, and frees everything it holds)
+ *
+ * While the cache is enabled, arrays allocated by mallocNd()/callocNd() (and
+ * so malloc2d()..calloc6d()) are remembered, and when freed with md_free(),
+ * their memory is kept on a free list for that exact shape (rank, dims and
+ * data_size). A later request for the same shape then gets the block back
+ * with its pointer tables already built; skipping both the system allocator
+ * and the table construction (calloc requests only re-zero the data). This
+ * suits code which repeatedly allocates and frees arrays of the same shapes:
+ * \code{.c}
+ *   md_cache_set_limit(64<<20);  // keep up to 64 MiB of freed arrays
+ *   for(n=0; n<nBlocks; n++){
+ *       float** X = (float**)malloc2d(290, 300, sizeof(float)); // only the
+ *       ...                                                      // first call
+ *       md_free(X);                                              // allocates
+ *   }
+ *   md_cache_set_limit(0);
+ * \endcode
+ * Arrays allocated while the cache is enabled must not have their pointer
+ * tables modified, and MUST be freed with md_free() (or free1d()), never with
+ * free(): each starts a few bytes into its block (md_free() finds it, and its
+ * shape, in a registry keyed by its address), so free() would be passed an
+ * address which malloc() never returned. They may still be reallocated by the
+ * realloc functions of this header, and stay recyclable under their new shape.
+ * All cache functions are thread-safe.
+ */
+void md_cache_set_limit(size_t max_bytes);
+
+/**
+ * Frees cached blocks until at most "max_bytes" remain in the cache (returns
+ * the number of bytes released)
+ */
+size_t md_cache_trim(size_t max_bytes);
+
+/**
+ * Returns the number of bytes currently held by the recycling cache, and
+ * optionally the number of hits/misses since it was last enabled
+ */
+size_t md_cache_info(size_t* hits, size_t* misses);
+
+/**
+ * Frees an array allocated by any of the functions in this header (except
+ * those taken from an md_arena). If the recycling cache is enabled (see
+ * md_cache_set_limit()), and there is room, the array is kept for reuse
+ *
+ * Arrays which MUST be freed with md_free() (or free1d()), rather than free():
+ * those from the _huge and md_mmap functions, and those from mallocNd() and
+ * callocNd() (and so malloc2d()..calloc6d()) allocated while a recycling
+ * cache (md_cache_set_limit(), md_tcache_set_limit()) or huge page threshold
+ * (md_huge_set_threshold()) is enabled. Any other array may be freed with
+ * either.
+ */
+void md_free(void* ptr);
+
+/**
+ * Enables per-thread recycling caches, each holding up to "max_bytes" of
+ * freed arrays (0 disables them, which is the default, and frees everything
+ * they hold). Requires MD_MALLOC_ENABLE_THREAD_CACHE, otherwise this does
+ * nothing
+ *
+ * This works the same as md_cache_set_limit(), except that each thread
+ * allocates from (and frees into) its own cache; so threads which repeatedly
+ * allocate and free arrays do not contend for the global cache lock. An array
+ * freed by a thread other than the one which allocated it is returned to its
+ * owner's cache (or freed, if the owner has exited or its cache is full). A
+ * thread's cache is emptied when the thread exits. While enabled, these caches
+ * take precedence over the global cache, for arrays of 2 to 6 dimensions.
+ *
+ * As with the global cache, these arrays start a few bytes into their block,
+ * and are registered (in a registry split into independently locked parts)
+ * along with their owning cache; so freeing one takes only the lock of its
+ * part of the registry and that of its owner, and they must NEVER be released
+ * with free(); only md_free() or free1d().
+ */
+void md_tcache_set_limit(size_t max_bytes);
+
+/**
+ * Frees the blocks held by the caches of all threads (returns the number of
+ * bytes released)
+ */
+size_t md_tcache_flush(void);
+
+/**
+ * Returns the number of bytes currently held by the caches of all threads,
+ * and optionally their total number of hits/misses since they were enabled
+ */
+size_t md_tcache_info(size_t* hits, size_t* misses);
+
+/**
+ * Sets the size (in bytes, including pointer tables) from which mallocNd()
+ * and callocNd() (and so malloc2d()..calloc6d()) use the huge page backend of
+ * mallocNd_huge(); 0 disables this, which is the default
+ *
+ * WARNING: this is strictly opt-in, since it changes how those arrays must be
+ * freed. Once set, any array at or above the threshold is mapped directly
+ * from the OS rather than malloc()'d, and so must be freed with md_free() or
+ * free1d(); passing it to free() is undefined behaviour (typically a crash).
+ * Only enable it if every array of that size in the program (including those
+ * from third party code using this header) is released with md_free(). Arrays
+ * allocated internally by this header (e.g. md_transpose2d(NULL, ...) and
+ * md_permuteNd(NULL, ...)) are never mapped, and may still be freed with
+ * free().
+ */
+void md_huge_set_threshold(size_t bytes);
+
+/**
+ * Allocates an "ndims" array (same layout as mallocNd()) in memory mapped
+ * directly from the OS, starting on a 2 MiB boundary, and backed by huge pages
+ * where available
+ *
+ * With 4 KiB pages, random access into very large arrays (e.g. a 290 x 300 x
+ * 295 float array is ~100 MB) causes many dTLB misses; each 2 MiB huge page
+ * covers 512 times as much memory. Explicitly reserved huge pages (Linux
+ * MAP_HUGETLB) are used if there are enough of them, otherwise transparent
+ * huge pages are requested (MADV_HUGEPAGE), or large pages on Windows (if the
+ * process has the privilege). If none of these are available, ordinary pages
+ * are mapped; and if nothing can be mapped, it falls back to mallocNd().
+ * Since mapped memory is already zeroed by the OS, callocNd_huge() does not
+ * need to clear it.
+ *
+ * These arrays must be freed with md_free() or free1d() (not free()), but may
+ * otherwise be used (and reallocated) as any other md array:
+ * \code{.c}
+ *   float*** big = (float***)malloc3d_huge(2900, 300, 295, sizeof(float));
+ *   big[i][j][k] = 1.0f;
+ *   md_free(big);
+ *
+ *   // or, for all arrays of at least 64 MiB:
+ *   md_huge_set_threshold(64<<20);
+ * \endcode
+ */
+void* mallocNd_huge(size_t ndims, const size_t* dims, size_t data_size);
+
+/** Same as mallocNd_huge(), but zero-initialised (by the OS) */
+void* callocNd_huge(size_t ndims, const size_t* dims, size_t data_size);
+
+/** 2-D malloc backed by huge pages (see mallocNd_huge()) */
+void** malloc2d_huge(size_t dim1, size_t dim2, size_t data_size);
+
+/** 2-D calloc backed by huge pages (see mallocNd_huge()) */
+void** calloc2d_huge(size_t dim1, size_t dim2, size_t data_size);
+
+/** 3-D malloc backed by huge pages (see mallocNd_huge()) */
+void*** malloc3d_huge(size_t dim1, size_t dim2, size_t dim3, size_t data_size);
+
+/** 3-D calloc backed by huge pages (see mallocNd_huge()) */
+void*** calloc3d_huge(size_t dim1, size_t dim2, size_t dim3, size_t data_size);
+
+/** 4-D malloc backed by huge pages (see mallocNd_huge()) */
+void**** malloc4d_huge(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
+                       size_t data_size);
+
+/** 4-D calloc backed by huge pages (see mallocNd_huge()) */
+void**** calloc4d_huge(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
+                       size_t data_size);
+
+/** 5-D malloc backed by huge pages (see mallocNd_huge()) */
+void***** malloc5d_huge(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
+                        size_t dim5, size_t data_size);
+
+/** 5-D calloc backed by huge pages (see mallocNd_huge()) */
+void***** calloc5d_huge(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
+                        size_t dim5, size_t data_size);
+
+/** 6-D malloc backed by huge pages (see mallocNd_huge()) */
+void****** malloc6d_huge(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
+                         size_t dim5, size_t dim6, size_t data_size);
+
+/** 6-D calloc backed by huge pages (see mallocNd_huge()) */
+void****** calloc6d_huge(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
+                         size_t dim5, size_t dim6, size_t data_size);
+
+/** Maps a file read-only (see md_mmapNd()) */
+#define MD_MMAP_READONLY  ( 0 )
+/** Maps a file read-write; changes are written back to the file */
+#define MD_MMAP_READWRITE ( 1 )
+
+/**
+ * Maps an "ndims" NumPy .npy file (C-order, little-endian or single-byte
+ * elements) into memory, and builds pointer tables into it; so it may be
+ * indexed like any other md array, e.g. array3D[dir][ch][tap]
+ *
+ * Only the pointer tables are allocated (in ordinary memory); the data itself
+ * stays in the file, and its pages are only read in once they are first
+ * accessed. The pages of read-only mappings are also shared between all of the
+ * processes which map the same file. The shape of the file is returned via
+ * "dims" (which must have room for "ndims" entries, and "ndims" must be at
+ * least 2, and match the file), and the size of each element in bytes via
+ * "data_size" (which should be checked by the caller). Returns NULL if the file
+ * could not be mapped. Use md_free() to unmap it again:
+ * \code{.c}
+ *   size_t dims[3], data_size;
+ *   float*** hrtfs = (float***)md_mmapNd("hrtfs.npy", MD_MMAP_READONLY, 3, dims, &data_size);
+ *   if(hrtfs==NULL || data_size!=sizeof(float))
+ *       ...
+ *   y += hrtfs[dir][ch][tap] * x;
+ *   md_free(hrtfs);
+ * \endcode
+ * Arrays mapped from a file cannot be reallocated.
+ */
+void* md_mmapNd(const char* filename, int mode, size_t ndims, size_t* dims,
+                size_t* data_size);
+
+/** Maps a 2-D .npy file (see md_mmapNd()) */
+void** md_mmap2d(const char* filename, int mode, size_t* dim1, size_t* dim2,
+                 size_t* data_size);
+
+/** Maps a 3-D .npy file (see md_mmapNd()) */
+void*** md_mmap3d(const char* filename, int mode, size_t* dim1, size_t* dim2,
+                  size_t* dim3, size_t* data_size);
+
+/** Maps a 4-D .npy file (see md_mmapNd()) */
+void**** md_mmap4d(const char* filename, int mode, size_t* dim1, size_t* dim2,
+                   size_t* dim3, size_t* dim4, size_t* data_size);
+
+/** Maps a 5-D .npy file (see md_mmapNd()) */
+void***** md_mmap5d(const char* filename, int mode, size_t* dim1, size_t* dim2,
+                    size_t* dim3, size_t* dim4, size_t* dim5,
+                    size_t* data_size);
+
+/** Maps a 6-D .npy file (see md_mmapNd()) */
+void****** md_mmap6d(const char* filename, int mode, size_t* dim1, size_t* dim2,
+                     size_t* dim3, size_t* dim4, size_t* dim5, size_t* dim6,
+                     size_t* data_size);
+
+/**
+ * Writes an "ndims" md array (or, if ndims==1, a 1-D block) to a NumPy .npy
+ * file, which may then be mapped with md_mmapNd() (or loaded with numpy.load)
+ *
+ * "descr" is the NumPy type string of the elements, e.g. "<f4" for float, "<f8"
+ * for double, or "<c8" for float _Complex (on little-endian machines); the
+ * element size is taken from it (and for "<U" strings, is 4 bytes per
+ * character). The data is written in its native byte order. It is read
+ * through flattenNd(), i.e. as one contiguous block of rows, so arrays that
+ * are pitched or with aligned rows (or sliced views) are NOT written
+ * correctly; copy them into a default-layout array (as from mallocNd()) first.
+ * Returns 0 if the file was written successfully, and non-zero otherwise:
+ * \code{.c}
+ *   size_t dims[3] = {nDirs, nCH, nTaps};
+ *   md_save_npy("hrtfs.npy", hrtfs, 3, dims, "<f4");
+ * \endcode
+ */
+int md_save_npy(const char* filename, const void* ptr, size_t ndims,
+                const size_t* dims, const char* descr);
+
+/** Slabs are placed on the node of the thread which will use them (see
+ *  callocNd_numa()) */
+#define MD_NUMA_BLOCK      ( 0 )
+/** Slabs are spread over all nodes in turn (see callocNd_numa()) */
+#define MD_NUMA_INTERLEAVE ( 1 )
+
+/**
+ * Allocates a zero-initialised "ndims" array (same layout as mallocNd()),
+ * with its dim1 slabs (i.e. array[i]) placed across the NUMA nodes of the
+ * machine, according to "policy"
+ *
+ * Memory is normally placed on the node of the thread which first touches it;
+ * i.e. all of an array's pages would end up on the node of the thread that
+ * called calloc*d(). Instead, the data block here is zeroed in parallel by the
+ * OpenMP threads (if MD_MALLOC_ENABLE_OPENMP and OpenMP are enabled), with each
+ * thread zeroing the same slabs that it would be given by a
+ * "#pragma omp parallel for schedule(static)" loop over dim1. So, with
+ * MD_NUMA_BLOCK, workers which use such loops then find their slabs on their
+ * own node (threads should be pinned, e.g. OMP_PROC_BIND=true). With
+ * MD_NUMA_INTERLEAVE, and if MD_MALLOC_ENABLE_NUMA is defined (and libnuma
+ * reports more than one node), slab i is instead bound to the i-th node in
+ * turn; spreading the memory bandwidth over all nodes when the access pattern
+ * is not known. On single-node machines (or without OpenMP/libnuma), this
+ * simply falls back to a calloc'd array. Note that without
+ * MD_MALLOC_ENABLE_NUMA, MD_NUMA_INTERLEAVE is the same as MD_NUMA_BLOCK;
+ * debug builds print a warning to stderr whenever it falls back (the CMake
+ * option MD_MALLOC_TEST_NUMA builds the tests against libnuma). Placement is
+ * per page, so slabs smaller than a page share pages with their neighbours.
+ * Use md_free() to deallocate.
+ * \code{.c}
+ *   float*** X = (float***)calloc3d_numa(nFrames, nBands, nCH, sizeof(float), MD_NUMA_BLOCK);
+ *   #pragma omp parallel for schedule(static)
+ *   for(i=0; i<nFrames; i++)
+ *       process(X[i]);  // local memory for each thread
+ *   md_free(X);
+ * \endcode
+ */
+void* callocNd_numa(size_t ndims, const size_t* dims, size_t data_size,
+                    int policy);
+
+/** 2-D NUMA-placed calloc (see callocNd_numa()) */
+void** calloc2d_numa(size_t dim1, size_t dim2, size_t data_size, int policy);
+
+/** 3-D NUMA-placed calloc (see callocNd_numa()) */
+void*** calloc3d_numa(size_t dim1, size_t dim2, size_t dim3, size_t data_size,
+                      int policy);
+
+/** 4-D NUMA-placed calloc (see callocNd_numa()) */
+void**** calloc4d_numa(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
+                       size_t data_size, int policy);
+
+/** 5-D NUMA-placed calloc (see callocNd_numa()) */
+void***** calloc5d_numa(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
+                        size_t dim5, size_t data_size, int policy);
+
+/** 6-D NUMA-placed calloc (see callocNd_numa()) */
+void****** calloc6d_numa(size_t dim1, size_t dim2, size_t dim3, size_t dim4,
+                         size_t dim5, size_t dim6, size_t data_size,
+                         int policy);
+
+/**
+ * Returns the NUMA node on which the page holding "ptr" currently resides
+ * (or -1 if this is not known, e.g. if MD_MALLOC_ENABLE_NUMA is not defined,
+ * or the page has not been touched yet)
+ */
+int md_numa_node(const void* ptr);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /* MD_MALLOC_INCLUDED */
+
+
+/************
+ * INTERNAL:
+ ***********/
+
+#if defined(MD_MALLOC_ENABLE) && !defined(MD_MALLOC_IMPLEMENTED)
+#define MD_MALLOC_IMPLEMENTED
+
+#include <stdio.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Optional (compile-time) speed-ups for building the pointer tables of large
+ * arrays. By default, the tables are filled using plain C89 loops:
+ *
+ *   MD_MALLOC_ENABLE_SIMD   - fill table levels with at least
+ *                             MD_MALLOC_SIMD_THRESHOLD pointers using
+ *                             AVX-512/AVX2/SSE2 (x86-64) or NEON (AArch64)
+ *                             stores, depending on the target architecture
+ *                             (AVX2/AVX-512 need e.g. -mavx2 or -march=native)
+ *   MD_MALLOC_ENABLE_OPENMP - split table levels with at least
+ *                             MD_MALLOC_OPENMP_THRESHOLD pointers across
+ *                             threads (only if also compiled with OpenMP);
+ *                             and the same for md_permuteNd() and the bulk
+ *                             operations (md_set()..md_mul()) of at least
+ *                             MD_MALLOC_OPENMP_COPY_THRESHOLD bytes
+ *
+ * MD_MALLOC_ENABLE_SIMD also transposes the tiles of md_permuteNd() in
+ * registers, and vectorises the bulk operations.
+ *
+ * And for instrumentation/placement:
+ *
+ *   MD_MALLOC_ENABLE_STATS  - keep allocation statistics (see md_stats)
+ *   MD_MALLOC_ENABLE_NUMA   - place the slabs of callocNd_numa() arrays on
+ *                             NUMA nodes using libnuma (link with -lnuma)
+ *
+ * And for multithreaded code:
+ *
+ *   MD_MALLOC_ENABLE_THREAD_CACHE - per-thread recycling caches (see
+ *                             md_tcache_set_limit()); needs POSIX threads
+ *                             (link with -pthread) or Windows
+ */
+#ifndef MD_MALLOC_SIMD_THRESHOLD
+# define MD_MALLOC_SIMD_THRESHOLD ( 64 )
+#endif
+#ifndef MD_MALLOC_OPENMP_THRESHOLD
+# define MD_MALLOC_OPENMP_THRESHOLD ( 131072 )
+#endif
+#ifndef MD_MALLOC_OPENMP_COPY_THRESHOLD
+# define MD_MALLOC_OPENMP_COPY_THRESHOLD ( 1048576 )
+#endif
+#ifndef MD_MALLOC_STREAM_THRESHOLD
+# define MD_MALLOC_STREAM_THRESHOLD ( 8388608 )
+#endif
+#ifdef MD_MALLOC_ENABLE_SIMD
+# if defined(__AVX512F__) && (defined(__x86_64__) || defined(_M_X64))
+#  define MD_MALLOC_AVX512
+#  include <immintrin.h>
+# elif defined(__AVX2__) && (defined(__x86_64__) || defined(_M_X64))
+#  define MD_MALLOC_AVX2
+#  include <immintrin.h>
+# elif defined(__x86_64__) || defined(_M_X64)
+#  define MD_MALLOC_SSE2
+#  include <emmintrin.h>
+# elif defined(__aarch64__) || defined(_M_ARM64)
+#  define MD_MALLOC_NEON
+#  include <arm_neon.h>
+# endif
+#endif
+#if defined(MD_MALLOC_ENABLE_OPENMP) && defined(_OPENMP)
+# include <omp.h>
+#endif
+#ifndef MD_MALLOC_STATS_LARGE_BYTES
+# define MD_MALLOC_STATS_LARGE_BYTES ( 1048576 )
+#endif
+#ifdef MD_MALLOC_ENABLE_STATS
+# include <time.h>
+# if defined(_WIN32)
+#  include <windows.h>
+#  include <malloc.h>
+#  define MD_USABLE_SIZE(p) _msize(p)
+# elif defined(__APPLE__)
+#  include <malloc/malloc.h>
+#  define MD_USABLE_SIZE(p) malloc_size(p)
+# elif defined(__linux__)
+#  include <malloc.h>
+#  define MD_USABLE_SIZE(p) malloc_usable_size(p)
+# else
+#  define MD_USABLE_SIZE(p) ((size_t)0) /* live bytes are not tracked */
+# endif
+#endif
+#if defined(_MSC_VER)
+# include <intrin.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+# include <sys/mman.h>
+# if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#  define MAP_ANONYMOUS MAP_ANON
+# endif
+# if defined(MAP_ANONYMOUS)
+#  define MD_MALLOC_HAVE_MMAP /* (glibc hides MAP_ANONYMOUS in strict ISO C
+                               *  modes, e.g. -std=c99 rather than gnu99) */
+# endif
+# include <sys/stat.h>
+# include <sys/time.h>
+# include <fcntl.h>
+# include <unistd.h>
+# define MD_MALLOC_HAVE_FILE_MMAP
+#elif defined(_WIN32)
+# include <windows.h>
+# define MD_MALLOC_HAVE_FILE_MMAP
+#endif
+#ifdef MD_MALLOC_ENABLE_NUMA
+# include <numa.h>
+#endif
+#ifdef MD_MALLOC_ENABLE_THREAD_CACHE
+# if defined(_WIN32)
+#  include <windows.h>
+#  define MD_MALLOC_HAVE_THREAD_CACHE
+# elif defined(__unix__) || defined(__APPLE__)
+#  include <pthread.h>
+#  define MD_MALLOC_HAVE_THREAD_CACHE
+# endif
+#endif
+#ifndef MD_HUGE_PAGE_SIZE
+# define MD_HUGE_PAGE_SIZE ( 2097152 )
+#endif
+
+/* Atomically adds "v" to "*p" (relaxed ordering, as only used for counters) */
+static void md_atomic_add(volatile size_t* p, size_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __atomic_fetch_add(p, v, __ATOMIC_RELAXED);
+#elif defined(_MSC_VER) && defined(_WIN64)
+    _InterlockedExchangeAdd64((volatile __int64*)p, (__int64)v);
+#elif defined(_MSC_VER)
+    _InterlockedExchangeAdd((volatile long*)p, (long)v);
+#else
+    *p += v;
+#endif
+}
+
+/* Atomically reads "*p" */
+static size_t md_atomic_load(volatile size_t* p)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+#else
+    return *p; /* aligned size_t reads are atomic on MSVC targets */
+#endif
+}
+
+/* Atomically sets "*p" to "v" */
+static void md_atomic_store(volatile size_t* p, size_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __atomic_store_n(p, v, __ATOMIC_RELAXED);
+#else
+    *p = v;
+#endif
+}
+
+/* md_atomic_load(), and no later reads/writes are moved before it */
+static size_t md_atomic_load_acquire(volatile size_t* p)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#else
+    size_t v = *p;
+# if defined(_M_ARM64)
+    __dmb(_ARM64_BARRIER_ISH);
+# elif defined(_MSC_VER)
+    _ReadWriteBarrier(); /* (x86 does not reorder loads with later accesses) */
+# endif
+    return v;
+#endif
+}
+
+/* md_atomic_store(), and no earlier reads/writes are moved after it */
+static void md_atomic_store_release(volatile size_t* p, size_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+#else
+# if defined(_M_ARM64)
+    __dmb(_ARM64_BARRIER_ISH);
+# elif defined(_MSC_VER)
+    _ReadWriteBarrier(); /* (x86 does not reorder stores with earlier accesses) */
+# endif
+    *p = v;
+#endif
+}
+
+#ifdef MD_MALLOC_ENABLE_STATS
+/* Atomically replaces "*p" with "v", if "*p" equals "expected" (returns
+ * non-zero if it did) */
+static int md_atomic_cas(volatile size_t* p, size_t expected, size_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __atomic_compare_exchange_n(p, &expected, v, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+#elif defined(_MSC_VER) && defined(_WIN64)
+    return (size_t)_InterlockedCompareExchange64((volatile __int64*)p, (__int64)v, (__int64)expected) == expected;
+#elif defined(_MSC_VER)
+    return (size_t)_InterlockedCompareExchange((volatile long*)p, (long)v, (long)expected) == expected;
+#else
+    if(*p!=expected)
+        return 0;
+    *p = v;
+    return 1;
+#endif
+}
+#endif
+
+/* Spin lock (only ever held for a few table lookups) */
+static void md_lock(volatile long* lock)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    while(__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE))
+        while(__atomic_load_n(lock, __ATOMIC_RELAXED)) {}
+#elif defined(_MSC_VER)
+    while(_InterlockedExchange(lock, 1))
+        while(*lock) {}
+#else
+    *lock = 1; /* no atomics available: single-threaded use only */
+#endif
+}
+
+static void md_unlock(volatile long* lock)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+#elif defined(_MSC_VER)
+    _InterlockedExchange(lock, 0);
+#else
+    *lock = 0;
+#endif
+}
+
+#ifdef MD_MALLOC_ENABLE_STATS
+/* Monotonic time, in nanoseconds. Strict ISO C modes (e.g. -std=c99 rather
+ * than gnu99) hide CLOCK_MONOTONIC, in which case the wall-clock time is used
+ * instead; clock() is only a last resort, as it measures CPU time */
+static size_t md_time_ns(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER f, t;
+    QueryPerformanceFrequency(&f);
+    QueryPerformanceCounter(&t);
+    return (size_t)((double)t.QuadPart*1.0e9/(double)f.QuadPart);
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (size_t)ts.tv_sec*1000000000u + (size_t)ts.tv_nsec;
+#elif defined(TIME_UTC)
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (size_t)ts.tv_sec*1000000000u + (size_t)ts.tv_nsec;
+#elif defined(__unix__) || defined(__APPLE__)
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (size_t)tv.tv_sec*1000000000u + (size_t)tv.tv_usec*1000u;
+#else
+    return (size_t)((double)clock()*1.0e9/(double)CLOCKS_PER_SEC);
+#endif
+}
+
+/* Statistics shared by all threads (see md_stats) */
+static struct {
+    volatile size_t calls[3][MD_STATS_MAX_RANK];
+    volatile size_t large_calls[3][MD_STATS_MAX_RANK];
+    volatile size_t bytes_requested;
+    volatile size_t table_bytes;
+    volatile size_t table_build_ns;
+    volatile size_t frees;
+    volatile size_t live_bytes;
+    volatile size_t peak_live_bytes;
+    volatile size_t start_ns;
+} md_stats_state;
+
+/* Counts a call of the given kind (MD_STATS_MALLOC/CALLOC/REALLOC) and rank */
+static void md_stats_count(int kind, size_t ndims, size_t bytes, size_t table_bytes)
+{
+    size_t r;
+    r = (ndims<MD_STATS_MAX_RANK ? ndims : MD_STATS_MAX_RANK) - 1;
+    if(md_atomic_load(&md_stats_state.start_ns)==0)
+        md_atomic_cas(&md_stats_state.start_ns, 0, md_time_ns());
+    md_atomic_add(&md_stats_state.calls[kind][r], 1);
+    if(bytes>=MD_MALLOC_STATS_LARGE_BYTES)
+        md_atomic_add(&md_stats_state.large_calls[kind][r], 1);
+    md_atomic_add(&md_stats_state.bytes_requested, bytes);
+    md_atomic_add(&md_stats_state.table_bytes, table_bytes);
+}
+
+/* Adds "added" bytes and removes "removed" bytes from the live byte count */
+static void md_stats_live(size_t added, size_t removed)
+{
+    size_t live, peak;
+    md_atomic_add(&md_stats_state.live_bytes, added - removed);
+    live = md_atomic_load(&md_stats_state.live_bytes);
+    peak = md_atomic_load(&md_stats_state.peak_live_bytes);
+    while(live>peak && !md_atomic_cas(&md_stats_state.peak_live_bytes, peak, live))
+        peak = md_atomic_load(&md_stats_state.peak_live_bytes);
+}
+# define MD_STATS_SIZE(ptr) ((ptr)==NULL ? (size_t)0 : (size_t)MD_USABLE_SIZE(ptr))
+#else
+# define md_stats_count(kind, ndims, bytes, table_bytes) ((void)0)
+# define md_stats_live(added, removed) ((void)0)
+# define MD_STATS_SIZE(ptr) ((size_t)0)
+#endif
+
+/* An array which cannot be passed to free()/realloc(), found through the
+ * registry (keyed by "ptr"): either one allocated while a recycling cache is
+ * enabled (see md_cache_set_limit()), which starts MD_CACHE_HEADER bytes into
+ * its block; or one which was mmap'd (see mallocNd_huge()) or has its data in
+ * a mapped file (see md_mmapNd()). Recyclable arrays are either live (in the
+ * registry), or cached (in a free list, keyed by their shape) */
+typedef struct _md_cache_entry {
+    void* ptr;
+    size_t ndims;                 /* 0 if the shape is unknown (not recyclable) */
+    size_t dims[MD_MAX_NDIMS];
+    size_t data_size;
+    size_t bytes;                 /* pointer tables plus data */
+    size_t header;                /* bytes before "ptr" which belong to the
+                                   * block (if recyclable), otherwise 0 */
+    void* owner;                  /* the md_tcache of a thread cache array, or
+                                   * NULL for the global cache */
+    size_t mapped;                /* length of the mapping, if the block was
+                                   * mmap'd (see md_map()), otherwise 0 */
+    void* map;                    /* start of the mapping (the same as "ptr",
+                                   * unless the data is in a mapped file) */
+    int file;                     /* whether "map" is a mapped file (see
+                                   * md_mmapNd()) */
+    size_t hash;                  /* of "ptr" when live, of the shape when cached */
+    struct _md_cache_entry* next; /* in the same registry/free-list bucket */
+} md_cache_entry;
+
+#define MD_CACHE_SHAPE_BUCKETS ( 256 )
+#define MD_CACHE_SHARDS ( 16 )
+#define MD_CACHE_SHARD_BUCKETS ( 64 )
+
+/* One part of the registry of live arrays. The registry is split by the hash
+ * of "ptr", each part with its own lock; so that threads freeing the arrays of
+ * their own caches (see md_tcache_set_limit()) seldom contend */
+typedef struct _md_cache_shard {
+    volatile long lock;
+    size_t nlive;
+    md_cache_entry** live;        /* buckets */
+    size_t nbuckets;
+    md_cache_entry* live0[MD_CACHE_SHARD_BUCKETS]; /* initial buckets */
+} md_cache_shard;
+
+static struct {
+    volatile long lock;           /* for "cached" */
+    volatile size_t limit;        /* 0 if disabled */
+    volatile size_t nlive;        /* number of registered (live) arrays */
+    volatile size_t cached_bytes;
+    volatile size_t hits;
+    volatile size_t misses;
+    md_cache_shard shards[MD_CACHE_SHARDS]; /* the registry */
+    md_cache_entry* cached[MD_CACHE_SHAPE_BUCKETS];
+    volatile size_t huge_threshold; /* see md_huge_set_threshold() */
+} md_cache_state;
+
+static size_t md_cache_ptr_hash(const void* ptr)
+{
+    size_t h = (size_t)ptr >> 4;
+    return h ^ (h >> 7) ^ (h >> 17);
+}
+
+static size_t md_cache_shape_hash(size_t ndims, const size_t* dims, size_t data_size)
+{
+    size_t l, h;
+    h = ndims*31 + data_size;
+    for(l=0; l<ndims; l++)
+        h = h*1000003 ^ dims[l];
+    return h ^ (h >> 15);
+}
+
+/* The registry shard of a "ptr" with the given hash (the rest of the hash
+ * then picks the bucket within the shard) */
+#define MD_CACHE_SHARD(hash) ( &md_cache_state.shards[(hash)%MD_CACHE_SHARDS] )
+#define MD_CACHE_BUCKET(shard, hash) ( ((hash)/MD_CACHE_SHARDS) & ((shard)->nbuckets-1) )
+
+/* The registry entry of "ptr" in "shard" (whose lock must be held), or NULL.
+ * If "unlink" is set, the entry is also removed from the registry */
+static md_cache_entry* md_cache_find(md_cache_shard* shard, void* ptr,
+                                     int unlink)
+{
+    md_cache_entry** link;
+    md_cache_entry* e;
+    if(shard->nbuckets==0)
+        return NULL;
+    link = &shard->live[MD_CACHE_BUCKET(shard, md_cache_ptr_hash(ptr))];
+    for(; *link!=NULL; link = &(*link)->next){
+        if((*link)->ptr==ptr){
+            e = *link;
+            if(unlink){
+                *link = e->next;
+                shard->nlive--;
+                md_atomic_add(&md_cache_state.nlive, (size_t)-1);
+            }
+            return e;
+        }
+    }
+    return NULL;
+}
+
+/* Adds the live array "e" to the registry (growing its shard as needed) */
+static void md_cache_insert(md_cache_entry* e)
+{
+    size_t l, n, h;
+    md_cache_shard* shard;
+    md_cache_entry** buckets;
+    md_cache_entry* next;
+    e->hash = md_cache_ptr_hash(e->ptr);
+    shard = MD_CACHE_SHARD(e->hash);
+    md_lock(&shard->lock);
+    if(shard->nbuckets==0){
+        shard->live = shard->live0;
+        shard->nbuckets = MD_CACHE_SHARD_BUCKETS;
+    }
+    if(shard->nlive>=shard->nbuckets){
+        /* rehash into twice as many buckets (or just carry on with longer
+         * chains, if that is not possible) */
+        n = 2*shard->nbuckets;
+        buckets = (md_cache_entry**)calloc(n, sizeof(md_cache_entry*));
+        if(buckets!=NULL){
+            for(l=0; l<shard->nbuckets; l++){
+                for(; shard->live[l]!=NULL; shard->live[l] = next){
+                    next = shard->live[l]->next;
+                    h = (shard->live[l]->hash/MD_CACHE_SHARDS) & (n-1);
+                    shard->live[l]->next = buckets[h];
+                    buckets[h] = shard->live[l];
+                }
+            }
+            if(shard->live!=shard->live0)
+                free(shard->live);
+            shard->live = buckets;
+            shard->nbuckets = n;
+        }
+    }
+    h = MD_CACHE_BUCKET(shard, e->hash);
+    e->next = shard->live[h];
+    shard->live[h] = e;
+    shard->nlive++;
+    md_atomic_add(&md_cache_state.nlive, 1);
+    md_unlock(&shard->lock);
+}
+
+/* Removes "ptr" from the registry, returning its entry (or NULL if it was not
+ * registered) */
+static md_cache_entry* md_cache_take(void* ptr)
+{
+    md_cache_shard* shard;
+    md_cache_entry* e;
+    if(ptr==NULL || md_atomic_load(&md_cache_state.nlive)==0)
+        return NULL;
+    shard = MD_CACHE_SHARD(md_cache_ptr_hash(ptr));
+    md_lock(&shard->lock);
+    e = md_cache_find(shard, ptr, 1);
+    md_unlock(&shard->lock);
+    return e;
+}
+
+/* Sets the shape of a registry entry */
+static void md_cache_set_shape(md_cache_entry* e, size_t ndims,
+                               const size_t* dims, size_t data_size)
+{
+    size_t l;
+    e->ndims = ndims;
+    for(l=0; l<ndims && l<MD_MAX_NDIMS; l++)
+        e->dims[l] = dims[l];
+    e->data_size = data_size;
+    e->bytes = md_sizeof(ndims, dims, data_size, NULL);
+}
+
+/* Arrays handed out by the recycling caches start MD_CACHE_HEADER bytes into
+ * their block (keeping malloc()'s alignment). As they do not start the block
+ * which malloc() returned, passing one to free() fails loudly, rather than
+ * leaving its registry entry behind, to be matched by a later block at the
+ * same address */
+#define MD_CACHE_HEADER ( 16 )
+
+/* Registers "ptr" as an "ndims" array; or, if it is already registered, just
+ * updates its shape. Returns 0 if "ptr" is not registered (either because
+ * "add" was zero, or a new entry could not be allocated) */
+static int md_cache_track(void* ptr, size_t ndims, const size_t* dims,
+                          size_t data_size, size_t mapped, int add)
+{
+    md_cache_shard* shard;
+    md_cache_entry* e;
+    if(ptr==NULL)
+        return 0;
+    e = NULL;
+    if(md_atomic_load(&md_cache_state.nlive)!=0){
+        shard = MD_CACHE_SHARD(md_cache_ptr_hash(ptr));
+        md_lock(&shard->lock);
+        e = md_cache_find(shard, ptr, 0);
+        if(e!=NULL)
+            md_cache_set_shape(e, ndims, dims, data_size);
+        md_unlock(&shard->lock);
+    }
+    if(e!=NULL)
+        return 1;
+    if(!add)
+        return 0;
+    e = (md_cache_entry*)malloc(sizeof(md_cache_entry));
+    if(e==NULL)
+        return 0;
+    e->ptr = ptr;
+    e->header = 0;
+    e->owner = NULL;
+    e->mapped = mapped;
+    e->map = ptr;
+    e->file = 0;
+    md_cache_set_shape(e, ndims, dims, data_size);
+    md_cache_insert(e);
+    return 1;
+}
+
+#ifdef MD_MALLOC_HAVE_THREAD_CACHE
+/* A thread's own recycling cache (see md_tcache_set_limit()): free lists of
+ * the arrays it has allocated and since freed (keyed by shape). The registry
+ * entries of its arrays point back to it; so other threads only touch it when
+ * freeing one of its arrays, or when emptying all of the caches, and "lock" is
+ * almost never contended. Caches are never
+ * freed; once a thread exits, its cache is emptied and may be adopted by a new
+ * thread */
+typedef struct _md_tcache {
+    volatile long lock;
+    int alive;                    /* 0 once the owning thread has exited */
+    md_cache_entry* cached[MD_CACHE_SHAPE_BUCKETS];
+    size_t cached_bytes;
+    size_t hits;
+    size_t misses;
+    struct _md_tcache* next;      /* in md_tcache_state.all */
+} md_tcache;
+
+static struct {
+    volatile long lock;           /* for "all", and creating "key" */
+    volatile size_t limit;        /* per thread; 0 if disabled */
+    md_tcache* all;
+    int key_created;
+# if defined(_WIN32)
+    DWORD key;                    /* fiber-local storage (for its destructor) */
+# else
+    pthread_key_t key;
+# endif
+} md_tcache_state;
+
+/* The calling thread's cache (NULL if it has none) */
+static md_tcache* md_tcache_get(void)
+{
+    if(!md_tcache_state.key_created)
+        return NULL;
+# if defined(_WIN32)
+    return (md_tcache*)FlsGetValue(md_tcache_state.key);
+# else
+    return (md_tcache*)pthread_getspecific(md_tcache_state.key);
+# endif
+}
+
+# define md_tcache_enabled() (md_atomic_load(&md_tcache_state.limit)!=0)
+#else
+# define md_tcache_enabled() (0)
+#endif
+
+/* Maps "bytes" of (zeroed) anonymous memory. If "huge" is set, the mapping
+ * starts on an MD_HUGE_PAGE_SIZE boundary and is backed by huge pages where
+ * the system allows: explicitly reserved huge pages (MAP_HUGETLB) are tried
+ * first, then transparent huge pages (MADV_HUGEPAGE). Returns NULL if memory
+ * could not be mapped at all, otherwise the length of the mapping is returned
+ * via "mapped" */
+static void* md_map(size_t bytes, size_t* mapped, int huge)
+{
+#if defined(MD_MALLOC_HAVE_MMAP)
+    size_t len, head;
+    unsigned char* p;
+    if(!huge){
+        if(bytes==0)
+            return NULL;
+        p = (unsigned char*)mmap(NULL, bytes, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        if(p==(unsigned char*)MAP_FAILED)
+            return NULL;
+        *mapped = bytes;
+        return p;
+    }
+    len = MD_ALIGN_UP(bytes, MD_HUGE_PAGE_SIZE);
+    if(len<bytes || len==0)
+        return NULL;
+# if defined(MAP_HUGETLB)
+    p = (unsigned char*)mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+    if(p!=(unsigned char*)MAP_FAILED){
+        *mapped = len;
+        return p;
+    }
+# endif
+    /* over-map, and then trim to the huge page boundary */
+    p = (unsigned char*)mmap(NULL, len + MD_HUGE_PAGE_SIZE, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if(p==(unsigned char*)MAP_FAILED)
+        return NULL;
+    head = MD_ALIGN_UP((size_t)p, MD_HUGE_PAGE_SIZE) - (size_t)p;
+    if(head!=0)
+        munmap(p, head);
+    if(head!=MD_HUGE_PAGE_SIZE)
+        munmap(p + head + len, MD_HUGE_PAGE_SIZE - head);
+    p += head;
+# if defined(MADV_HUGEPAGE)
+    madvise(p, len, MADV_HUGEPAGE);
+# endif
+    *mapped = len;
+    return p;
+#elif defined(_WIN32)
+    size_t large;
+    void* p;
+    large = huge ? (size_t)GetLargePageMinimum() : 0;
+    if(large!=0){
+        /* (only succeeds if the process holds SeLockMemoryPrivilege) */
+        p = VirtualAlloc(NULL, MD_ALIGN_UP(bytes, large), MEM_RESERVE|MEM_COMMIT|MEM_LARGE_PAGES, PAGE_READWRITE);
+        if(p!=NULL){
+            *mapped = MD_ALIGN_UP(bytes, large);
+            return p;
+        }
+    }
+    p = VirtualAlloc(NULL, bytes, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+    *mapped = bytes;
+    return p;
+#else
+    (void)bytes;
+    (void)mapped;
+    (void)huge;
+    return NULL;
+#endif
+}
+
+/* Unmaps a block mapped by md_map() */
+static void md_unmap(void* ptr, size_t mapped)
+{
+#if defined(MD_MALLOC_HAVE_MMAP)
+    munmap(ptr, mapped);
+#elif defined(_WIN32)
+    VirtualFree(ptr, 0, MEM_RELEASE);
+#endif
+    md_stats_live(0, mapped);
+    (void)ptr;
+    (void)mapped;
+}
+
+/* Unmaps a file mapped by md_mmapNd() */
+static void md_unmap_file(void* map, size_t len)
+{
+#if defined(MD_MALLOC_HAVE_FILE_MMAP) && !defined(_WIN32)
+    munmap(map, len);
+#elif defined(_WIN32)
+    UnmapViewOfFile(map);
+#endif
+    (void)map;
+    (void)len;
+}
+
+/* The calls to the system allocator, shared by the 1-D and N-D functions */
+static void* md_sys_malloc(size_t bytes)
+{
+    void *ptr = malloc(bytes);
+#if !defined(NDEBUG)
+    if (ptr == NULL && bytes!=0)
+        fprintf(stderr, "Error: 'malloc1d' failed to allocate %zu bytes.\n", bytes);
+#endif
+    md_stats_live(MD_STATS_SIZE(ptr), 0);
+    return ptr;
+}
+
+static void* md_sys_calloc(size_t dim1, size_t data_size)
+{
+    void *ptr = calloc(dim1, data_size);
+#if !defined(NDEBUG)
+    if (ptr == NULL && dim1!=0)
+        fprintf(stderr, "Error: 'calloc1d' failed to allocate %zu bytes.\n", dim1*data_size);
+#endif
+    md_stats_live(MD_STATS_SIZE(ptr), 0);
+    return ptr;
+}
+
+/* Reallocates the block of the recyclable array of "e" (already taken from
+ * the registry) to hold "bytes", and registers it again. Its shape is unknown
+ * until it is tracked again (see md_cache_track()), so it is not recycled in
+ * the meantime */
+static void* md_cache_realloc(md_cache_entry* e, size_t bytes)
+{
+    unsigned char* base;
+#ifdef MD_MALLOC_ENABLE_STATS
+    size_t old_size;
+#endif
+    base = (unsigned char*)e->ptr - e->header;
+#ifdef MD_MALLOC_ENABLE_STATS
+    old_size = MD_STATS_SIZE(base);
+#endif
+    base = (unsigned char*)realloc(base, bytes + e->header);
+    if(base==NULL){
+#if !defined(NDEBUG)
+        fprintf(stderr, "Error: 'realloc1d' failed to allocate %zu bytes.\n", bytes);
+#endif
+        md_cache_insert(e); /* (the array is still valid) */
+        return NULL;
+    }
+    md_stats_live(MD_STATS_SIZE(base), old_size);
+    e->ptr = base + e->header;
+    e->ndims = 0;
+    e->bytes = bytes;
+    md_cache_insert(e);
+    return e->ptr;
+}
+
+static void* md_sys_realloc(void* ptr, size_t bytes)
+{
+    void* tmp;
+    md_cache_entry* e;
+#ifdef MD_MALLOC_ENABLE_STATS
+    size_t old_size;
+#endif
+    e = md_cache_take(ptr);
+    if(e!=NULL && e->header!=0)
+        return md_cache_realloc(e, bytes);
+    if(e!=NULL && e->file){
+#if !defined(NDEBUG)
+        fprintf(stderr, "Error: arrays mapped from a file cannot be reallocated.\n");
+#endif
+        md_cache_insert(e);
+        return NULL;
+    }
+    if(e!=NULL && e->mapped!=0){
+        /* mapped blocks are moved into a malloc'd block instead */
+        tmp = md_sys_malloc(bytes);
+        if(tmp==NULL && bytes!=0){
+            md_cache_insert(e);
+            return NULL;
+        }
+        memcpy(tmp, ptr, bytes<e->bytes ? bytes : e->bytes);
+        md_unmap(ptr, e->mapped);
+        free(e);
+        return tmp;
+    }
+#ifdef MD_MALLOC_ENABLE_STATS
+    old_size = MD_STATS_SIZE(ptr);
+#endif
+    tmp = realloc(ptr, bytes);
+#if !defined(NDEBUG)
+    if (tmp == NULL && bytes!=0)
+        fprintf(stderr, "Error: 'realloc1d' failed to allocate %zu bytes.\n", bytes);
+#endif
+    if(tmp==NULL && bytes!=0){
+        if(e!=NULL)
+            md_cache_insert(e); /* "ptr" is still valid */
+        return NULL;
+    }
+    free(e);
+    md_stats_live(MD_STATS_SIZE(tmp), old_size);
+    return tmp;
+}
+
+void* malloc1d(size_t dim1_data_size)
+{
+    md_stats_count(MD_STATS_MALLOC, 1, dim1_data_size, 0);
+    return md_sys_malloc(dim1_data_size);
+}
+
+void* calloc1d(size_t dim1, size_t data_size)
+{
+    md_stats_count(MD_STATS_CALLOC, 1, dim1*data_size, 0);
+    return md_sys_calloc(dim1, data_size);
+}
+
+void* realloc1d(void* ptr, size_t dim1_data_size)
+{
+    md_stats_count(MD_STATS_REALLOC, 1, dim1_data_size, 0);
+    return md_sys_realloc(ptr, dim1_data_size);
+}
+
+/* Frees a block which is not (or no longer) in the cache registry */
+static void md_sys_free(void* ptr)
+{
+#ifdef MD_MALLOC_ENABLE_STATS
+    if(ptr!=NULL){
+        md_atomic_add(&md_stats_state.frees, 1);
+        md_stats_live(0, MD_STATS_SIZE(ptr));
+    }
+#endif
+    free(ptr);
+}
+
+/* Frees the block of a recyclable (or registered, but not mapped) array, and
+ * its entry, which is no longer in the registry */
+static void md_cache_discard(md_cache_entry* e)
+{
+    md_sys_free((unsigned char*)e->ptr - e->header);
+    free(e);
+}
+
+/* Frees every block in the "victims" list (linked via "next") */
+static void md_cache_release(md_cache_entry* victims)
+{
+    md_cache_entry* next;
+    for(; victims!=NULL; victims = next){
+        next = victims->next;
+        md_cache_discard(victims);
+    }
+}
+
+#ifdef MD_MALLOC_HAVE_THREAD_CACHE
+/* Empties the free lists of "tc" (whose lock must be held), and returns them
+ * as one list */
+static md_cache_entry* md_tcache_empty(md_tcache* tc)
+{
+    size_t b;
+    md_cache_entry* victims;
+    md_cache_entry* next;
+    victims = NULL;
+    for(b=0; b<MD_CACHE_SHAPE_BUCKETS; b++){
+        for(; tc->cached[b]!=NULL; tc->cached[b] = next){
+            next = tc->cached[b]->next;
+            tc->cached[b]->next = victims;
+            victims = tc->cached[b];
+        }
+    }
+    tc->cached_bytes = 0;
+    return victims;
+}
+
+/* Called when a thread with a cache exits */
+# if defined(_WIN32)
+static VOID WINAPI md_tcache_exit(PVOID arg)
+# else
+static void md_tcache_exit(void* arg)
+# endif
+{
+    md_tcache* tc = (md_tcache*)arg;
+    md_cache_entry* victims;
+    if(tc==NULL)
+        return;
+    md_lock(&tc->lock);
+    victims = md_tcache_empty(tc);
+    tc->alive = 0; /* (its live arrays still point to it, so may still be freed) */
+    md_unlock(&tc->lock);
+    md_cache_release(victims);
+}
+
+/* The calling thread's cache; created (or adopted from an exited thread) if
+ * it does not have one yet. Returns NULL if this fails */
+static md_tcache* md_tcache_self(void)
+{
+    md_tcache* tc;
+    tc = md_tcache_get();
+    if(tc!=NULL)
+        return tc;
+    md_lock(&md_tcache_state.lock);
+    if(!md_tcache_state.key_created){
+# if defined(_WIN32)
+        md_tcache_state.key = FlsAlloc(md_tcache_exit);
+        md_tcache_state.key_created = md_tcache_state.key!=FLS_OUT_OF_INDEXES;
+# else
+        md_tcache_state.key_created = pthread_key_create(&md_tcache_state.key, md_tcache_exit)==0;
+# endif
+    }
+    for(tc = md_tcache_state.all; tc!=NULL; tc = tc->next){
+        md_lock(&tc->lock);
+        if(!tc->alive){
+            tc->alive = 1;
+            md_unlock(&tc->lock);
+            break;
+        }
+        md_unlock(&tc->lock);
+    }
+    if(tc==NULL && md_tcache_state.key_created){
+        tc = (md_tcache*)calloc(1, sizeof(md_tcache));
+        if(tc!=NULL){
+            tc->alive = 1;
+            tc->next = md_tcache_state.all;
+            md_tcache_state.all = tc;
+        }
+    }
+    md_unlock(&md_tcache_state.lock);
+    if(tc==NULL)
+        return NULL;
+# if defined(_WIN32)
+    FlsSetValue(md_tcache_state.key, tc);
+# else
+    pthread_setspecific(md_tcache_state.key, tc);
+# endif
+    return tc;
+}
+
+#endif
+
+/* Frees the recyclable array of "e"; or, if "recycle" is set and the recycling
+ * cache has room for it, keeps it on the free list for its shape instead */
+static void md_cache_recycle(md_cache_entry* e, int recycle)
+{
+    size_t h, limit;
+#ifdef MD_MALLOC_HAVE_THREAD_CACHE
+    md_tcache* tc = (md_tcache*)e->owner;
+    if(tc!=NULL){
+        /* back to the cache of the thread which allocated it (whichever thread
+         * is freeing it), unless that thread has exited */
+        limit = md_atomic_load(&md_tcache_state.limit);
+        md_lock(&tc->lock);
+        if(tc->alive && recycle && limit!=0 && e->ndims>=2 && e->ndims<=MD_MAX_NDIMS &&
+           tc->cached_bytes + e->bytes <= limit){
+            e->hash = md_cache_shape_hash(e->ndims, e->dims, e->data_size);
+            h = e->hash%MD_CACHE_SHAPE_BUCKETS;
+            e->next = tc->cached[h];
+            tc->cached[h] = e;
+            tc->cached_bytes += e->bytes;
+            md_unlock(&tc->lock);
+            return;
+        }
+        md_unlock(&tc->lock);
+        md_cache_discard(e);
+        return;
+    }
+#endif
+    limit = md_atomic_load(&md_cache_state.limit);
+    if(recycle && limit!=0 && e->ndims>=2 && e->ndims<=MD_MAX_NDIMS){
+        md_lock(&md_cache_state.lock);
+        if(md_cache_state.cached_bytes + e->bytes <= limit){
+            e->hash = md_cache_shape_hash(e->ndims, e->dims, e->data_size);
+            h = e->hash%MD_CACHE_SHAPE_BUCKETS;
+            e->next = md_cache_state.cached[h];
+            md_cache_state.cached[h] = e;
+            md_atomic_add(&md_cache_state.cached_bytes, e->bytes);
+            md_unlock(&md_cache_state.lock);
+            return;
+        }
+        md_unlock(&md_cache_state.lock);
+    }
+    md_cache_discard(e);
+}
+
+/* Frees (or unmaps) any block allocated by this header. If "recycle" is set,
+ * and the recycling cache has room for it, the block is kept instead */
+static void md_release(void* ptr, int recycle)
+{
+    md_cache_entry* e;
+    if(ptr==NULL)
+        return;
+    e = md_cache_take(ptr);
+    if(e!=NULL && e->header!=0){
+        md_cache_recycle(e, recycle);
+        return;
+    }
+    if(e!=NULL && e->file){
+        md_unmap_file(e->map, e->mapped);
+        md_sys_free(ptr); /* the pointer tables */
+    }
+    else if(e!=NULL && e->mapped!=0)
+        md_unmap(ptr, e->mapped);
+    else
+        md_sys_free(ptr);
+    free(e);
+}
+
+void free1d(void* ptr)
+{
+    md_release(ptr, 0);
+}
+
+/* Allocation modes of md_alloc() (same as the md_stats indices) */
+#define MD_MODE_MALLOC  MD_STATS_MALLOC
+#define MD_MODE_CALLOC  MD_STATS_CALLOC
+#define MD_MODE_REALLOC MD_STATS_REALLOC
+
+/* Total number of pointers in the tables of an "ndims" array */
+static size_t md_table_count(size_t ndims, const size_t* dims)
+{
+    size_t l, count, total;
+    count = 1;
+    total = 0;
+    for(l=0; l<ndims-1; l++){
+        count *= dims[l];
+        total += count;
+    }
+    return total;
+}
+
+/* Fills "count" pointers of a table with the arithmetic progression:
+ * table[n] = base + n*step */
+static void md_fill_table(void** table, size_t count, unsigned char* base,
+                          size_t step)
+{
+    size_t n;
+    unsigned char* p;
+    n = 0;
+#if defined(MD_MALLOC_AVX512)
+    if(count>=MD_MALLOC_SIMD_THRESHOLD){
+        __m512i v, inc;
+        v = _mm512_set_epi64((long long)(size_t)(base+7*step), (long long)(size_t)(base+6*step),
+                             (long long)(size_t)(base+5*step), (long long)(size_t)(base+4*step),
+                             (long long)(size_t)(base+3*step), (long long)(size_t)(base+2*step),
+                             (long long)(size_t)(base+step), (long long)(size_t)base);
+        inc = _mm512_set1_epi64((long long)(8*step));
+        for(; n+8<=count; n+=8){
+            _mm512_storeu_si512((void*)(table+n), v);
+            v = _mm512_add_epi64(v, inc);
+        }
+    }
+#elif defined(MD_MALLOC_AVX2)
+    if(count>=MD_MALLOC_SIMD_THRESHOLD){
+        __m256i v, inc;
+        v = _mm256_set_epi64x((long long)(size_t)(base+3*step), (long long)(size_t)(base+2*step),
+                              (long long)(size_t)(base+step), (long long)(size_t)base);
+        inc = _mm256_set1_epi64x((long long)(4*step));
+        for(; n+4<=count; n+=4){
+            _mm256_storeu_si256((__m256i*)(table+n), v);
+            v = _mm256_add_epi64(v, inc);
+        }
+    }
+#elif defined(MD_MALLOC_SSE2)
+    if(count>=MD_MALLOC_SIMD_THRESHOLD){
+        __m128i v, inc;
+        v = _mm_set_epi64x((long long)(size_t)(base+step), (long long)(size_t)base);
+        inc = _mm_set1_epi64x((long long)(2*step));
+        for(; n+2<=count; n+=2){
+            _mm_storeu_si128((__m128i*)(table+n), v);
+            v = _mm_add_epi64(v, inc);
+        }
+    }
+#elif defined(MD_MALLOC_NEON)
+    if(count>=MD_MALLOC_SIMD_THRESHOLD){
+        uint64x2_t v, inc;
+        v = vcombine_u64(vcreate_u64((uint64_t)(size_t)base), vcreate_u64((uint64_t)(size_t)(base+step)));
+        inc = vdupq_n_u64((uint64_t)(2*step));
+        for(; n+2<=count; n+=2){
+            vst1q_u64((uint64_t*)(table+n), v);
+            v = vaddq_u64(v, inc);
+        }
+    }
+#endif
+    p = base + n*step;
+    for(; n<count; n++){
+        table[n] = p;
+        p += step;
+    }
+}
+
+/* Same as md_fill_table(), but splits large tables across threads */
+static void md_fill_table_parallel(void** table, size_t count,
+                                   unsigned char* base, size_t step)
+{
+#if defined(MD_MALLOC_ENABLE_OPENMP) && defined(_OPENMP)
+    long c, nchunks;
+    size_t chunk;
+    if(count>=MD_MALLOC_OPENMP_THRESHOLD && omp_get_max_threads()>1 && !omp_in_parallel()){
+        nchunks = (long)omp_get_max_threads();
+        chunk = (count + (size_t)nchunks-1)/(size_t)nchunks;
+        #pragma omp parallel for schedule(static)
+        for(c=0; c<nchunks; c++){
+            size_t first = (size_t)c*chunk;
+            if(first<count)
+                md_fill_table(table+first, count-first<chunk ? count-first : chunk, base+first*step, step);
+        }
+        return;
+    }
+#endif
+    md_fill_table(table, count, base, step);
+}
+
+/* Fills in the pointer tables at the start of "ptr". Each table level is an
+ * arithmetic progression of addresses into the next level (or into the rows of
+ * the data block, "stride" bytes apart, for the last level). Large tables are
+ * split across threads, unless "serial" is set */
+static void md_build_tables_ex(void* ptr, size_t ndims, const size_t* dims,
+                               unsigned char* data, size_t stride, int serial)
+{
+    size_t l, count, step;
+    void** table;
+    unsigned char* p;
+#ifdef MD_MALLOC_ENABLE_STATS
+    size_t start_ns = md_time_ns();
+#endif
+    table = (void**)ptr;
+    count = dims[0];
+    for(l=0; l<ndims-1; l++){
+        if(l<ndims-2){
+            p = (unsigned char*)(table + count);
+            step = dims[l+1]*sizeof(void*);
+        }
+        else{
+            p = data;
+            step = stride;
+        }
+        if(serial)
+            md_fill_table(table, count, p, step);
+        else
+            md_fill_table_parallel(table, count, p, step);
+        table += count;
+        count *= dims[l+1];
+    }
+#ifdef MD_MALLOC_ENABLE_STATS
+    md_atomic_add(&md_stats_state.table_build_ns, md_time_ns() - start_ns);
+#endif
+}
+
+static void md_build_tables(void* ptr, size_t ndims, const size_t* dims,
+                            unsigned char* data, size_t stride)
+{
+    md_build_tables_ex(ptr, ndims, dims, data, stride, 0);
+}
+
+/* Row stride (in bytes) of "dim" elements, padded to a multiple of both
+ * "pitch_multiple" and "data_size", and optionally to an odd number of such
+ * multiples */
+static size_t md_pitch_stride(size_t dim, size_t data_size,
+                              size_t pitch_multiple, int avoid_aliasing)
+{
+    size_t a, b, t, unit, n;
+    if(pitch_multiple==0)
+        pitch_multiple = data_size;
+    /* lowest common multiple of pitch_multiple and data_size */
+    a = pitch_multiple;
+    b = data_size;
+    while(b!=0){
+        t = a%b;
+        a = b;
+        b = t;
+    }
+    unit = a==0 ? 0 : (pitch_multiple/a)*data_size;
+    if(unit==0)
+        return 0;
+    n = (dim*data_size + unit-1)/unit;
+    if(avoid_aliasing && n%2==0 && n!=0)
+        n++;
+    return n*unit;
+}
+
+/* (Re)allocates an "ndims" array (ndims>=2), with the data block starting on
+ * an "alignment" boundary, and optionally each innermost row too. Rows are
+ * instead "stride" bytes apart, if it is non-zero */
+static void* md_alloc(void* ptr, size_t ndims, const size_t* dims,
+                      size_t data_size, size_t alignment, int align_rows,
+                      size_t stride, int mode)
+{
+    size_t l, nrows, table_bytes, pad, total;
+    unsigned char* data;
+    if(alignment<sizeof(void*))
+        alignment = sizeof(void*);
+    if((alignment & (alignment-1)) != 0){
+#if !defined(NDEBUG)
+        fprintf(stderr, "Error: alignment of %zu bytes is not a power of 2.\n", alignment);
+#endif
+        return NULL;
+    }
+    nrows = 1;
+    for(l=0; l<ndims-1; l++)
+        nrows *= dims[l];
+    if(stride==0){
+        stride = dims[ndims-1]*data_size;
+        if(align_rows)
+            stride = MD_ALIGN_UP(stride, alignment);
+    }
+    table_bytes = md_table_count(ndims, dims)*sizeof(void*);
+    pad = alignment - sizeof(void*);
+    total = table_bytes + pad + nrows*stride;
+    md_stats_count(mode, ndims, total, table_bytes);
+    switch(mode){
+        case MD_MODE_CALLOC:  ptr = md_sys_calloc(total, 1); break;
+        case MD_MODE_REALLOC: ptr = md_sys_realloc(ptr, total); break;
+        default:              ptr = md_sys_malloc(total); break;
+    }
+    if(ptr==NULL)
+        return NULL;
+    data = (unsigned char*)ptr + table_bytes;
+    data += MD_ALIGN_UP((size_t)data, alignment) - (size_t)data;
+    md_build_tables(ptr, ndims, dims, data, stride);
+    return ptr;
+}
+
+/* (Re)allocates an "ndims" array with pitched rows (see malloc2d_pitched()) */
+static void* md_alloc_pitched(void* ptr, size_t ndims, const size_t* dims,
+                              size_t data_size, size_t pitch_multiple,
+                              int avoid_aliasing, size_t* pitch, int mode)
+{
+    size_t stride;
+    stride = md_pitch_stride(dims[ndims-1], data_size, pitch_multiple, avoid_aliasing);
+    if(pitch!=NULL)
+        *pitch = data_size==0 ? 0 : stride/data_size;
+    /* rows start on the largest power of 2 that divides the stride */
+    return md_alloc(ptr, ndims, dims, data_size, stride & (~stride+1), 0, stride, mode);
+}
+
+/* Allocates an "ndims" array (same layout as mallocNd()) MD_CACHE_HEADER bytes
+ * into its block, and registers it with the entry "e", owned by the thread
+ * cache "owner" (or NULL, for the global cache) */
+static void* md_alloc_recyclable(md_cache_entry* e, void* owner, size_t ndims,
+                                 const size_t* dims, size_t data_size, int mode)
+{
+    size_t total, table_bytes;
+    unsigned char* base;
+    unsigned char* ptr;
+    total = md_sizeof(ndims, dims, data_size, &table_bytes);
+    md_stats_count(mode, ndims, total, table_bytes);
+    if(mode==MD_MODE_CALLOC)
+        base = (unsigned char*)md_sys_calloc(total + MD_CACHE_HEADER, 1);
+    else
+        base = (unsigned char*)md_sys_malloc(total + MD_CACHE_HEADER);
+    if(base==NULL)
+        return NULL;
+    e->header = MD_CACHE_HEADER;
+    ptr = base + e->header;
+    md_build_tables(ptr, ndims, dims, ptr + table_bytes, dims[ndims-1]*data_size);
+    e->ptr = ptr;
+    e->owner = owner;
+    e->mapped = 0;
+    e->map = ptr;
+    e->file = 0;
+    md_cache_set_shape(e, ndims, dims, data_size);
+    md_cache_insert(e);
+    return ptr;
+}
+
+/* mallocNd()/callocNd() with the recycling cache enabled: returns a cached
+ * block of the same shape (pointer tables intact) if there is one, otherwise
+ * allocates a new (registered) block */
+static void* md_cache_alloc(size_t ndims, const size_t* dims, size_t data_size,
+                            int mode)
+{
+    size_t l, h, numel;
+    md_cache_entry** link;
+    md_cache_entry* e;
+    void* ptr;
+    if(ndims<2 || ndims>MD_MAX_NDIMS)
+        return md_alloc(NULL, ndims, dims, data_size, 0, 0, 0, mode);
+    h = md_cache_shape_hash(ndims, dims, data_size);
+    e = NULL;
+    md_lock(&md_cache_state.lock);
+    for(link = &md_cache_state.cached[h%MD_CACHE_SHAPE_BUCKETS]; *link!=NULL; link = &(*link)->next){
+        if((*link)->hash==h && (*link)->ndims==ndims && (*link)->data_size==data_size){
+            for(l=0; l<ndims && (*link)->dims[l]==dims[l]; l++) {}
+            if(l==ndims){
+                e = *link;
+                *link = e->next;
+                md_atomic_add(&md_cache_state.cached_bytes, (size_t)0 - e->bytes);
+                break;
+            }
+        }
+    }
+    md_unlock(&md_cache_state.lock);
+    if(e==NULL){
+        md_atomic_add(&md_cache_state.misses, 1);
+        e = (md_cache_entry*)malloc(sizeof(md_cache_entry));
+        if(e==NULL)
+            return md_alloc(NULL, ndims, dims, data_size, 0, 0, 0, mode); /* (just not cached) */
+        ptr = md_alloc_recyclable(e, NULL, ndims, dims, data_size, mode);
+        if(ptr==NULL)
+            free(e);
+        return ptr;
+    }
+    md_atomic_add(&md_cache_state.hits, 1);
+    md_cache_insert(e);
+    md_stats_count(mode, ndims, e->bytes, md_table_count(ndims, dims)*sizeof(void*));
+    ptr = e->ptr;
+    if(mode==MD_MODE_CALLOC){
+        numel = 1;
+        for(l=0; l<ndims; l++)
+            numel *= dims[l];
+        memset((unsigned char*)ptr + md_table_count(ndims, dims)*sizeof(void*), 0, numel*data_size);
+    }
+    return ptr;
+}
+
+#ifdef MD_MALLOC_HAVE_THREAD_CACHE
+/* mallocNd()/callocNd() with the per-thread caches enabled: the same as
+ * md_cache_alloc(), but using (only) the calling thread's cache */
+static void* md_tcache_alloc(size_t ndims, const size_t* dims, size_t data_size,
+                             int mode)
+{
+    size_t l, h, numel;
+    md_cache_entry** link;
+    md_cache_entry* e;
+    md_tcache* tc;
+    void* ptr;
+    tc = ndims<2 || ndims>MD_MAX_NDIMS ? NULL : md_tcache_self();
+    if(tc==NULL)
+        return md_alloc(NULL, ndims, dims, data_size, 0, 0, 0, mode);
+    h = md_cache_shape_hash(ndims, dims, data_size);
+    e = NULL;
+    md_lock(&tc->lock);
+    for(link = &tc->cached[h%MD_CACHE_SHAPE_BUCKETS]; *link!=NULL; link = &(*link)->next){
+        if((*link)->hash==h && (*link)->ndims==ndims && (*link)->data_size==data_size){
+            for(l=0; l<ndims && (*link)->dims[l]==dims[l]; l++) {}
+            if(l==ndims){
+                e = *link;
+                *link = e->next;
+                tc->cached_bytes -= e->bytes;
+                break;
+            }
+        }
+    }
+    if(e!=NULL)
+        tc->hits++;
+    else
+        tc->misses++;
+    md_unlock(&tc->lock);
+    if(e==NULL){
+        e = (md_cache_entry*)malloc(sizeof(md_cache_entry));
+        if(e==NULL)
+            return md_alloc(NULL, ndims, dims, data_size, 0, 0, 0, mode); /* (just not cached) */
+        ptr = md_alloc_recyclable(e, tc, ndims, dims, data_size, mode);
+        if(ptr==NULL)
+            free(e);
+        return ptr;
+    }
+    md_cache_insert(e);
+    md_stats_count(mode, ndims, e->bytes, md_table_count(ndims, dims)*sizeof(void*));
+    ptr = e->ptr;
+    if(mode==MD_MODE_CALLOC){
+        numel = 1;
+        for(l=0; l<ndims; l++)
+            numel *= dims[l];
+        memset((unsigned char*)ptr + md_table_count(ndims, dims)*sizeof(void*), 0, numel*data_size);
+    }
+    return ptr;
+}
+#endif
+
+/* mallocNd()/callocNd() backed by md_map() (falling back to md_alloc(), if
+ * nothing could be mapped). Since mapped memory is already zeroed, calloc
+ * requests cost nothing extra */
+static void* md_alloc_mapped(size_t ndims, const size_t* dims, size_t data_size,
+                             int mode, int huge)
+{
+    size_t total, table_bytes, mapped;
+    unsigned char* ptr;
+    total = md_sizeof(ndims, dims, data_size, &table_bytes);
+    ptr = (unsigned char*)md_map(total, &mapped, huge);
+    if(ptr!=NULL && !md_cache_track(ptr, ndims, dims, data_size, mapped, 1)){
+        md_unmap(ptr, mapped);
+        ptr = NULL;
+    }
+    if(ptr==NULL)
+        return md_alloc(NULL, ndims, dims, data_size, 0, 0, 0, mode);
+    md_stats_count(mode, ndims, total, table_bytes);
+    md_stats_live(mapped, 0);
+    md_build_tables(ptr, ndims, dims, ptr + table_bytes, dims[ndims-1]*data_size);
+    return ptr;
+}
+
+/* Zeroes the "dim1" slabs (of "slab" bytes each) starting at "data", in
+ * parallel; each thread touching the same slabs as it would be given by an
+ * OpenMP schedule(static) loop over dim1, so that the OS places their pages on
+ * that thread's node. With libnuma, MD_NUMA_INTERLEAVE slabs are instead bound
+ * to the nodes in turn beforehand */
+static void md_numa_place(unsigned char* data, size_t dim1, size_t slab,
+                          int policy)
+{
+    long i;
+#ifdef MD_MALLOC_ENABLE_NUMA
+    int n, nnodes, nodes[64];
+    size_t page, first, last;
+    nnodes = 0;
+    if(policy==MD_NUMA_INTERLEAVE && numa_available()>=0)
+        for(n=0; n<=numa_max_node() && nnodes<64; n++)
+            if(numa_bitmask_isbitset(numa_all_nodes_ptr, (unsigned int)n))
+                nodes[nnodes++] = n;
+#if !defined(NDEBUG)
+    if(policy==MD_NUMA_INTERLEAVE && nnodes<2)
+        fprintf(stderr, "Warning: MD_NUMA_INTERLEAVE fell back to first-touch placement (%s).\n",
+                numa_available()<0 ? "libnuma is unavailable" : "only one NUMA node");
+#endif
+    if(nnodes>1){
+        page = (size_t)numa_pagesize();
+        for(i=0; i<(long)dim1; i++){
+            /* (the pages which start within slab i) */
+            first = MD_ALIGN_UP((size_t)(data + (size_t)i*slab), page);
+            last = MD_ALIGN_UP((size_t)(data + (size_t)(i+1)*slab), page);
+            if(last>first)
+                numa_tonode_memory((void*)first, last-first, nodes[i%nnodes]);
+        }
+    }
+#elif !defined(NDEBUG)
+    if(policy==MD_NUMA_INTERLEAVE)
+        fprintf(stderr, "Warning: MD_NUMA_INTERLEAVE requires MD_MALLOC_ENABLE_NUMA; fell back to first-touch placement.\n");
+#else
+    (void)policy;
+#endif
+#if defined(MD_MALLOC_ENABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp parallel for schedule(static)
+#endif
+    for(i=0; i<(long)dim1; i++)
+        memset(data + (size_t)i*slab, 0, slab);
+}
+
+/* Moves the rows of an "ndims" array which overlap with its new shape, from
+ * their old positions (relative to "old_data") to their new positions
+ * (relative to "new_data"), within the same block. Rows that move towards the
+ * start of the block are moved first (in order), followed by those that move
+ * towards the end (in reverse order); so no row is overwritten before it has
+ * been moved itself */
+static void md_move_rows(unsigned char* old_data, unsigned char* new_data,
+                         size_t ndims, const size_t* old_dims,
+                         const size_t* new_dims, size_t data_size)
+{
+    size_t l, b, k, n, pass, nblocks, nspans, len, rem, idx, ro, rn, mo, mn;
+    size_t old_row, new_row;
+    unsigned char* src;
+    unsigned char* dst;
+    old_row = old_dims[ndims-1]*data_size;
+    new_row = new_dims[ndims-1]*data_size;
+    len = (old_dims[ndims-1]<new_dims[ndims-1] ? old_dims[ndims-1] : new_dims[ndims-1])*data_size;
+    nspans = old_dims[ndims-2]<new_dims[ndims-2] ? old_dims[ndims-2] : new_dims[ndims-2];
+    if(old_row==new_row){
+        /* consecutive rows are adjacent in both shapes, so move them as one */
+        len *= nspans;
+        nspans = nspans==0 ? 0 : 1;
+    }
+    nblocks = 1;
+    for(l=0; l<ndims-2; l++)
+        nblocks *= old_dims[l]<new_dims[l] ? old_dims[l] : new_dims[l];
+    if(len==0 || nspans==0 || nblocks==0)
+        return;
+    for(pass=0; pass<2; pass++){
+        for(n=0; n<nblocks; n++){
+            b = pass==0 ? n : nblocks-1-n;
+            /* index of the first row of this block, in the old and new shapes */
+            rem = b;
+            ro = rn = 0;
+            mo = old_dims[ndims-2];
+            mn = new_dims[ndims-2];
+            for(l=ndims-2; l-->0;){
+                idx = rem % (old_dims[l]<new_dims[l] ? old_dims[l] : new_dims[l]);
+                rem /= old_dims[l]<new_dims[l] ? old_dims[l] : new_dims[l];
+                ro += idx*mo;
+                rn += idx*mn;
+                mo *= old_dims[l];
+                mn *= new_dims[l];
+            }
+            for(k=0; k<nspans; k++){
+                idx = pass==0 ? k : nspans-1-k;
+                src = old_data + (ro+idx)*old_row;
+                dst = new_data + (rn+idx)*new_row;
+                if(pass==0 ? dst<src : dst>src)
+                    memmove(dst, src, len);
+            }
+        }
+    }
+}
+
+/* Whether an array should go to md_alloc_mapped() (see md_huge_set_threshold()) */
+static int md_is_huge(size_t ndims, const size_t* dims, size_t data_size)
+{
+    size_t threshold = md_atomic_load(&md_cache_state.huge_threshold);
+    return threshold!=0 && md_sizeof(ndims, dims, data_size, NULL)>=threshold;
+}
+
+void* mallocNd(size_t ndims, const size_t* dims, size_t data_size)
+{
+    if(ndims==0)
+        return NULL;
+    if(md_is_huge(ndims, dims, data_size))
+        return md_alloc_mapped(ndims, dims, data_size, MD_MODE_MALLOC, 1);
+#ifdef MD_MALLOC_HAVE_THREAD_CACHE
+    if(md_tcache_enabled())
+        return md_tcache_alloc(ndims, dims, data_size, MD_MODE_MALLOC);
+#endif
+    if(md_atomic_load(&md_cache_state.limit)!=0)
+        return md_cache_alloc(ndims, dims, data_size, MD_MODE_MALLOC);
+    return md_alloc(NULL, ndims, dims, data_size, 0, 0, 0, MD_MODE_MALLOC);
+}
+
+void* callocNd(size_t ndims, const size_t* dims, size_t data_size)
+{
+    if(ndims==0)
+        return NULL;
+    if(md_is_huge(ndims, dims, data_size))
+        return md_alloc_mapped(ndims, dims, data_size, MD_MODE_CALLOC, 1);
+#ifdef MD_MALLOC_HAVE_THREAD_CACHE
+    if(md_tcache_enabled())
+        return md_tcache_alloc(ndims, dims, data_size, MD_MODE_CALLOC);
+#endif
+    if(md_atomic_load(&md_cache_state.limit)!=0)
+        return md_cache_alloc(ndims, dims, data_size, MD_MODE_CALLOC);
+    return md_alloc(NULL, ndims, dims, data_size, 0, 0, 0, MD_MODE_CALLOC);
+}
+
+void* reallocNd(void* ptr, size_t ndims, const size_t* dims, size_t data_size)
+{
+    if(ndims==0)
+        return NULL;
+    ptr = md_alloc(ptr, ndims, dims, data_size, 0, 0, 0, MD_MODE_REALLOC);
+    /* (recyclable arrays stay registered, under their new shape) */
+    md_cache_track(ptr, ndims, dims, data_size, 0, 0);
+    return ptr;
+}
+
+void* reallocNd_preserve(void* ptr, size_t ndims, const size_t* old_dims, const size_t* new_dims, size_t data_size)
+{
+    size_t l, old_rows, new_rows, old_tables, new_tables, old_total, new_total;
+    void* tmp;
+    if(ptr==NULL)
+        return mallocNd(ndims, new_dims, data_size);
+    if(ndims==0)
+        return NULL;
+    if(ndims==1)
+        return realloc1d(ptr, new_dims[0]*data_size);
+    old_rows = new_rows = 1;
+    for(l=0; l<ndims-1; l++){
+        old_rows *= old_dims[l];
+        new_rows *= new_dims[l];
+    }
+    old_tables = md_table_count(ndims, old_dims)*sizeof(void*);
+    new_tables = md_table_count(ndims, new_dims)*sizeof(void*);
+    old_total = old_tables + old_rows*old_dims[ndims-1]*data_size;
+    new_total = new_tables + new_rows*new_dims[ndims-1]*data_size;
+    md_stats_count(MD_STATS_REALLOC, ndims, new_total, new_tables);
+    /* grow first (so there is room to move the data into), or shrink last */
+    if(new_total>old_total){
+        ptr = md_sys_realloc(ptr, new_total);
+        if(ptr==NULL)
+            return NULL;
+    }
+    md_move_rows((unsigned char*)ptr + old_tables, (unsigned char*)ptr + new_tables,
+                 ndims, old_dims, new_dims, data_size);
+    if(new_total<old_total){
+        tmp = md_sys_realloc(ptr, new_total);
+        if(tmp!=NULL || new_total==0)
+            ptr = tmp;
+        if(ptr==NULL)
+            return NULL;
+    }
+    md_build_tables(ptr, ndims, new_dims, (unsigned char*)ptr + new_tables, new_dims[ndims-1]*data_size);
+    /* (recyclable arrays stay registered, under their new shape) */
+    md_cache_track(ptr, ndims, new_dims, data_size, 0, 0);
+    return ptr;
+}
+
+size_t md_sizeof(size_t ndims, const size_t* dims, size_t data_size, size_t* overhead)
+{
+    size_t l, numel, table_bytes;
+    if(ndims==0){
+        if(overhead!=NULL)
+            *overhead = 0;
+        return 0;
+    }
+    numel = 1;
+    for(l=0; l<ndims; l++)
+        numel *= dims[l];
+    table_bytes = md_table_count(ndims, dims)*sizeof(void*);
+    if(overhead!=NULL)
+        *overhead = table_bytes;
+    return table_bytes + numel*data_size;
+}
+
+void* flattenNd(void* ptr, size_t ndims)
+{
+    size_t l;
+    for(l=1; l<ndims && ptr!=NULL; l++)
+        ptr = *(void**)ptr;
+    return ptr;
+}
+
+/* dst[n] = src[n] + delta, for the "count" pointers of a table */
+static void md_rebase_table(void** dst, void* const* src, size_t count,
+                            size_t delta)
+{
+    size_t n;
+    n = 0;
+#if defined(MD_MALLOC_AVX512)
+    if(count>=MD_MALLOC_SIMD_THRESHOLD){
+        __m512i d;
+        d = _mm512_set1_epi64((long long)delta);
+        for(; n+8<=count; n+=8)
+            _mm512_storeu_si512((void*)(dst+n), _mm512_add_epi64(_mm512_loadu_si512((const void*)(src+n)), d));
+    }
+#elif defined(MD_MALLOC_AVX2)
+    if(count>=MD_MALLOC_SIMD_THRESHOLD){
+        __m256i d;
+        d = _mm256_set1_epi64x((long long)delta);
+        for(; n+4<=count; n+=4)
+            _mm256_storeu_si256((__m256i*)(dst+n), _mm256_add_epi64(_mm256_loadu_si256((const __m256i*)(src+n)), d));
+    }
+#elif defined(MD_MALLOC_SSE2)
+    if(count>=MD_MALLOC_SIMD_THRESHOLD){
+        __m128i d;
+        d = _mm_set1_epi64x((long long)delta);
+        for(; n+2<=count; n+=2)
+            _mm_storeu_si128((__m128i*)(dst+n), _mm_add_epi64(_mm_loadu_si128((const __m128i*)(src+n)), d));
+    }
+#elif defined(MD_MALLOC_NEON)
+    if(count>=MD_MALLOC_SIMD_THRESHOLD){
+        uint64x2_t d;
+        d = vdupq_n_u64((uint64_t)delta);
+        for(; n+2<=count; n+=2)
+            vst1q_u64((uint64_t*)(dst+n), vaddq_u64(vld1q_u64((const uint64_t*)(src+n)), d));
+    }
+#endif
+    for(; n<count; n++)
+        dst[n] = (void*)((size_t)src[n] + delta);
+}
+
+/* Returns 1 if every pointer in the tables of "src" is where mallocNd() would
+ * have put it (i.e. each level directly follows the last, and the rows are
+ * packed directly after the tables); the data merely following the tables is
+ * not enough, since pitched and aligned-row arrays may do so too */
+static int md_has_default_layout(unsigned char* src, size_t ndims,
+                                 const size_t* dims, size_t data_size)
+{
+    size_t l, i, count, step;
+    void** table;
+    unsigned char* next;
+    table = (void**)src;
+    count = 1;
+    for(l=0; l<ndims-1; l++){
+        count *= dims[l];
+        next = (unsigned char*)(table + count);
+        step = l<ndims-2 ? dims[l+1]*sizeof(void*) : dims[ndims-1]*data_size;
+        for(i=0; i<count; i++)
+            if((unsigned char*)table[i]!=next + i*step)
+                return 0;
+        table += count;
+    }
+    return 1;
+}
+
+/* Copies the array "src" (which must have the default layout) into "dst",
+ * rebasing its pointer tables; returns 0 if "src" has another layout */
+static int md_clone_into(unsigned char* dst, unsigned char* src, size_t ndims,
+                         const size_t* dims, size_t data_size)
+{
+    size_t total, table_bytes;
+    total = md_sizeof(ndims, dims, data_size, &table_bytes);
+    if(!md_has_default_layout(src, ndims, dims, data_size)){
+#if !defined(NDEBUG)
+        fprintf(stderr, "Error: only arrays with the default layout (as from mallocNd()) may be cloned.\n");
+#endif
+        return 0;
+    }
+    md_rebase_table((void**)dst, (void* const*)src, table_bytes/sizeof(void*), (size_t)dst - (size_t)src);
+    memcpy(dst + table_bytes, src + table_bytes, total - table_bytes);
+    return 1;
+}
+
+void* md_cloneNd(void* ptr, size_t ndims, const size_t* dims, size_t data_size)
+{
+    size_t total, table_bytes;
+    void* clone;
+    if(ptr==NULL || ndims==0)
+        return NULL;
+    total = md_sizeof(ndims, dims, data_size, &table_bytes);
+    md_stats_count(MD_MODE_MALLOC, ndims, total, table_bytes);
+    clone = md_sys_malloc(total);
+    if(clone==NULL)
+        return NULL;
+    if(!md_clone_into((unsigned char*)clone, (unsigned char*)ptr, ndims, dims, data_size)){
+        md_sys_free(clone);
+        return NULL;
+    }
+    return clone;
+}
+
+void** md_clone2d(void** ptr, size_t dim1, size_t dim2, size_t data_size)
+{
+    size_t dims[2];
+    dims[0] = dim1; dims[1] = dim2;
+    return (void**)md_cloneNd((void*)ptr, 2, dims, data_size);
+}
+
+void*** md_clone3d(void*** ptr, size_t dim1, size_t dim2, size_t dim3, size_t data_size)
+{
+    size_t dims[3];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3;
+    return (void***)md_cloneNd((void*)ptr, 3, dims, data_size);
+}
+
+void**** md_clone4d(void**** ptr, size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t data_size)
+{
+    size_t dims[4];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4;
+    return (void****)md_cloneNd((void*)ptr, 4, dims, data_size);
+}
+
+void***** md_clone5d(void***** ptr, size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t data_size)
+{
+    size_t dims[5];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5;
+    return (void*****)md_cloneNd((void*)ptr, 5, dims, data_size);
+}
+
+void****** md_clone6d(void****** ptr, size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t dim6, size_t data_size)
+{
+    size_t dims[6];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5; dims[5] = dim6;
+    return (void******)md_cloneNd((void*)ptr, 6, dims, data_size);
+}
+
+void* md_copy_into(void* dst, void* src, size_t ndims, const size_t* dims, size_t data_size)
+{
+    if(dst==NULL || src==NULL || ndims==0)
+        return NULL;
+    if(dst==src)
+        return dst;
+    if(!md_clone_into((unsigned char*)dst, (unsigned char*)src, ndims, dims, data_size))
+        return NULL;
+    return dst;
+}
+
+void** malloc2d(size_t dim1, size_t dim2, size_t data_size)
+{
+    size_t dims[2];
+    dims[0] = dim1; dims[1] = dim2;
+    return (void**)mallocNd(2, dims, data_size);
+}
+
+void** calloc2d(size_t dim1, size_t dim2, size_t data_size)
+{
+    size_t dims[2];
+    dims[0] = dim1; dims[1] = dim2;
+    return (void**)callocNd(2, dims, data_size);
+}
+
+void** realloc2d(void** ptr, size_t dim1, size_t dim2, size_t data_size)
+{
+    size_t dims[2];
+    dims[0] = dim1; dims[1] = dim2;
+    return (void**)reallocNd((void*)ptr, 2, dims, data_size);
+}
+
+void*** malloc3d(size_t dim1, size_t dim2, size_t dim3, size_t data_size)
+{
+    size_t dims[3];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3;
+    return (void***)mallocNd(3, dims, data_size);
+}
+
+void*** calloc3d(size_t dim1, size_t dim2, size_t dim3, size_t data_size)
+{
+    size_t dims[3];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3;
+    return (void***)callocNd(3, dims, data_size);
+}
+
+void*** realloc3d(void*** ptr, size_t dim1, size_t dim2, size_t dim3, size_t data_size)
+{
+    size_t dims[3];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3;
+    return (void***)reallocNd((void*)ptr, 3, dims, data_size);
+}
+
+void**** malloc4d(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t data_size)
+{
+    size_t dims[4];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4;
+    return (void****)mallocNd(4, dims, data_size);
+}
+
+void**** calloc4d(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t data_size)
+{
+    size_t dims[4];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4;
+    return (void****)callocNd(4, dims, data_size);
+}
+
+void**** realloc4d(void**** ptr, size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t data_size)
+{
+    size_t dims[4];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4;
+    return (void****)reallocNd((void*)ptr, 4, dims, data_size);
+}
+
+void***** malloc5d(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t data_size)
+{
+    size_t dims[5];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5;
+    return (void*****)mallocNd(5, dims, data_size);
+}
+
+void***** calloc5d(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t data_size)
+{
+    size_t dims[5];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5;
+    return (void*****)callocNd(5, dims, data_size);
+}
+
+void***** realloc5d(void***** ptr, size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t data_size)
+{
+    size_t dims[5];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5;
+    return (void*****)reallocNd((void*)ptr, 5, dims, data_size);
+}
+
+void****** malloc6d(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t dim6, size_t data_size)
+{
+    size_t dims[6];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5; dims[5] = dim6;
+    return (void******)mallocNd(6, dims, data_size);
+}
+
+void****** calloc6d(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t dim6, size_t data_size)
+{
+    size_t dims[6];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5; dims[5] = dim6;
+    return (void******)callocNd(6, dims, data_size);
+}
+
+void****** realloc6d(void****** ptr, size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t dim6, size_t data_size)
+{
+    size_t dims[6];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5; dims[5] = dim6;
+    return (void******)reallocNd((void*)ptr, 6, dims, data_size);
+}
+
+void** realloc2d_preserve(void** ptr, size_t old_dim1, size_t old_dim2, size_t new_dim1, size_t new_dim2, size_t data_size)
+{
+    size_t old_dims[2], new_dims[2];
+    old_dims[0] = old_dim1; old_dims[1] = old_dim2;
+    new_dims[0] = new_dim1; new_dims[1] = new_dim2;
+    return (void**)reallocNd_preserve((void*)ptr, 2, old_dims, new_dims, data_size);
+}
+
+void*** realloc3d_preserve(void*** ptr, size_t old_dim1, size_t old_dim2, size_t old_dim3, size_t new_dim1, size_t new_dim2, size_t new_dim3, size_t data_size)
+{
+    size_t old_dims[3], new_dims[3];
+    old_dims[0] = old_dim1; old_dims[1] = old_dim2; old_dims[2] = old_dim3;
+    new_dims[0] = new_dim1; new_dims[1] = new_dim2; new_dims[2] = new_dim3;
+    return (void***)reallocNd_preserve((void*)ptr, 3, old_dims, new_dims, data_size);
+}
+
+void**** realloc4d_preserve(void**** ptr, size_t old_dim1, size_t old_dim2, size_t old_dim3, size_t old_dim4, size_t new_dim1, size_t new_dim2, size_t new_dim3, size_t new_dim4, size_t data_size)
+{
+    size_t old_dims[4], new_dims[4];
+    old_dims[0] = old_dim1; old_dims[1] = old_dim2; old_dims[2] = old_dim3; old_dims[3] = old_dim4;
+    new_dims[0] = new_dim1; new_dims[1] = new_dim2; new_dims[2] = new_dim3; new_dims[3] = new_dim4;
+    return (void****)reallocNd_preserve((void*)ptr, 4, old_dims, new_dims, data_size);
+}
+
+void***** realloc5d_preserve(void***** ptr, size_t old_dim1, size_t old_dim2, size_t old_dim3, size_t old_dim4, size_t old_dim5, size_t new_dim1, size_t new_dim2, size_t new_dim3, size_t new_dim4, size_t new_dim5, size_t data_size)
+{
+    size_t old_dims[5], new_dims[5];
+    old_dims[0] = old_dim1; old_dims[1] = old_dim2; old_dims[2] = old_dim3; old_dims[3] = old_dim4; old_dims[4] = old_dim5;
+    new_dims[0] = new_dim1; new_dims[1] = new_dim2; new_dims[2] = new_dim3; new_dims[3] = new_dim4; new_dims[4] = new_dim5;
+    return (void*****)reallocNd_preserve((void*)ptr, 5, old_dims, new_dims, data_size);
+}
+
+void****** realloc6d_preserve(void****** ptr, size_t old_dim1, size_t old_dim2, size_t old_dim3, size_t old_dim4, size_t old_dim5, size_t old_dim6, size_t new_dim1, size_t new_dim2, size_t new_dim3, size_t new_dim4, size_t new_dim5, size_t new_dim6, size_t data_size)
+{
+    size_t old_dims[6], new_dims[6];
+    old_dims[0] = old_dim1; old_dims[1] = old_dim2; old_dims[2] = old_dim3; old_dims[3] = old_dim4; old_dims[4] = old_dim5; old_dims[5] = old_dim6;
+    new_dims[0] = new_dim1; new_dims[1] = new_dim2; new_dims[2] = new_dim3; new_dims[3] = new_dim4; new_dims[4] = new_dim5; new_dims[5] = new_dim6;
+    return (void******)reallocNd_preserve((void*)ptr, 6, old_dims, new_dims, data_size);
+}
+
+void** aligned_malloc2d(size_t dim1, size_t dim2, size_t data_size, size_t alignment, int align_rows)
+{
+    size_t dims[2];
+    dims[0] = dim1; dims[1] = dim2;
+    return (void**)md_alloc(NULL, 2, dims, data_size, alignment, align_rows, 0, MD_MODE_MALLOC);
+}
+
+void** aligned_calloc2d(size_t dim1, size_t dim2, size_t data_size, size_t alignment, int align_rows)
+{
+    size_t dims[2];
+    dims[0] = dim1; dims[1] = dim2;
+    return (void**)md_alloc(NULL, 2, dims, data_size, alignment, align_rows, 0, MD_MODE_CALLOC);
+}
+
+void** aligned_realloc2d(void** ptr, size_t dim1, size_t dim2, size_t data_size, size_t alignment, int align_rows)
+{
+    size_t dims[2];
+    dims[0] = dim1; dims[1] = dim2;
+    return (void**)md_alloc(ptr, 2, dims, data_size, alignment, align_rows, 0, MD_MODE_REALLOC);
+}
+
+void*** aligned_malloc3d(size_t dim1, size_t dim2, size_t dim3, size_t data_size, size_t alignment, int align_rows)
+{
+    size_t dims[3];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3;
+    return (void***)md_alloc(NULL, 3, dims, data_size, alignment, align_rows, 0, MD_MODE_MALLOC);
+}
+
+void*** aligned_calloc3d(size_t dim1, size_t dim2, size_t dim3, size_t data_size, size_t alignment, int align_rows)
+{
+    size_t dims[3];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3;
+    return (void***)md_alloc(NULL, 3, dims, data_size, alignment, align_rows, 0, MD_MODE_CALLOC);
+}
+
+void*** aligned_realloc3d(void*** ptr, size_t dim1, size_t dim2, size_t dim3, size_t data_size, size_t alignment, int align_rows)
+{
+    size_t dims[3];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3;
+    return (void***)md_alloc(ptr, 3, dims, data_size, alignment, align_rows, 0, MD_MODE_REALLOC);
+}
+
+void**** aligned_malloc4d(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t data_size, size_t alignment, int align_rows)
+{
+    size_t dims[4];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4;
+    return (void****)md_alloc(NULL, 4, dims, data_size, alignment, align_rows, 0, MD_MODE_MALLOC);
+}
+
+void**** aligned_calloc4d(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t data_size, size_t alignment, int align_rows)
+{
+    size_t dims[4];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4;
+    return (void****)md_alloc(NULL, 4, dims, data_size, alignment, align_rows, 0, MD_MODE_CALLOC);
+}
+
+void**** aligned_realloc4d(void**** ptr, size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t data_size, size_t alignment, int align_rows)
+{
+    size_t dims[4];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4;
+    return (void****)md_alloc(ptr, 4, dims, data_size, alignment, align_rows, 0, MD_MODE_REALLOC);
+}
+
+void***** aligned_malloc5d(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t data_size, size_t alignment, int align_rows)
+{
+    size_t dims[5];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5;
+    return (void*****)md_alloc(NULL, 5, dims, data_size, alignment, align_rows, 0, MD_MODE_MALLOC);
+}
+
+void***** aligned_calloc5d(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t data_size, size_t alignment, int align_rows)
+{
+    size_t dims[5];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5;
+    return (void*****)md_alloc(NULL, 5, dims, data_size, alignment, align_rows, 0, MD_MODE_CALLOC);
+}
+
+void***** aligned_realloc5d(void***** ptr, size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t data_size, size_t alignment, int align_rows)
+{
+    size_t dims[5];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5;
+    return (void*****)md_alloc(ptr, 5, dims, data_size, alignment, align_rows, 0, MD_MODE_REALLOC);
+}
+
+void****** aligned_malloc6d(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t dim6, size_t data_size, size_t alignment, int align_rows)
+{
+    size_t dims[6];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5; dims[5] = dim6;
+    return (void******)md_alloc(NULL, 6, dims, data_size, alignment, align_rows, 0, MD_MODE_MALLOC);
+}
+
+void****** aligned_calloc6d(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t dim6, size_t data_size, size_t alignment, int align_rows)
+{
+    size_t dims[6];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5; dims[5] = dim6;
+    return (void******)md_alloc(NULL, 6, dims, data_size, alignment, align_rows, 0, MD_MODE_CALLOC);
+}
+
+void****** aligned_realloc6d(void****** ptr, size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t dim6, size_t data_size, size_t alignment, int align_rows)
+{
+    size_t dims[6];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5; dims[5] = dim6;
+    return (void******)md_alloc(ptr, 6, dims, data_size, alignment, align_rows, 0, MD_MODE_REALLOC);
+}
+
+void** malloc2d_pitched(size_t dim1, size_t dim2, size_t data_size, size_t pitch_multiple, int avoid_aliasing, size_t* pitch)
+{
+    size_t dims[2];
+    dims[0] = dim1; dims[1] = dim2;
+    return (void**)md_alloc_pitched(NULL, 2, dims, data_size, pitch_multiple, avoid_aliasing, pitch, MD_MODE_MALLOC);
+}
+
+void** calloc2d_pitched(size_t dim1, size_t dim2, size_t data_size, size_t pitch_multiple, int avoid_aliasing, size_t* pitch)
+{
+    size_t dims[2];
+    dims[0] = dim1; dims[1] = dim2;
+    return (void**)md_alloc_pitched(NULL, 2, dims, data_size, pitch_multiple, avoid_aliasing, pitch, MD_MODE_CALLOC);
+}
+
+void*** malloc3d_pitched(size_t dim1, size_t dim2, size_t dim3, size_t data_size, size_t pitch_multiple, int avoid_aliasing, size_t* pitch)
+{
+    size_t dims[3];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3;
+    return (void***)md_alloc_pitched(NULL, 3, dims, data_size, pitch_multiple, avoid_aliasing, pitch, MD_MODE_MALLOC);
+}
+
+void*** calloc3d_pitched(size_t dim1, size_t dim2, size_t dim3, size_t data_size, size_t pitch_multiple, int avoid_aliasing, size_t* pitch)
+{
+    size_t dims[3];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3;
+    return (void***)md_alloc_pitched(NULL, 3, dims, data_size, pitch_multiple, avoid_aliasing, pitch, MD_MODE_CALLOC);
+}
+
+void**** malloc4d_pitched(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t data_size, size_t pitch_multiple, int avoid_aliasing, size_t* pitch)
+{
+    size_t dims[4];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4;
+    return (void****)md_alloc_pitched(NULL, 4, dims, data_size, pitch_multiple, avoid_aliasing, pitch, MD_MODE_MALLOC);
+}
+
+void**** calloc4d_pitched(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t data_size, size_t pitch_multiple, int avoid_aliasing, size_t* pitch)
+{
+    size_t dims[4];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4;
+    return (void****)md_alloc_pitched(NULL, 4, dims, data_size, pitch_multiple, avoid_aliasing, pitch, MD_MODE_CALLOC);
+}
+
+void***** malloc5d_pitched(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t data_size, size_t pitch_multiple, int avoid_aliasing, size_t* pitch)
+{
+    size_t dims[5];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5;
+    return (void*****)md_alloc_pitched(NULL, 5, dims, data_size, pitch_multiple, avoid_aliasing, pitch, MD_MODE_MALLOC);
+}
+
+void***** calloc5d_pitched(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t data_size, size_t pitch_multiple, int avoid_aliasing, size_t* pitch)
+{
+    size_t dims[5];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5;
+    return (void*****)md_alloc_pitched(NULL, 5, dims, data_size, pitch_multiple, avoid_aliasing, pitch, MD_MODE_CALLOC);
+}
+
+void****** malloc6d_pitched(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t dim6, size_t data_size, size_t pitch_multiple, int avoid_aliasing, size_t* pitch)
+{
+    size_t dims[6];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5; dims[5] = dim6;
+    return (void******)md_alloc_pitched(NULL, 6, dims, data_size, pitch_multiple, avoid_aliasing, pitch, MD_MODE_MALLOC);
+}
+
+void****** calloc6d_pitched(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t dim6, size_t data_size, size_t pitch_multiple, int avoid_aliasing, size_t* pitch)
+{
+    size_t dims[6];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5; dims[5] = dim6;
+    return (void******)md_alloc_pitched(NULL, 6, dims, data_size, pitch_multiple, avoid_aliasing, pitch, MD_MODE_CALLOC);
+}
+
+void md_view_wrap(md_view* view, void* data, size_t ndims, const size_t* dims, size_t data_size)
+{
+    size_t l, stride;
+    memset(view, 0, sizeof(md_view));
+    if(ndims>MD_MAX_NDIMS){
+#if !defined(NDEBUG)
+        fprintf(stderr, "Error: md_view supports up to %d dimensions.\n", (int)MD_MAX_NDIMS);
+#endif
+        return;
+    }
+    view->data = data;
+    view->ndims = ndims;
+    view->data_size = data_size;
+    stride = 1;
+    for(l=ndims; l-->0;){
+        view->dims[l] = dims[l];
+        view->strides[l] = stride;
+        stride *= dims[l];
+    }
+}
+
+void* md_view_malloc(md_view* view, size_t ndims, const size_t* dims, size_t data_size)
+{
+    md_view_wrap(view, NULL, ndims, dims, data_size);
+    if(view->ndims==0)
+        return NULL;
+    view->data = malloc1d(md_view_numel(view)*data_size);
+    return view->data;
+}
+
+void* md_view_calloc(md_view* view, size_t ndims, const size_t* dims, size_t data_size)
+{
+    md_view_wrap(view, NULL, ndims, dims, data_size);
+    if(view->ndims==0)
+        return NULL;
+    view->data = calloc1d(md_view_numel(view), data_size);
+    return view->data;
+}
+
+void md_view_free(md_view* view)
+{
+    free1d(view->data);
+    memset(view, 0, sizeof(md_view));
+}
+
+size_t md_view_offset(const md_view* view, const size_t* index)
+{
+    size_t l, offset;
+    offset = 0;
+    for(l=0; l<view->ndims; l++)
+        offset += index[l]*view->strides[l];
+    return offset;
+}
+
+size_t md_view_numel(const md_view* view)
+{
+    size_t l, numel;
+    if(view->ndims==0)
+        return 0;
+    numel = 1;
+    for(l=0; l<view->ndims; l++)
+        numel *= view->dims[l];
+    return numel;
+}
+
+/* Checks the ranges of md_slice()/md_view_slice(); returns the number of axes
+ * which remain, or (size_t)-1 if a range is out of bounds */
+static size_t md_check_ranges(size_t ndims, const size_t* dims,
+                              const md_range* ranges)
+{
+    size_t a, r;
+    for(a=0, r=0; a<ndims; a++){
+        if(ranges[a].step==0 ? ranges[a].start>=dims[a] :
+           ranges[a].count!=0 && (ranges[a].start>=dims[a] ||
+                                  (ranges[a].count-1) > (dims[a]-1-ranges[a].start)/ranges[a].step)){
+#if !defined(NDEBUG)
+            fprintf(stderr, "Error: the range of axis %zu is outside of its %zu elements.\n", a, dims[a]);
+#endif
+            return (size_t)-1;
+        }
+        r += ranges[a].step!=0;
+    }
+    return r;
+}
+
+void* md_slice(void* ptr, size_t ndims, const size_t* dims, const md_range* ranges, size_t data_size)
+{
+    size_t a, l, r, n, rem, count, table_bytes, idx[MD_MAX_NDIMS], odims[MD_MAX_NDIMS], axis[MD_MAX_NDIMS];
+    void** out;
+    void** table;
+    void* p;
+    if(ptr==NULL || ndims<2 || ndims>MD_MAX_NDIMS)
+        return NULL;
+    r = md_check_ranges(ndims, dims, ranges);
+    if(r==(size_t)-1)
+        return NULL;
+    if(r<2 || ranges[ndims-1].step!=1){
+#if !defined(NDEBUG)
+        fprintf(stderr, "Error: md_slice() needs at least 2 axes to remain, and the last with a step of 1 (see md_view_slice()).\n");
+#endif
+        return NULL;
+    }
+    for(a=0, l=0; a<ndims; a++){
+        idx[a] = ranges[a].start;
+        if(ranges[a].step!=0){
+            odims[l] = ranges[a].count;
+            axis[l++] = a;
+        }
+    }
+    table_bytes = md_table_count(r, odims)*sizeof(void*);
+    md_stats_count(MD_STATS_MALLOC, r, table_bytes, table_bytes);
+    out = (void**)md_sys_malloc(table_bytes==0 ? sizeof(void*) : table_bytes);
+    if(out==NULL)
+        return NULL;
+    /* the upper levels point into the next level, as usual */
+    table = out;
+    count = odims[0];
+    for(l=0; l<r-2; l++){
+        md_fill_table(table, count, (unsigned char*)(table + count), odims[l+1]*sizeof(void*));
+        table += count;
+        count *= odims[l+1];
+    }
+    /* while each row of the last level is found through the source's tables */
+    for(n=0; n<count; n++){
+        rem = n;
+        for(l=r-1; l-->0;){
+            idx[axis[l]] = ranges[axis[l]].start + (rem%odims[l])*ranges[axis[l]].step;
+            rem /= odims[l];
+        }
+        p = ptr;
+        for(a=0; a<ndims-1; a++)
+            p = ((void**)p)[idx[a]];
+        table[n] = (unsigned char*)p + ranges[ndims-1].start*data_size;
+    }
+    return out;
+}
+
+void** md_slice3d(void*** ptr, size_t dim1, size_t dim2, size_t dim3, size_t axis, size_t index, size_t data_size)
+{
+    size_t l, dims[3];
+    md_range ranges[3];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3;
+    for(l=0; l<3; l++){
+        ranges[l].start = l==axis ? index : 0;
+        ranges[l].count = dims[l];
+        ranges[l].step = l==axis ? 0 : 1;
+    }
+    return (void**)md_slice((void*)ptr, 3, dims, ranges, data_size);
+}
+
+void** md_subarray2d(void** ptr, size_t dim1, size_t dim2, size_t first1, size_t first2,
+                     size_t count1, size_t count2, size_t data_size)
+{
+    size_t dims[2];
+    md_range ranges[2];
+    dims[0] = dim1; dims[1] = dim2;
+    ranges[0].start = first1; ranges[0].count = count1; ranges[0].step = 1;
+    ranges[1].start = first2; ranges[1].count = count2; ranges[1].step = 1;
+    return (void**)md_slice((void*)ptr, 2, dims, ranges, data_size);
+}
+
+void*** md_subarray3d(void*** ptr, size_t dim1, size_t dim2, size_t dim3, size_t first1, size_t first2,
+                      size_t first3, size_t count1, size_t count2, size_t count3, size_t data_size)
+{
+    size_t dims[3];
+    md_range ranges[3];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3;
+    ranges[0].start = first1; ranges[0].count = count1; ranges[0].step = 1;
+    ranges[1].start = first2; ranges[1].count = count2; ranges[1].step = 1;
+    ranges[2].start = first3; ranges[2].count = count3; ranges[2].step = 1;
+    return (void***)md_slice((void*)ptr, 3, dims, ranges, data_size);
+}
+
+void md_view_slice(md_view* view, const md_view* src, const md_range* ranges)
+{
+    size_t a, offset;
+    md_view out; /* (so that "view" may also be "src") */
+    memset(&out, 0, sizeof(md_view));
+    if(md_check_ranges(src->ndims, src->dims, ranges)==(size_t)-1){
+        memset(view, 0, sizeof(md_view));
+        return;
+    }
+    out.data_size = src->data_size;
+    offset = 0;
+    for(a=0; a<src->ndims; a++){
+        offset += ranges[a].start*src->strides[a];
+        if(ranges[a].step!=0){
+            out.dims[out.ndims] = ranges[a].count;
+            out.strides[out.ndims] = ranges[a].step*src->strides[a];
+            out.ndims++;
+        }
+    }
+    out.data = (unsigned char*)src->data + offset*src->data_size;
+    *view = out;
+}
+
+void md_stats_snapshot(md_stats* stats)
+{
+#ifdef MD_MALLOC_ENABLE_STATS
+    int k, r;
+    size_t start_ns;
+    for(k=0; k<3; k++){
+        for(r=0; r<MD_STATS_MAX_RANK; r++){
+            stats->calls[k][r] = md_atomic_load(&md_stats_state.calls[k][r]);
+            stats->large_calls[k][r] = md_atomic_load(&md_stats_state.large_calls[k][r]);
+        }
+    }
+    stats->bytes_requested = md_atomic_load(&md_stats_state.bytes_requested);
+    stats->table_bytes = md_atomic_load(&md_stats_state.table_bytes);
+    stats->table_build_ns = md_atomic_load(&md_stats_state.table_build_ns);
+    stats->frees = md_atomic_load(&md_stats_state.frees);
+    stats->live_bytes = md_atomic_load(&md_stats_state.live_bytes);
+    stats->peak_live_bytes = md_atomic_load(&md_stats_state.peak_live_bytes);
+    start_ns = md_atomic_load(&md_stats_state.start_ns);
+    stats->elapsed_ns = start_ns==0 ? 0 : md_time_ns() - start_ns;
+#else
+    memset(stats, 0, sizeof(md_stats));
+#endif
+}
+
+void md_stats_reset(void)
+{
+#ifdef MD_MALLOC_ENABLE_STATS
+    int k, r;
+    for(k=0; k<3; k++){
+        for(r=0; r<MD_STATS_MAX_RANK; r++){
+            md_atomic_store(&md_stats_state.calls[k][r], 0);
+            md_atomic_store(&md_stats_state.large_calls[k][r], 0);
+        }
+    }
+    md_atomic_store(&md_stats_state.bytes_requested, 0);
+    md_atomic_store(&md_stats_state.table_bytes, 0);
+    md_atomic_store(&md_stats_state.table_build_ns, 0);
+    md_atomic_store(&md_stats_state.frees, 0);
+    md_atomic_store(&md_stats_state.peak_live_bytes, md_atomic_load(&md_stats_state.live_bytes));
+    md_atomic_store(&md_stats_state.start_ns, md_time_ns());
+#endif
+}
+
+void* md_arena_create(md_arena* arena, size_t capacity, size_t alignment)
+{
+    md_arena_wrap(arena, NULL, 0, alignment);
+    if(arena->alignment==0)
+        return NULL;
+    /* over-allocate, so that the first array is aligned without losing any of
+     * the capacity */
+    arena->block = malloc1d(capacity + arena->alignment);
+    if(arena->block==NULL)
+        return NULL;
+    /* touch every page now, rather than in the first processing callback */
+    memset(arena->block, 0, capacity + arena->alignment);
+    arena->base = (unsigned char*)arena->block;
+    arena->base += MD_ALIGN_UP((size_t)arena->base, arena->alignment) - (size_t)arena->base;
+    arena->capacity = capacity;
+    return arena->base;
+}
+
+void md_arena_wrap(md_arena* arena, void* buffer, size_t capacity, size_t alignment)
+{
+    memset(arena, 0, sizeof(md_arena));
+    if(alignment<sizeof(void*))
+        alignment = sizeof(void*);
+    if((alignment & (alignment-1)) != 0){
+#if !defined(NDEBUG)
+        fprintf(stderr, "Error: alignment of %zu bytes is not a power of 2.\n", alignment);
+#endif
+        return;
+    }
+    arena->base = (unsigned char*)buffer;
+    arena->capacity = buffer==NULL ? 0 : capacity;
+    arena->alignment = alignment;
+}
+
+void md_arena_destroy(md_arena* arena)
+{
+    free1d(arena->block);
+    memset(arena, 0, sizeof(md_arena));
+}
+
+void md_arena_reset(md_arena* arena)
+{
+    arena->offset = 0;
+}
+
+size_t md_arena_mark(const md_arena* arena)
+{
+    return arena->offset;
+}
+
+void md_arena_rewind(md_arena* arena, size_t mark)
+{
+    if(mark<arena->offset)
+        arena->offset = mark;
+}
+
+size_t md_arena_remaining(const md_arena* arena)
+{
+    return arena->capacity - arena->offset;
+}
+
+/* Takes an "ndims" array from an arena: the pointer tables start at the next
+ * pointer-aligned address, and the data block at the next arena->alignment
+ * boundary after them. Nothing here may lock or block (i.e. no stdio, and no
+ * OpenMP parallel regions), so that it stays real-time safe */
+static void* md_arena_alloc(md_arena* arena, size_t ndims, const size_t* dims,
+                            size_t data_size, int zero)
+{
+    size_t l, nrows, stride, table_bytes, start, data_start, end;
+    unsigned char* ptr;
+    unsigned char* data;
+    if(ndims==0 || arena->base==NULL)
+        return NULL;
+    nrows = 1;
+    for(l=0; l<ndims-1; l++)
+        nrows *= dims[l];
+    stride = dims[ndims-1]*data_size;
+    table_bytes = md_table_count(ndims, dims)*sizeof(void*);
+    ptr = arena->base + arena->offset;
+    ptr += MD_ALIGN_UP((size_t)ptr, sizeof(void*)) - (size_t)ptr;
+    data = ptr + table_bytes;
+    data += MD_ALIGN_UP((size_t)data, arena->alignment) - (size_t)data;
+    start = (size_t)(ptr - arena->base);
+    data_start = (size_t)(data - arena->base);
+    end = data_start + nrows*stride;
+    if(start>arena->capacity || data_start>arena->capacity || end>arena->capacity || end<data_start)
+        return NULL; /* (no message here: stdio may block) */
+    arena->offset = end;
+    if(zero)
+        memset(data, 0, nrows*stride);
+    if(ndims==1)
+        return data;
+    md_build_tables_ex(ptr, ndims, dims, data, stride, 1); /* (no OpenMP team) */
+    return ptr;
+}
+
+void* mallocNd_arena(md_arena* arena, size_t ndims, const size_t* dims, size_t data_size)
+{
+    return md_arena_alloc(arena, ndims, dims, data_size, 0);
+}
+
+void* callocNd_arena(md_arena* arena, size_t ndims, const size_t* dims, size_t data_size)
+{
+    return md_arena_alloc(arena, ndims, dims, data_size, 1);
+}
+
+void** malloc2d_arena(md_arena* arena, size_t dim1, size_t dim2, size_t data_size)
+{
+    size_t dims[2];
+    dims[0] = dim1; dims[1] = dim2;
+    return (void**)md_arena_alloc(arena, 2, dims, data_size, 0);
+}
+
+void** calloc2d_arena(md_arena* arena, size_t dim1, size_t dim2, size_t data_size)
+{
+    size_t dims[2];
+    dims[0] = dim1; dims[1] = dim2;
+    return (void**)md_arena_alloc(arena, 2, dims, data_size, 1);
+}
+
+void*** malloc3d_arena(md_arena* arena, size_t dim1, size_t dim2, size_t dim3, size_t data_size)
+{
+    size_t dims[3];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3;
+    return (void***)md_arena_alloc(arena, 3, dims, data_size, 0);
+}
+
+void*** calloc3d_arena(md_arena* arena, size_t dim1, size_t dim2, size_t dim3, size_t data_size)
+{
+    size_t dims[3];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3;
+    return (void***)md_arena_alloc(arena, 3, dims, data_size, 1);
+}
+
+void**** malloc4d_arena(md_arena* arena, size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t data_size)
+{
+    size_t dims[4];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4;
+    return (void****)md_arena_alloc(arena, 4, dims, data_size, 0);
+}
+
+void**** calloc4d_arena(md_arena* arena, size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t data_size)
+{
+    size_t dims[4];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4;
+    return (void****)md_arena_alloc(arena, 4, dims, data_size, 1);
+}
+
+void***** malloc5d_arena(md_arena* arena, size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t data_size)
+{
+    size_t dims[5];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5;
+    return (void*****)md_arena_alloc(arena, 5, dims, data_size, 0);
+}
+
+void***** calloc5d_arena(md_arena* arena, size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t data_size)
+{
+    size_t dims[5];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5;
+    return (void*****)md_arena_alloc(arena, 5, dims, data_size, 1);
+}
+
+void****** malloc6d_arena(md_arena* arena, size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t dim6, size_t data_size)
+{
+    size_t dims[6];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5; dims[5] = dim6;
+    return (void******)md_arena_alloc(arena, 6, dims, data_size, 0);
+}
+
+void****** calloc6d_arena(md_arena* arena, size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t dim6, size_t data_size)
+{
+    size_t dims[6];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5; dims[5] = dim6;
+    return (void******)md_arena_alloc(arena, 6, dims, data_size, 1);
+}
+
+void* md_ring_create(md_ring* ring, size_t nframes, size_t ndims,
+                     const size_t* dims, size_t data_size)
+{
+    size_t k;
+    unsigned char* frame;
+    memset(ring, 0, sizeof(md_ring));
+    if(nframes==0 || ndims==0)
+        return NULL;
+    ring->nframes = nframes;
+    ring->stride = MD_ALIGN_UP(md_sizeof(ndims, dims, data_size, NULL), MD_RING_PAD);
+    /* over-allocate, so that every frame starts on its own cache line */
+    ring->block = malloc1d(nframes*ring->stride + MD_RING_PAD);
+    if(ring->block==NULL)
+        return NULL;
+    /* touch every page now, rather than on the hot path */
+    memset(ring->block, 0, nframes*ring->stride + MD_RING_PAD);
+    ring->base = (unsigned char*)ring->block;
+    ring->base += MD_ALIGN_UP((size_t)ring->base, MD_RING_PAD) - (size_t)ring->base;
+    if(ndims>1){
+        for(k=0; k<nframes; k++){
+            frame = ring->base + k*ring->stride;
+            md_build_tables(frame, ndims, dims, frame + md_table_count(ndims, dims)*sizeof(void*),
+                            dims[ndims-1]*data_size);
+        }
+    }
+    return ring->base;
+}
+
+void md_ring_destroy(md_ring* ring)
+{
+    free1d(ring->block);
+    memset(ring, 0, sizeof(md_ring));
+}
+
+void* md_ring_acquire_write(md_ring* ring)
+{
+    size_t head = md_atomic_load(&ring->head);
+    if(head - ring->tail_seen >= ring->nframes){
+        ring->tail_seen = md_atomic_load_acquire(&ring->tail);
+        if(head - ring->tail_seen >= ring->nframes)
+            return NULL; /* full */
+    }
+    return ring->base + (head%ring->nframes)*ring->stride;
+}
+
+void md_ring_commit_write(md_ring* ring)
+{
+    md_atomic_store_release(&ring->head, md_atomic_load(&ring->head) + 1);
+}
+
+void* md_ring_acquire_read(md_ring* ring)
+{
+    size_t tail = md_atomic_load(&ring->tail);
+    if(tail==ring->head_seen){
+        ring->head_seen = md_atomic_load_acquire(&ring->head);
+        if(tail==ring->head_seen)
+            return NULL; /* empty */
+    }
+    return ring->base + (tail%ring->nframes)*ring->stride;
+}
+
+void md_ring_release_read(md_ring* ring)
+{
+    md_atomic_store_release(&ring->tail, md_atomic_load(&ring->tail) + 1);
+}
+
+size_t md_ring_count(md_ring* ring)
+{
+    size_t tail = md_atomic_load_acquire(&ring->tail);
+    return md_atomic_load_acquire(&ring->head) - tail;
+}
+
+/* Moves the array of "grow" into a block laid out for "capacity" slabs (the
+ * data of the slabs common to both is kept) */
+static void* md_grow_realloc(md_grow* grow, size_t capacity)
+{
+    size_t old_dims[MD_MAX_NDIMS], new_dims[MD_MAX_NDIMS];
+    void* ptr;
+    memcpy(old_dims, grow->dims, grow->ndims*sizeof(size_t));
+    memcpy(new_dims, grow->dims, grow->ndims*sizeof(size_t));
+    old_dims[0] = grow->capacity;
+    new_dims[0] = capacity;
+    ptr = reallocNd_preserve(grow->array, grow->ndims, old_dims, new_dims, grow->data_size);
+    if(ptr==NULL)
+        return NULL;
+    grow->array = ptr;
+    grow->capacity = capacity;
+    return ptr;
+}
+
+void* md_grow_create(md_grow* grow, size_t ndims, const size_t* dims,
+                     size_t capacity, size_t data_size)
+{
+    memset(grow, 0, sizeof(md_grow));
+    if(ndims==0)
+        return NULL;
+    if(ndims>MD_MAX_NDIMS){
+#if !defined(NDEBUG)
+        fprintf(stderr, "Error: md_grow supports up to %d dimensions.\n", (int)MD_MAX_NDIMS);
+#endif
+        return NULL;
+    }
+    if(capacity<dims[0])
+        capacity = dims[0];
+    if(capacity==0)
+        capacity = 1;
+    memcpy(grow->dims, dims, ndims*sizeof(size_t));
+    grow->dims[0] = capacity;
+    grow->array = md_alloc(NULL, ndims, grow->dims, data_size, 0, 0, 0, MD_MODE_MALLOC);
+    if(grow->array==NULL){
+        memset(grow, 0, sizeof(md_grow));
+        return NULL;
+    }
+    grow->dims[0] = dims[0];
+    grow->ndims = ndims;
+    grow->data_size = data_size;
+    grow->capacity = capacity;
+    return grow->array;
+}
+
+void md_grow_destroy(md_grow* grow)
+{
+    md_free(grow->array);
+    memset(grow, 0, sizeof(md_grow));
+}
+
+void* md_grow_reserve(md_grow* grow, size_t capacity)
+{
+    if(grow->array==NULL)
+        return NULL;
+    if(capacity<=grow->capacity)
+        return grow->array;
+    return md_grow_realloc(grow, capacity);
+}
+
+void* md_grow_resize(md_grow* grow, size_t dim1)
+{
+    size_t capacity;
+    if(grow->array==NULL)
+        return NULL;
+    if(dim1>grow->capacity){
+        /* doubling means each slab is moved O(1) times on average */
+        capacity = grow->capacity*2;
+        if(capacity<dim1)
+            capacity = dim1;
+        if(md_grow_realloc(grow, capacity)==NULL)
+            return NULL;
+    }
+    grow->dims[0] = dim1;
+    return grow->array;
+}
+
+void* md_grow_append(md_grow* grow, const void* slabs, size_t count)
+{
+    size_t l, dim1, slab_bytes;
+    if(grow->array==NULL)
+        return NULL;
+    dim1 = grow->dims[0];
+    if(md_grow_resize(grow, dim1+count)==NULL)
+        return NULL;
+    if(slabs!=NULL && count>0){
+        slab_bytes = grow->data_size;
+        for(l=1; l<grow->ndims; l++)
+            slab_bytes *= grow->dims[l];
+        memcpy((unsigned char*)flattenNd(grow->array, grow->ndims) + dim1*slab_bytes, slabs, count*slab_bytes);
+    }
+    return grow->array;
+}
+
+void* md_grow_shrink_to_fit(md_grow* grow)
+{
+    size_t capacity;
+    if(grow->array==NULL)
+        return NULL;
+    capacity = grow->dims[0]>0 ? grow->dims[0] : 1;
+    if(capacity==grow->capacity)
+        return grow->array;
+    return md_grow_realloc(grow, capacity);
+}
+
+/* Lays out a batch of arrays in a block starting at "base" (which must be
+ * aligned to the largest of their alignments): first all of the pointer
+ * tables, then all of the data blocks, each on its own alignment boundary.
+ * Returns the size of the block (0 if a descriptor is invalid), and its
+ * largest alignment via "max_alignment". If "base" is not NULL, the pointer
+ * tables are also filled in, and the arrays returned via "arrays" */
+static size_t md_batch_layout(size_t count, const md_batch_desc* descs,
+                              unsigned char* base, void** arrays,
+                              size_t* max_alignment, int mode)
+{
+    size_t i, l, nrows, alignment, table_bytes, table_pos, data_pos;
+#ifndef MD_MALLOC_ENABLE_STATS
+    (void)mode;
+#endif
+    *max_alignment = sizeof(void*);
+    table_pos = 0;
+    for(i=0; i<count; i++){
+        alignment = descs[i].alignment<sizeof(void*) ? sizeof(void*) : descs[i].alignment;
+        if(descs[i].ndims==0 || descs[i].dims==NULL || (alignment & (alignment-1)) != 0){
+#if !defined(NDEBUG)
+            fprintf(stderr, "Error: array %zu of the batch has no dimensions, or an alignment which is not a power of 2.\n", i);
+#endif
+            return 0;
+        }
+        if(alignment>*max_alignment)
+            *max_alignment = alignment;
+        table_pos += md_table_count(descs[i].ndims, descs[i].dims)*sizeof(void*);
+    }
+    data_pos = table_pos;
+    table_pos = 0;
+    for(i=0; i<count; i++){
+        alignment = descs[i].alignment<sizeof(void*) ? sizeof(void*) : descs[i].alignment;
+        data_pos = MD_ALIGN_UP(data_pos, alignment);
+        table_bytes = md_table_count(descs[i].ndims, descs[i].dims)*sizeof(void*);
+        nrows = 1;
+        for(l=0; l<descs[i].ndims-1; l++)
+            nrows *= descs[i].dims[l];
+        if(base!=NULL){
+            md_stats_count(mode, descs[i].ndims, md_sizeof(descs[i].ndims, descs[i].dims, descs[i].data_size, NULL), table_bytes);
+            if(descs[i].ndims==1)
+                arrays[i] = base + data_pos;
+            else{
+                md_build_tables(base + table_pos, descs[i].ndims, descs[i].dims, base + data_pos,
+                                descs[i].dims[descs[i].ndims-1]*descs[i].data_size);
+                arrays[i] = base + table_pos;
+            }
+        }
+        table_pos += table_bytes;
+        data_pos += nrows*descs[i].dims[descs[i].ndims-1]*descs[i].data_size;
+    }
+    return data_pos;
+}
+
+/* md_malloc_batch()/md_calloc_batch() */
+static void* md_alloc_batch(size_t count, const md_batch_desc* descs,
+                            void** arrays, int mode)
+{
+    size_t total, alignment;
+    unsigned char* block;
+    unsigned char* base;
+    total = md_batch_layout(count, descs, NULL, NULL, &alignment, mode);
+    if(total==0)
+        return NULL;
+    /* (malloc'd blocks are at least pointer-aligned) */
+    total += alignment - sizeof(void*);
+    block = (unsigned char*)(mode==MD_MODE_CALLOC ? md_sys_calloc(total, 1) : md_sys_malloc(total));
+    if(block==NULL)
+        return NULL;
+    base = block + (MD_ALIGN_UP((size_t)block, alignment) - (size_t)block);
+    md_batch_layout(count, descs, base, arrays, &alignment, mode);
+    return block;
+}
+
+void* md_malloc_batch(size_t count, const md_batch_desc* descs, void** arrays)
+{
+    return md_alloc_batch(count, descs, arrays, MD_MODE_MALLOC);
+}
+
+void* md_calloc_batch(size_t count, const md_batch_desc* descs, void** arrays)
+{
+    return md_alloc_batch(count, descs, arrays, MD_MODE_CALLOC);
+}
+
+size_t md_sizeof_batch(size_t count, const md_batch_desc* descs)
+{
+    size_t total, alignment;
+    total = md_batch_layout(count, descs, NULL, NULL, &alignment, MD_MODE_MALLOC);
+    return total==0 ? 0 : total + alignment - sizeof(void*);
+}
+
+/* Side length (in elements) of the tiles of md_transpose_tiles() */
+#define MD_TRANSPOSE_TILE ( 32 )
+
+/* Copies one element of "es" bytes (fixed sizes are inlined by compilers) */
+static void md_copy_element(unsigned char* dst, const unsigned char* src,
+                            size_t es)
+{
+    switch(es){
+        case 1:  *dst = *src; break;
+        case 2:  memcpy(dst, src, 2); break;
+        case 4:  memcpy(dst, src, 4); break;
+        case 8:  memcpy(dst, src, 8); break;
+        case 16: memcpy(dst, src, 16); break;
+        default: memcpy(dst, src, es); break;
+    }
+}
+
+/* dst[y*dy + x] = src[x*sx + y] (in elements of "es" bytes), for x0<=x<x1 and
+ * y0<=y<y1 */
+static void md_transpose_scalar(unsigned char* dst, size_t dy,
+                                const unsigned char* src, size_t sx,
+                                size_t x0, size_t x1, size_t y0, size_t y1,
+                                size_t es)
+{
+    size_t x, y;
+    for(x=x0; x<x1; x++)
+        for(y=y0; y<y1; y++)
+            md_copy_element(dst + (y*dy + x)*es, src + (x*sx + y)*es, es);
+}
+
+/* Same as md_transpose_scalar(), for a tile; with the largest whole blocks
+ * that fit in SIMD registers being transposed in them */
+static void md_transpose_tile(unsigned char* dst, size_t dy,
+                              const unsigned char* src, size_t sx,
+                              size_t x0, size_t x1, size_t y0, size_t y1,
+                              size_t es)
+{
+    size_t x, y, b;
+    b = 1; /* SIMD block size (elements) */
+#if defined(MD_MALLOC_AVX512) || defined(MD_MALLOC_AVX2)
+    if(es==4){
+        b = 8;
+        for(x=x0; x+8<=x1; x+=8){
+            for(y=y0; y+8<=y1; y+=8){
+                __m256 r0, r1, r2, r3, r4, r5, r6, r7, t0, t1, t2, t3, t4, t5, t6, t7;
+                const float* s = (const float*)src + x*sx + y;
+                float* d = (float*)dst + y*dy + x;
+                r0 = _mm256_loadu_ps(s);      r1 = _mm256_loadu_ps(s+sx);
+                r2 = _mm256_loadu_ps(s+2*sx); r3 = _mm256_loadu_ps(s+3*sx);
+                r4 = _mm256_loadu_ps(s+4*sx); r5 = _mm256_loadu_ps(s+5*sx);
+                r6 = _mm256_loadu_ps(s+6*sx); r7 = _mm256_loadu_ps(s+7*sx);
+                t0 = _mm256_unpacklo_ps(r0, r1); t1 = _mm256_unpackhi_ps(r0, r1);
+                t2 = _mm256_unpacklo_ps(r2, r3); t3 = _mm256_unpackhi_ps(r2, r3);
+                t4 = _mm256_unpacklo_ps(r4, r5); t5 = _mm256_unpackhi_ps(r4, r5);
+                t6 = _mm256_unpacklo_ps(r6, r7); t7 = _mm256_unpackhi_ps(r6, r7);
+                r0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1,0,1,0)); r1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3,2,3,2));
+                r2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1,0,1,0)); r3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3,2,3,2));
+                r4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1,0,1,0)); r5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3,2,3,2));
+                r6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1,0,1,0)); r7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3,2,3,2));
+                _mm256_storeu_ps(d,      _mm256_permute2f128_ps(r0, r4, 0x20));
+                _mm256_storeu_ps(d+dy,   _mm256_permute2f128_ps(r1, r5, 0x20));
+                _mm256_storeu_ps(d+2*dy, _mm256_permute2f128_ps(r2, r6, 0x20));
+                _mm256_storeu_ps(d+3*dy, _mm256_permute2f128_ps(r3, r7, 0x20));
+                _mm256_storeu_ps(d+4*dy, _mm256_permute2f128_ps(r0, r4, 0x31));
+                _mm256_storeu_ps(d+5*dy, _mm256_permute2f128_ps(r1, r5, 0x31));
+                _mm256_storeu_ps(d+6*dy, _mm256_permute2f128_ps(r2, r6, 0x31));
+                _mm256_storeu_ps(d+7*dy, _mm256_permute2f128_ps(r3, r7, 0x31));
+            }
+        }
+    }
+#elif defined(MD_MALLOC_SSE2)
+    if(es==4){
+        b = 4;
+        for(x=x0; x+4<=x1; x+=4){
+            for(y=y0; y+4<=y1; y+=4){
+                __m128 r0, r1, r2, r3;
+                const float* s = (const float*)src + x*sx + y;
+                float* d = (float*)dst + y*dy + x;
+                r0 = _mm_loadu_ps(s);      r1 = _mm_loadu_ps(s+sx);
+                r2 = _mm_loadu_ps(s+2*sx); r3 = _mm_loadu_ps(s+3*sx);
+                _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                _mm_storeu_ps(d, r0);      _mm_storeu_ps(d+dy, r1);
+                _mm_storeu_ps(d+2*dy, r2); _mm_storeu_ps(d+3*dy, r3);
+            }
+        }
+    }
+#elif defined(MD_MALLOC_NEON)
+    if(es==4){
+        b = 4;
+        for(x=x0; x+4<=x1; x+=4){
+            for(y=y0; y+4<=y1; y+=4){
+                float32x4x2_t t0, t1;
+                const float* s = (const float*)src + x*sx + y;
+                float* d = (float*)dst + y*dy + x;
+                t0 = vtrnq_f32(vld1q_f32(s), vld1q_f32(s+sx));
+                t1 = vtrnq_f32(vld1q_f32(s+2*sx), vld1q_f32(s+3*sx));
+                vst1q_f32(d,      vcombine_f32(vget_low_f32(t0.val[0]), vget_low_f32(t1.val[0])));
+                vst1q_f32(d+dy,   vcombine_f32(vget_low_f32(t0.val[1]), vget_low_f32(t1.val[1])));
+                vst1q_f32(d+2*dy, vcombine_f32(vget_high_f32(t0.val[0]), vget_high_f32(t1.val[0])));
+                vst1q_f32(d+3*dy, vcombine_f32(vget_high_f32(t0.val[1]), vget_high_f32(t1.val[1])));
+            }
+        }
+    }
+#endif
+#if defined(MD_MALLOC_AVX512) || defined(MD_MALLOC_AVX2) || defined(MD_MALLOC_SSE2)
+    if(es==8){
+        b = 2;
+        for(x=x0; x+2<=x1; x+=2){
+            for(y=y0; y+2<=y1; y+=2){
+                __m128d r0, r1;
+                const double* s = (const double*)src + x*sx + y;
+                double* d = (double*)dst + y*dy + x;
+                r0 = _mm_loadu_pd(s);
+                r1 = _mm_loadu_pd(s+sx);
+                _mm_storeu_pd(d,    _mm_unpacklo_pd(r0, r1));
+                _mm_storeu_pd(d+dy, _mm_unpackhi_pd(r0, r1));
+            }
+        }
+    }
+    else if(es==16){
+        for(x=x0; x<x1; x++)
+            for(y=y0; y<y1; y++)
+                _mm_storeu_si128((__m128i*)(dst + (y*dy + x)*16), _mm_loadu_si128((const __m128i*)(src + (x*sx + y)*16)));
+        return;
+    }
+#elif defined(MD_MALLOC_NEON)
+    if(es==8){
+        b = 2;
+        for(x=x0; x+2<=x1; x+=2){
+            for(y=y0; y+2<=y1; y+=2){
+                uint64x2_t r0, r1;
+                const uint64_t* s = (const uint64_t*)src + x*sx + y;
+                uint64_t* d = (uint64_t*)dst + y*dy + x;
+                r0 = vld1q_u64(s);
+                r1 = vld1q_u64(s+sx);
+                vst1q_u64(d,    vcombine_u64(vget_low_u64(r0), vget_low_u64(r1)));
+                vst1q_u64(d+dy, vcombine_u64(vget_high_u64(r0), vget_high_u64(r1)));
+            }
+        }
+    }
+    else if(es==16){
+        for(x=x0; x<x1; x++)
+            for(y=y0; y<y1; y++)
+                vst1q_u8(dst + (y*dy + x)*16, vld1q_u8(src + (x*sx + y)*16));
+        return;
+    }
+#endif
+    if(b==1){
+        md_transpose_scalar(dst, dy, src, sx, x0, x1, y0, y1, es);
+        return;
+    }
+    /* (the edges which do not fill a whole block) */
+    x = x0 + (x1-x0)/b*b;
+    y = y0 + (y1-y0)/b*b;
+    md_transpose_scalar(dst, dy, src, sx, x0, x, y, y1, es);
+    md_transpose_scalar(dst, dy, src, sx, x, x1, y0, y1, es);
+}
+
+/* Copies "src" into "dst", where both are described by the same "m" axes
+ * (in the order of "dst"): axis k has "n[k]" elements, which are "ss[k]"
+ * elements apart in "src", and "ds[k]" elements apart in "dst". The last axis
+ * must be contiguous in "dst" (ds[m-1]==1), and one of them in "src" */
+static void md_permute_axes(unsigned char* dst, const unsigned char* src,
+                            size_t m, const size_t* n, const size_t* ss,
+                            const size_t* ds, size_t es)
+{
+    long t, ntasks;
+    size_t k, inner, ny, nt, total;
+    inner = 0;
+    if(m==0){
+        md_copy_element(dst, src, es);
+        return;
+    }
+    /* the axis which is contiguous in "src" ("inner" if both are the same) */
+    for(k=0; k<m; k++)
+        if(ss[k]==1)
+            inner = k;
+    total = es;
+    for(k=0; k<m; k++)
+        total *= n[k];
+    /* tasks: all combinations of the other axes, and (when transposing) rows
+     * of tiles along the last axis */
+    nt = inner==m-1 ? 1 : (n[m-1] + MD_TRANSPOSE_TILE-1)/MD_TRANSPOSE_TILE;
+    ntasks = (long)nt;
+    for(k=0; k<m-1; k++)
+        if(k!=inner && !(inner==m-1 && k==m-2))
+            ntasks *= (long)n[k];
+    ny = n[inner];
+#if defined(MD_MALLOC_ENABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp parallel for schedule(static) if(total>=MD_MALLOC_OPENMP_COPY_THRESHOLD)
+#endif
+    for(t=0; t<ntasks; t++){
+        size_t l, j, idx, rem, so, dof, x0, x1, y0;
+        /* offsets of this task */
+        rem = (size_t)t;
+        so = dof = 0;
+        x0 = (rem%nt)*MD_TRANSPOSE_TILE;
+        rem /= nt;
+        for(l=m-1; l-->0;){
+            if(l==inner || (inner==m-1 && l==m-2))
+                continue;
+            idx = rem%n[l];
+            rem /= n[l];
+            so += idx*ss[l];
+            dof += idx*ds[l];
+        }
+        if(inner==m-1){
+            /* rows are contiguous in both: copy them along the second last axis */
+            if(m==1)
+                memcpy(dst, src, total);
+            else
+                for(j=0; j<n[m-2]; j++)
+                    memcpy(dst + (dof + j*ds[m-2])*es, src + (so + j*ss[m-2])*es, n[m-1]*es);
+        }
+        else{
+            /* transpose the tiles of rows x0..x1 of the last axis */
+            x1 = x0+MD_TRANSPOSE_TILE < n[m-1] ? x0+MD_TRANSPOSE_TILE : n[m-1];
+            for(y0=0; y0<ny; y0+=MD_TRANSPOSE_TILE)
+                md_transpose_tile(dst + dof*es, ds[inner], src + so*es, ss[m-1],
+                                  x0, x1, y0, y0+MD_TRANSPOSE_TILE<ny ? y0+MD_TRANSPOSE_TILE : ny, es);
+        }
+    }
+}
+
+void** md_transpose2d(void** dst, void** src, size_t dim1, size_t dim2, size_t data_size)
+{
+    size_t dims[2], perm[2];
+    dims[0] = dim1; dims[1] = dim2;
+    perm[0] = 1; perm[1] = 0;
+    return (void**)md_permuteNd((void*)dst, (void*)src, 2, dims, perm, data_size);
+}
+
+void* md_permuteNd(void* dst, void* src, size_t ndims, const size_t* dims,
+                   const size_t* perm, size_t data_size)
+{
+    size_t l, m, seen, odims[MD_MAX_NDIMS], istride[MD_MAX_NDIMS], ostride[MD_MAX_NDIMS];
+    size_t n[MD_MAX_NDIMS], ss[MD_MAX_NDIMS], ds[MD_MAX_NDIMS];
+    if(src==NULL || ndims==0 || ndims>MD_MAX_NDIMS)
+        return NULL;
+    seen = 0;
+    for(l=0; l<ndims; l++){
+        if(perm[l]>=ndims || (seen & ((size_t)1<<perm[l]))){
+#if !defined(NDEBUG)
+            fprintf(stderr, "Error: the axes of md_permuteNd() are not a permutation of 0..%zu.\n", ndims-1);
+#endif
+            return NULL;
+        }
+        seen |= (size_t)1<<perm[l];
+        odims[l] = dims[perm[l]];
+    }
+    if(dst==NULL)
+        dst = md_alloc(NULL, ndims, odims, data_size, 0, 0, 0, MD_MODE_MALLOC); /* (never cached or mapped) */
+    if(dst==NULL)
+        return NULL;
+    istride[ndims-1] = ostride[ndims-1] = 1;
+    for(l=ndims-1; l-->0;){
+        istride[l] = istride[l+1]*dims[l+1];
+        ostride[l] = ostride[l+1]*odims[l+1];
+    }
+    /* the axes (in the order of "dst"), without those of length 1, and with
+     * those which are also adjacent in "src" merged */
+    m = 0;
+    for(l=0; l<ndims; l++){
+        if(odims[l]==0 || data_size==0)
+            return dst; /* (nothing to copy) */
+        if(odims[l]==1)
+            continue;
+        if(m>0 && ss[m-1]==istride[perm[l]]*odims[l] && ds[m-1]==ostride[l]*odims[l]){
+            n[m-1] *= odims[l];
+            ss[m-1] = istride[perm[l]];
+            ds[m-1] = ostride[l];
+        }
+        else{
+            n[m] = odims[l];
+            ss[m] = istride[perm[l]];
+            ds[m] = ostride[l];
+            m++;
+        }
+    }
+    md_permute_axes((unsigned char*)flattenNd(dst, ndims), (const unsigned char*)flattenNd(src, ndims),
+                    m, n, ss, ds, data_size);
+    return dst;
+}
+
+void*** md_permute3d(void*** dst, void*** src, size_t dim1, size_t dim2, size_t dim3, const size_t* perm, size_t data_size)
+{
+    size_t dims[3];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3;
+    return (void***)md_permuteNd((void*)dst, (void*)src, 3, dims, perm, data_size);
+}
+
+void**** md_permute4d(void**** dst, void**** src, size_t dim1, size_t dim2, size_t dim3, size_t dim4, const size_t* perm, size_t data_size)
+{
+    size_t dims[4];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4;
+    return (void****)md_permuteNd((void*)dst, (void*)src, 4, dims, perm, data_size);
+}
+
+void***** md_permute5d(void***** dst, void***** src, size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, const size_t* perm, size_t data_size)
+{
+    size_t dims[5];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5;
+    return (void*****)md_permuteNd((void*)dst, (void*)src, 5, dims, perm, data_size);
+}
+
+void****** md_permute6d(void****** dst, void****** src, size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t dim6, const size_t* perm, size_t data_size)
+{
+    size_t dims[6];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5; dims[5] = dim6;
+    return (void******)md_permuteNd((void*)dst, (void*)src, 6, dims, perm, data_size);
+}
+
+/* mallocNd_split_complex()/callocNd_split_complex(): the pointer tables of the
+ * real then imaginary arrays, followed by their data planes */
+static void* md_alloc_split_complex(size_t ndims, const size_t* dims,
+                                    size_t real_size, void** im, int mode)
+{
+    size_t l, numel, table_bytes, plane, total;
+    unsigned char* ptr;
+    unsigned char* data;
+    *im = NULL;
+    if(ndims==0)
+        return NULL;
+    numel = 1;
+    for(l=0; l<ndims; l++)
+        numel *= dims[l];
+    table_bytes = md_table_count(ndims, dims)*sizeof(void*);
+    plane = MD_ALIGN_UP(numel*real_size, MD_SPLIT_COMPLEX_ALIGNMENT);
+    total = 2*table_bytes + plane + numel*real_size;
+    if(ndims>1)
+        total += MD_SPLIT_COMPLEX_ALIGNMENT - sizeof(void*);
+    md_stats_count(mode, ndims, total, 2*table_bytes);
+    ptr = (unsigned char*)(mode==MD_MODE_CALLOC ? md_sys_calloc(total, 1) : md_sys_malloc(total));
+    if(ptr==NULL)
+        return NULL;
+    if(ndims==1){
+        *im = ptr + plane;
+        return ptr;
+    }
+    data = ptr + 2*table_bytes;
+    data += MD_ALIGN_UP((size_t)data, MD_SPLIT_COMPLEX_ALIGNMENT) - (size_t)data;
+    md_build_tables(ptr, ndims, dims, data, dims[ndims-1]*real_size);
+    md_build_tables(ptr + table_bytes, ndims, dims, data + plane, dims[ndims-1]*real_size);
+    *im = ptr + table_bytes;
+    return ptr;
+}
+
+void* mallocNd_split_complex(size_t ndims, const size_t* dims, size_t real_size, void** im)
+{
+    return md_alloc_split_complex(ndims, dims, real_size, im, MD_MODE_MALLOC);
+}
+
+void* callocNd_split_complex(size_t ndims, const size_t* dims, size_t real_size, void** im)
+{
+    return md_alloc_split_complex(ndims, dims, real_size, im, MD_MODE_CALLOC);
+}
+
+void** malloc2d_split_complex(size_t dim1, size_t dim2, size_t real_size, void*** im)
+{
+    size_t dims[2];
+    dims[0] = dim1; dims[1] = dim2;
+    return (void**)md_alloc_split_complex(2, dims, real_size, (void**)im, MD_MODE_MALLOC);
+}
+
+void** calloc2d_split_complex(size_t dim1, size_t dim2, size_t real_size, void*** im)
+{
+    size_t dims[2];
+    dims[0] = dim1; dims[1] = dim2;
+    return (void**)md_alloc_split_complex(2, dims, real_size, (void**)im, MD_MODE_CALLOC);
+}
+
+void*** malloc3d_split_complex(size_t dim1, size_t dim2, size_t dim3, size_t real_size, void**** im)
+{
+    size_t dims[3];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3;
+    return (void***)md_alloc_split_complex(3, dims, real_size, (void**)im, MD_MODE_MALLOC);
+}
+
+void*** calloc3d_split_complex(size_t dim1, size_t dim2, size_t dim3, size_t real_size, void**** im)
+{
+    size_t dims[3];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3;
+    return (void***)md_alloc_split_complex(3, dims, real_size, (void**)im, MD_MODE_CALLOC);
+}
+
+void**** malloc4d_split_complex(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t real_size, void***** im)
+{
+    size_t dims[4];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4;
+    return (void****)md_alloc_split_complex(4, dims, real_size, (void**)im, MD_MODE_MALLOC);
+}
+
+void**** calloc4d_split_complex(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t real_size, void***** im)
+{
+    size_t dims[4];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4;
+    return (void****)md_alloc_split_complex(4, dims, real_size, (void**)im, MD_MODE_CALLOC);
+}
+
+void***** malloc5d_split_complex(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t real_size, void****** im)
+{
+    size_t dims[5];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5;
+    return (void*****)md_alloc_split_complex(5, dims, real_size, (void**)im, MD_MODE_MALLOC);
+}
+
+void***** calloc5d_split_complex(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t real_size, void****** im)
+{
+    size_t dims[5];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5;
+    return (void*****)md_alloc_split_complex(5, dims, real_size, (void**)im, MD_MODE_CALLOC);
+}
+
+void****** malloc6d_split_complex(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t dim6, size_t real_size, void******* im)
+{
+    size_t dims[6];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5; dims[5] = dim6;
+    return (void******)md_alloc_split_complex(6, dims, real_size, (void**)im, MD_MODE_MALLOC);
+}
+
+void****** calloc6d_split_complex(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t dim6, size_t real_size, void******* im)
+{
+    size_t dims[6];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5; dims[5] = dim6;
+    return (void******)md_alloc_split_complex(6, dims, real_size, (void**)im, MD_MODE_CALLOC);
+}
+
+void md_deinterleave_complex(void* re, void* im, const void* interleaved, size_t n, size_t real_size)
+{
+    size_t k, es;
+    unsigned char* r;
+    unsigned char* i;
+    const unsigned char* s;
+    r = (unsigned char*)re;
+    i = (unsigned char*)im;
+    s = (const unsigned char*)interleaved;
+    es = real_size;
+    k = 0;
+#if defined(MD_MALLOC_AVX512) || defined(MD_MALLOC_AVX2)
+    if(es==4){
+        for(; k+8<=n; k+=8){
+            __m256 a, b;
+            a = _mm256_loadu_ps((const float*)s + 2*k);
+            b = _mm256_loadu_ps((const float*)s + 2*k + 8);
+            /* [r0 r1 r4 r5 r2 r3 r6 r7], then the middle pairs swapped */
+            _mm256_storeu_ps((float*)r + k, _mm256_castpd_ps(_mm256_permute4x64_pd(
+                _mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0))), _MM_SHUFFLE(3,1,2,0))));
+            _mm256_storeu_ps((float*)i + k, _mm256_castpd_ps(_mm256_permute4x64_pd(
+                _mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1))), _MM_SHUFFLE(3,1,2,0))));
+        }
+    }
+    else if(es==8){
+        for(; k+4<=n; k+=4){
+            __m256d a, b;
+            a = _mm256_loadu_pd((const double*)s + 2*k);
+            b = _mm256_loadu_pd((const double*)s + 2*k + 4);
+            _mm256_storeu_pd((double*)r + k, _mm256_permute4x64_pd(_mm256_unpacklo_pd(a, b), _MM_SHUFFLE(3,1,2,0)));
+            _mm256_storeu_pd((double*)i + k, _mm256_permute4x64_pd(_mm256_unpackhi_pd(a, b), _MM_SHUFFLE(3,1,2,0)));
+        }
+    }
+#elif defined(MD_MALLOC_SSE2)
+    if(es==4){
+        for(; k+4<=n; k+=4){
+            __m128 a, b;
+            a = _mm_loadu_ps((const float*)s + 2*k);
+            b = _mm_loadu_ps((const float*)s + 2*k + 4);
+            _mm_storeu_ps((float*)r + k, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0)));
+            _mm_storeu_ps((float*)i + k, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1)));
+        }
+    }
+    else if(es==8){
+        for(; k+2<=n; k+=2){
+            __m128d a, b;
+            a = _mm_loadu_pd((const double*)s + 2*k);
+            b = _mm_loadu_pd((const double*)s + 2*k + 2);
+            _mm_storeu_pd((double*)r + k, _mm_unpacklo_pd(a, b));
+            _mm_storeu_pd((double*)i + k, _mm_unpackhi_pd(a, b));
+        }
+    }
+#elif defined(MD_MALLOC_NEON)
+    if(es==4){
+        for(; k+4<=n; k+=4){
+            float32x4x2_t v;
+            v = vld2q_f32((const float*)s + 2*k);
+            vst1q_f32((float*)r + k, v.val[0]);
+            vst1q_f32((float*)i + k, v.val[1]);
+        }
+    }
+    else if(es==8){
+        for(; k+2<=n; k+=2){
+            float64x2x2_t v;
+            v = vld2q_f64((const double*)s + 2*k);
+            vst1q_f64((double*)r + k, v.val[0]);
+            vst1q_f64((double*)i + k, v.val[1]);
+        }
+    }
+#endif
+    for(r += k*es, i += k*es, s += 2*k*es; k<n; k++, r += es, i += es, s += 2*es){
+        md_copy_element(r, s, es);
+        md_copy_element(i, s + es, es);
+    }
+}
+
+void md_interleave_complex(void* interleaved, const void* re, const void* im, size_t n, size_t real_size)
+{
+    size_t k, es;
+    const unsigned char* r;
+    const unsigned char* i;
+    unsigned char* d;
+    r = (const unsigned char*)re;
+    i = (const unsigned char*)im;
+    d = (unsigned char*)interleaved;
+    es = real_size;
+    k = 0;
+#if defined(MD_MALLOC_AVX512) || defined(MD_MALLOC_AVX2)
+    if(es==4){
+        for(; k+8<=n; k+=8){
+            __m256 a, b, lo, hi;
+            a = _mm256_loadu_ps((const float*)r + k);
+            b = _mm256_loadu_ps((const float*)i + k);
+            lo = _mm256_unpacklo_ps(a, b); /* [r0 i0 r1 i1 r4 i4 r5 i5] */
+            hi = _mm256_unpackhi_ps(a, b); /* [r2 i2 r3 i3 r6 i6 r7 i7] */
+            _mm256_storeu_ps((float*)d + 2*k,     _mm256_permute2f128_ps(lo, hi, 0x20));
+            _mm256_storeu_ps((float*)d + 2*k + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+        }
+    }
+    else if(es==8){
+        for(; k+4<=n; k+=4){
+            __m256d a, b, lo, hi;
+            a = _mm256_loadu_pd((const double*)r + k);
+            b = _mm256_loadu_pd((const double*)i + k);
+            lo = _mm256_unpacklo_pd(a, b); /* [r0 i0 r2 i2] */
+            hi = _mm256_unpackhi_pd(a, b); /* [r1 i1 r3 i3] */
+            _mm256_storeu_pd((double*)d + 2*k,     _mm256_permute2f128_pd(lo, hi, 0x20));
+            _mm256_storeu_pd((double*)d + 2*k + 4, _mm256_permute2f128_pd(lo, hi, 0x31));
+        }
+    }
+#elif defined(MD_MALLOC_SSE2)
+    if(es==4){
+        for(; k+4<=n; k+=4){
+            __m128 a, b;
+            a = _mm_loadu_ps((const float*)r + k);
+            b = _mm_loadu_ps((const float*)i + k);
+            _mm_storeu_ps((float*)d + 2*k,     _mm_unpacklo_ps(a, b));
+            _mm_storeu_ps((float*)d + 2*k + 4, _mm_unpackhi_ps(a, b));
+        }
+    }
+    else if(es==8){
+        for(; k+2<=n; k+=2){
+            __m128d a, b;
+            a = _mm_loadu_pd((const double*)r + k);
+            b = _mm_loadu_pd((const double*)i + k);
+            _mm_storeu_pd((double*)d + 2*k,     _mm_unpacklo_pd(a, b));
+            _mm_storeu_pd((double*)d + 2*k + 2, _mm_unpackhi_pd(a, b));
+        }
+    }
+#elif defined(MD_MALLOC_NEON)
+    if(es==4){
+        for(; k+4<=n; k+=4){
+            float32x4x2_t v;
+            v.val[0] = vld1q_f32((const float*)r + k);
+            v.val[1] = vld1q_f32((const float*)i + k);
+            vst2q_f32((float*)d + 2*k, v);
+        }
+    }
+    else if(es==8){
+        for(; k+2<=n; k+=2){
+            float64x2x2_t v;
+            v.val[0] = vld1q_f64((const double*)r + k);
+            v.val[1] = vld1q_f64((const double*)i + k);
+            vst2q_f64((double*)d + 2*k, v);
+        }
+    }
+#endif
+    for(d += 2*k*es, r += k*es, i += k*es; k<n; k++, d += 2*es, r += es, i += es){
+        md_copy_element(d, r, es);
+        md_copy_element(d + es, i, es);
+    }
+}
+
+/* The bulk operations (see md_bulk_f()) */
+#define MD_OP_SET   ( 0 )
+#define MD_OP_COPY  ( 1 )
+#define MD_OP_SCALE ( 2 )
+#define MD_OP_AXPY  ( 3 )
+#define MD_OP_MUL   ( 4 )
+
+/* Number of reals per OpenMP task of the bulk operations */
+#define MD_BULK_CHUNK ( 16384 )
+
+/* Vector operations of the bulk operations, on float (MD_VF) and double
+ * (MD_VD) registers of MD_VBYTES bytes; SWAP exchanges the real and imaginary
+ * part of each complex number, and DUPRE/DUPIM copy one part over the other */
+#if defined(MD_MALLOC_AVX512)
+# define MD_VBYTES          ( 64 )
+# define MD_VF              __m512
+# define MD_VF_LOAD(p)      _mm512_loadu_ps(p)
+# define MD_VF_STORE(p, v)  _mm512_storeu_ps(p, v)
+# define MD_VF_STREAM(p, v) _mm512_stream_ps(p, v)
+# define MD_VF_ADD(a, b)    _mm512_add_ps(a, b)
+# define MD_VF_MUL(a, b)    _mm512_mul_ps(a, b)
+# define MD_VF_SWAP(v)      _mm512_permute_ps(v, 0xB1)
+# define MD_VF_DUPRE(v)     _mm512_permute_ps(v, 0xA0)
+# define MD_VF_DUPIM(v)     _mm512_permute_ps(v, 0xF5)
+# define MD_VD              __m512d
+# define MD_VD_LOAD(p)      _mm512_loadu_pd(p)
+# define MD_VD_STORE(p, v)  _mm512_storeu_pd(p, v)
+# define MD_VD_STREAM(p, v) _mm512_stream_pd(p, v)
+# define MD_VD_ADD(a, b)    _mm512_add_pd(a, b)
+# define MD_VD_MUL(a, b)    _mm512_mul_pd(a, b)
+# define MD_VD_SWAP(v)      _mm512_permute_pd(v, 0x55)
+# define MD_VD_DUPRE(v)     _mm512_permute_pd(v, 0x00)
+# define MD_VD_DUPIM(v)     _mm512_permute_pd(v, 0xFF)
+# define MD_STREAM_FENCE()  _mm_sfence()
+#elif defined(MD_MALLOC_AVX2)
+# define MD_VBYTES          ( 32 )
+# define MD_VF              __m256
+# define MD_VF_LOAD(p)      _mm256_loadu_ps(p)
+# define MD_VF_STORE(p, v)  _mm256_storeu_ps(p, v)
+# define MD_VF_STREAM(p, v) _mm256_stream_ps(p, v)
+# define MD_VF_ADD(a, b)    _mm256_add_ps(a, b)
+# define MD_VF_MUL(a, b)    _mm256_mul_ps(a, b)
+# define MD_VF_SWAP(v)      _mm256_permute_ps(v, 0xB1)
+# define MD_VF_DUPRE(v)     _mm256_permute_ps(v, 0xA0)
+# define MD_VF_DUPIM(v)     _mm256_permute_ps(v, 0xF5)
+# define MD_VD              __m256d
+# define MD_VD_LOAD(p)      _mm256_loadu_pd(p)
+# define MD_VD_STORE(p, v)  _mm256_storeu_pd(p, v)
+# define MD_VD_STREAM(p, v) _mm256_stream_pd(p, v)
+# define MD_VD_ADD(a, b)    _mm256_add_pd(a, b)
+# define MD_VD_MUL(a, b)    _mm256_mul_pd(a, b)
+# define MD_VD_SWAP(v)      _mm256_permute_pd(v, 0x5)
+# define MD_VD_DUPRE(v)     _mm256_permute_pd(v, 0x0)
+# define MD_VD_DUPIM(v)     _mm256_permute_pd(v, 0xF)
+# define MD_STREAM_FENCE()  _mm_sfence()
+#elif defined(MD_MALLOC_SSE2)
+# define MD_VBYTES          ( 16 )
+# define MD_VF              __m128
+# define MD_VF_LOAD(p)      _mm_loadu_ps(p)
+# define MD_VF_STORE(p, v)  _mm_storeu_ps(p, v)
+# define MD_VF_STREAM(p, v) _mm_stream_ps(p, v)
+# define MD_VF_ADD(a, b)    _mm_add_ps(a, b)
+# define MD_VF_MUL(a, b)    _mm_mul_ps(a, b)
+# define MD_VF_SWAP(v)      _mm_shuffle_ps(v, v, 0xB1)
+# define MD_VF_DUPRE(v)     _mm_shuffle_ps(v, v, 0xA0)
+# define MD_VF_DUPIM(v)     _mm_shuffle_ps(v, v, 0xF5)
+# define MD_VD              __m128d
+# define MD_VD_LOAD(p)      _mm_loadu_pd(p)
+# define MD_VD_STORE(p, v)  _mm_storeu_pd(p, v)
+# define MD_VD_STREAM(p, v) _mm_stream_pd(p, v)
+# define MD_VD_ADD(a, b)    _mm_add_pd(a, b)
+# define MD_VD_MUL(a, b)    _mm_mul_pd(a, b)
+# define MD_VD_SWAP(v)      _mm_shuffle_pd(v, v, 1)
+# define MD_VD_DUPRE(v)     _mm_unpacklo_pd(v, v)
+# define MD_VD_DUPIM(v)     _mm_unpackhi_pd(v, v)
+# define MD_STREAM_FENCE()  _mm_sfence()
+#elif defined(MD_MALLOC_NEON)
+# define MD_VBYTES          ( 16 )
+# define MD_VF              float32x4_t
+# define MD_VF_LOAD(p)      vld1q_f32(p)
+# define MD_VF_STORE(p, v)  vst1q_f32(p, v)
+# define MD_VF_STREAM(p, v) vst1q_f32(p, v) /* (no non-temporal store intrinsic) */
+# define MD_VF_ADD(a, b)    vaddq_f32(a, b)
+# define MD_VF_MUL(a, b)    vmulq_f32(a, b)
+# define MD_VF_SWAP(v)      vrev64q_f32(v)
+# define MD_VF_DUPRE(v)     vtrn1q_f32(v, v)
+# define MD_VF_DUPIM(v)     vtrn2q_f32(v, v)
+# define MD_VD              float64x2_t
+# define MD_VD_LOAD(p)      vld1q_f64(p)
+# define MD_VD_STORE(p, v)  vst1q_f64(p, v)
+# define MD_VD_STREAM(p, v) vst1q_f64(p, v)
+# define MD_VD_ADD(a, b)    vaddq_f64(a, b)
+# define MD_VD_MUL(a, b)    vmulq_f64(a, b)
+# define MD_VD_SWAP(v)      vextq_f64(v, v, 1)
+# define MD_VD_DUPRE(v)     vdupq_laneq_f64(v, 0)
+# define MD_VD_DUPIM(v)     vdupq_laneq_f64(v, 1)
+# define MD_STREAM_FENCE()  ((void)0)
+#endif
+#if defined(MD_VBYTES)
+# define MD_VF_PUT(p, v, stream) do{ if(stream) MD_VF_STREAM(p, v); else MD_VF_STORE(p, v); }while(0)
+# define MD_VD_PUT(p, v, stream) do{ if(stream) MD_VD_STREAM(p, v); else MD_VD_STORE(p, v); }while(0)
+#endif
+
+/* md_bulk_f() for the elements [k, n) without SIMD */
+static void md_bulk_f_scalar(int op, float* y, const float* x, const float* z,
+                             size_t k, size_t n, int cplx, const float* a)
+{
+    float re, im;
+    if(!cplx){
+        switch(op){
+            case MD_OP_SET:   for(; k<n; k++) y[k] = a[0]; break;
+            case MD_OP_COPY:  for(; k<n; k++) y[k] = x[k]; break;
+            case MD_OP_SCALE: for(; k<n; k++) y[k] *= a[0]; break;
+            case MD_OP_AXPY:  for(; k<n; k++) y[k] += a[0]*x[k]; break;
+            default:          for(; k<n; k++) y[k] = x[k]*z[k]; break;
+        }
+        return;
+    }
+    switch(op){
+        case MD_OP_SET:
+            for(; k<n; k+=2){
+                y[k] = a[0];
+                y[k+1] = a[1];
+            }
+            break;
+        case MD_OP_COPY:
+            for(; k<n; k+=2){
+                y[k] = x[k];
+                y[k+1] = x[k+1];
+            }
+            break;
+        case MD_OP_SCALE:
+            for(; k<n; k+=2){
+                re = y[k]*a[0] - y[k+1]*a[1];
+                im = y[k]*a[1] + y[k+1]*a[0];
+                y[k] = re;
+                y[k+1] = im;
+            }
+            break;
+        case MD_OP_AXPY:
+            for(; k<n; k+=2){
+                y[k]   += x[k]*a[0] - x[k+1]*a[1];
+                y[k+1] += x[k]*a[1] + x[k+1]*a[0];
+            }
+            break;
+        default:
+            for(; k<n; k+=2){
+                re = x[k]*z[k] - x[k+1]*z[k+1];
+                im = x[k]*z[k+1] + x[k+1]*z[k];
+                y[k] = re;
+                y[k+1] = im;
+            }
+            break;
+    }
+}
+
+/* Runs a bulk operation over "n" floats (n/2 complex numbers, if "cplx"):
+ * y = a (MD_OP_SET), y = x (MD_OP_COPY), y = a*y (MD_OP_SCALE), y = y + a*x
+ * (MD_OP_AXPY) or y = x*z (MD_OP_MUL); where "a" is {re, im}. The vector
+ * stores are non-temporal if "stream" is set */
+static void md_bulk_f(int op, float* y, const float* x, const float* z,
+                      size_t n, int cplx, const float* a, int stream)
+{
+    size_t k;
+#if defined(MD_VBYTES)
+    size_t j, w;
+    float pat[MD_VBYTES/sizeof(float)];
+    MD_VF va, vb, v, u;
+    w = MD_VBYTES/sizeof(float);
+    k = 0;
+    if(stream && (size_t)y%(cplx ? 2*sizeof(float) : sizeof(float))==0){
+        /* scalar stores up to the first vector boundary (streaming stores
+         * must be aligned) */
+        while(k<n && (size_t)(y+k)%MD_VBYTES!=0)
+            k += cplx ? 2 : 1;
+        md_bulk_f_scalar(op, y, x, z, 0, k, cplx, a);
+    }
+    else
+        stream = 0;
+    /* the broadcast operands, as {re, im} patterns */
+    for(j=0; j<w; j+=2){
+        pat[j] = a[0];
+        pat[j+1] = op==MD_OP_SET && cplx ? a[1] : a[0];
+    }
+    va = MD_VF_LOAD(pat);
+    for(j=0; j<w; j+=2){
+        pat[j] = op==MD_OP_MUL ? -1.0f : -a[1];
+        pat[j+1] = op==MD_OP_MUL ? 1.0f : a[1];
+    }
+    vb = MD_VF_LOAD(pat);
+    switch(op){
+        case MD_OP_SET:
+            for(; k+w<=n; k+=w)
+                MD_VF_PUT(y+k, va, stream);
+            break;
+        case MD_OP_COPY:
+            for(; k+w<=n; k+=w)
+                MD_VF_PUT(y+k, MD_VF_LOAD(x+k), stream);
+            break;
+        case MD_OP_SCALE:
+        case MD_OP_AXPY:
+            for(; k+w<=n; k+=w){
+                v = MD_VF_LOAD(op==MD_OP_SCALE ? y+k : x+k);
+                v = cplx ? MD_VF_ADD(MD_VF_MUL(v, va), MD_VF_MUL(MD_VF_SWAP(v), vb)) : MD_VF_MUL(v, va);
+                MD_VF_PUT(y+k, op==MD_OP_SCALE ? v : MD_VF_ADD(MD_VF_LOAD(y+k), v), stream);
+            }
+            break;
+        default:
+            for(; k+w<=n; k+=w){
+                v = MD_VF_LOAD(x+k);
+                u = MD_VF_LOAD(z+k);
+                /* {xr*zr - xi*zi, xr*zi + xi*zr} */
+                v = cplx ? MD_VF_ADD(MD_VF_MUL(MD_VF_DUPRE(v), u), MD_VF_MUL(MD_VF_MUL(MD_VF_DUPIM(v), MD_VF_SWAP(u)), vb)) : MD_VF_MUL(v, u);
+                MD_VF_PUT(y+k, v, stream);
+            }
+            break;
+    }
+    if(stream)
+        MD_STREAM_FENCE();
+#else
+    (void)stream;
+    k = 0;
+#endif
+    md_bulk_f_scalar(op, y, x, z, k, n, cplx, a);
+}
+
+/* md_bulk_f_scalar() for doubles */
+static void md_bulk_d_scalar(int op, double* y, const double* x, const double* z,
+                             size_t k, size_t n, int cplx, const double* a)
+{
+    double re, im;
+    if(!cplx){
+        switch(op){
+            case MD_OP_SET:   for(; k<n; k++) y[k] = a[0]; break;
+            case MD_OP_COPY:  for(; k<n; k++) y[k] = x[k]; break;
+            case MD_OP_SCALE: for(; k<n; k++) y[k] *= a[0]; break;
+            case MD_OP_AXPY:  for(; k<n; k++) y[k] += a[0]*x[k]; break;
+            default:          for(; k<n; k++) y[k] = x[k]*z[k]; break;
+        }
+        return;
+    }
+    switch(op){
+        case MD_OP_SET:
+            for(; k<n; k+=2){
+                y[k] = a[0];
+                y[k+1] = a[1];
+            }
+            break;
+        case MD_OP_COPY:
+            for(; k<n; k+=2){
+                y[k] = x[k];
+                y[k+1] = x[k+1];
+            }
+            break;
+        case MD_OP_SCALE:
+            for(; k<n; k+=2){
+                re = y[k]*a[0] - y[k+1]*a[1];
+                im = y[k]*a[1] + y[k+1]*a[0];
+                y[k] = re;
+                y[k+1] = im;
+            }
+            break;
+        case MD_OP_AXPY:
+            for(; k<n; k+=2){
+                y[k]   += x[k]*a[0] - x[k+1]*a[1];
+                y[k+1] += x[k]*a[1] + x[k+1]*a[0];
+            }
+            break;
+        default:
+            for(; k<n; k+=2){
+                re = x[k]*z[k] - x[k+1]*z[k+1];
+                im = x[k]*z[k+1] + x[k+1]*z[k];
+                y[k] = re;
+                y[k+1] = im;
+            }
+            break;
+    }
+}
+
+/* md_bulk_f() for doubles */
+static void md_bulk_d(int op, double* y, const double* x, const double* z,
+                      size_t n, int cplx, const double* a, int stream)
+{
+    size_t k;
+#if defined(MD_VBYTES)
+    size_t j, w;
+    double pat[MD_VBYTES/sizeof(double)];
+    MD_VD va, vb, v, u;
+    w = MD_VBYTES/sizeof(double);
+    k = 0;
+    if(stream && (size_t)y%(cplx ? 2*sizeof(double) : sizeof(double))==0){
+        /* scalar stores up to the first vector boundary (streaming stores
+         * must be aligned) */
+        while(k<n && (size_t)(y+k)%MD_VBYTES!=0)
+            k += cplx ? 2 : 1;
+        md_bulk_d_scalar(op, y, x, z, 0, k, cplx, a);
+    }
+    else
+        stream = 0;
+    /* the broadcast operands, as {re, im} patterns */
+    for(j=0; j<w; j+=2){
+        pat[j] = a[0];
+        pat[j+1] = op==MD_OP_SET && cplx ? a[1] : a[0];
+    }
+    va = MD_VD_LOAD(pat);
+    for(j=0; j<w; j+=2){
+        pat[j] = op==MD_OP_MUL ? -1.0 : -a[1];
+        pat[j+1] = op==MD_OP_MUL ? 1.0 : a[1];
+    }
+    vb = MD_VD_LOAD(pat);
+    switch(op){
+        case MD_OP_SET:
+            for(; k+w<=n; k+=w)
+                MD_VD_PUT(y+k, va, stream);
+            break;
+        case MD_OP_COPY:
+            for(; k+w<=n; k+=w)
+                MD_VD_PUT(y+k, MD_VD_LOAD(x+k), stream);
+            break;
+        case MD_OP_SCALE:
+        case MD_OP_AXPY:
+            for(; k+w<=n; k+=w){
+                v = MD_VD_LOAD(op==MD_OP_SCALE ? y+k : x+k);
+                v = cplx ? MD_VD_ADD(MD_VD_MUL(v, va), MD_VD_MUL(MD_VD_SWAP(v), vb)) : MD_VD_MUL(v, va);
+                MD_VD_PUT(y+k, op==MD_OP_SCALE ? v : MD_VD_ADD(MD_VD_LOAD(y+k), v), stream);
+            }
+            break;
+        default:
+            for(; k+w<=n; k+=w){
+                v = MD_VD_LOAD(x+k);
+                u = MD_VD_LOAD(z+k);
+                /* {xr*zr - xi*zi, xr*zi + xi*zr} */
+                v = cplx ? MD_VD_ADD(MD_VD_MUL(MD_VD_DUPRE(v), u), MD_VD_MUL(MD_VD_MUL(MD_VD_DUPIM(v), MD_VD_SWAP(u)), vb)) : MD_VD_MUL(v, u);
+                MD_VD_PUT(y+k, v, stream);
+            }
+            break;
+    }
+    if(stream)
+        MD_STREAM_FENCE();
+#else
+    (void)stream;
+    k = 0;
+#endif
+    md_bulk_d_scalar(op, y, x, z, k, n, cplx, a);
+}
+
+/* see md_stream_set_threshold() (0 until first queried) */
+static volatile size_t md_stream_threshold_bytes;
+
+/* Size (in bytes) of the arrays from which the bulk operations stream */
+static size_t md_stream_threshold(void)
+{
+    size_t bytes;
+    long llc;
+    bytes = md_atomic_load(&md_stream_threshold_bytes);
+    if(bytes==0){
+        llc = 0;
+#if defined(MD_MALLOC_HAVE_FILE_MMAP) && defined(_SC_LEVEL3_CACHE_SIZE)
+        llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+        bytes = llc>0 ? (size_t)llc : (size_t)MD_MALLOC_STREAM_THRESHOLD;
+        md_atomic_store(&md_stream_threshold_bytes, bytes);
+    }
+    return bytes;
+}
+
+/* md_set()..md_mul(): "y", "x" and "z" are md arrays (or NULL, if not used by
+ * "op"), and "a" is the scalar operand (or NULL) */
+static void md_bulk(int op, void* y, const void* x, const void* z,
+                    size_t ndims, const size_t* dims, int type, const void* a)
+{
+    size_t l, n, es, chunk;
+    long c, nchunks;
+    int cplx, stream;
+    float af[2];
+    double ad[2];
+    unsigned char* py;
+    const unsigned char* px;
+    const unsigned char* pz;
+    if(y==NULL || ndims==0)
+        return;
+    if(type<MD_FLOAT || type>MD_DOUBLE_COMPLEX){
+#if !defined(NDEBUG)
+        fprintf(stderr, "Error: unknown element type (%d) for a bulk operation.\n", type);
+#endif
+        return;
+    }
+    cplx = type==MD_FLOAT_COMPLEX || type==MD_DOUBLE_COMPLEX;
+    es = type==MD_FLOAT || type==MD_FLOAT_COMPLEX ? sizeof(float) : sizeof(double);
+    n = cplx ? 2 : 1; /* number of reals */
+    for(l=0; l<ndims; l++)
+        n *= dims[l];
+    if(n==0)
+        return;
+    af[0] = af[1] = 0.0f;
+    ad[0] = ad[1] = 0.0;
+    if(a!=NULL){
+        if(es==sizeof(float)){
+            af[0] = ((const float*)a)[0];
+            af[1] = cplx ? ((const float*)a)[1] : 0.0f;
+        }
+        else{
+            ad[0] = ((const double*)a)[0];
+            ad[1] = cplx ? ((const double*)a)[1] : 0.0;
+        }
+    }
+    py = (unsigned char*)flattenNd(y, ndims);
+    px = x!=NULL ? (const unsigned char*)flattenNd((void*)x, ndims) : NULL;
+    pz = z!=NULL ? (const unsigned char*)flattenNd((void*)z, ndims) : NULL;
+    /* streaming only pays off for arrays which are not also read */
+    stream = (op==MD_OP_SET || op==MD_OP_COPY || (op==MD_OP_MUL && px!=py && pz!=py)) &&
+             n*es>=md_stream_threshold();
+#if defined(MD_MALLOC_ENABLE_OPENMP) && defined(_OPENMP)
+    chunk = n*es>=MD_MALLOC_OPENMP_COPY_THRESHOLD ? MD_BULK_CHUNK : n;
+#else
+    chunk = n;
+#endif
+    nchunks = (long)((n + chunk-1)/chunk);
+#if defined(MD_MALLOC_ENABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp parallel for schedule(static) if(nchunks>1)
+#endif
+    for(c=0; c<nchunks; c++){
+        size_t k0, len;
+        k0 = (size_t)c*chunk;
+        len = n-k0<chunk ? n-k0 : chunk;
+        if(es==sizeof(float))
+            md_bulk_f(op, (float*)(py + k0*es), px!=NULL ? (const float*)(px + k0*es) : NULL,
+                      pz!=NULL ? (const float*)(pz + k0*es) : NULL, len, cplx, af, stream);
+        else
+            md_bulk_d(op, (double*)(py + k0*es), px!=NULL ? (const double*)(px + k0*es) : NULL,
+                      pz!=NULL ? (const double*)(pz + k0*es) : NULL, len, cplx, ad, stream);
+    }
+}
+
+void md_set(void* ptr, size_t ndims, const size_t* dims, int type, const void* value)
+{
+    md_bulk(MD_OP_SET, ptr, NULL, NULL, ndims, dims, type, value);
+}
+
+void md_copy(void* dst, const void* src, size_t ndims, const size_t* dims, int type)
+{
+    md_bulk(MD_OP_COPY, dst, src, NULL, ndims, dims, type, NULL);
+}
+
+void md_scale(void* ptr, size_t ndims, const size_t* dims, int type, const void* alpha)
+{
+    md_bulk(MD_OP_SCALE, ptr, NULL, NULL, ndims, dims, type, alpha);
+}
+
+void md_axpy(void* y, const void* x, size_t ndims, const size_t* dims, int type, const void* alpha)
+{
+    md_bulk(MD_OP_AXPY, y, x, NULL, ndims, dims, type, alpha);
+}
+
+void md_mul(void* dst, const void* a, const void* b, size_t ndims, const size_t* dims, int type)
+{
+    md_bulk(MD_OP_MUL, dst, a, b, ndims, dims, type, NULL);
+}
+
+void md_stream_set_threshold(size_t bytes)
+{
+    md_atomic_store(&md_stream_threshold_bytes, bytes);
+}
+
+void md_cache_set_limit(size_t max_bytes)
+{
+    md_atomic_store(&md_cache_state.limit, max_bytes);
+    md_cache_trim(max_bytes);
+    if(max_bytes==0){
+        md_atomic_store(&md_cache_state.hits, 0);
+        md_atomic_store(&md_cache_state.misses, 0);
+    }
+}
+
+size_t md_cache_trim(size_t max_bytes)
+{
+    size_t b, released;
+    md_cache_entry* victims;
+    md_cache_entry* e;
+    victims = NULL;
+    released = 0;
+    md_lock(&md_cache_state.lock);
+    for(b=0; b<MD_CACHE_SHAPE_BUCKETS && md_cache_state.cached_bytes>max_bytes; b++){
+        while(md_cache_state.cached[b]!=NULL && md_cache_state.cached_bytes>max_bytes){
+            e = md_cache_state.cached[b];
+            md_cache_state.cached[b] = e->next;
+            md_atomic_add(&md_cache_state.cached_bytes, (size_t)0 - e->bytes);
+            released += e->bytes;
+            e->next = victims;
+            victims = e;
+        }
+    }
+    md_unlock(&md_cache_state.lock);
+    md_cache_release(victims);
+    return released;
+}
+
+size_t md_cache_info(size_t* hits, size_t* misses)
+{
+    if(hits!=NULL)
+        *hits = md_atomic_load(&md_cache_state.hits);
+    if(misses!=NULL)
+        *misses = md_atomic_load(&md_cache_state.misses);
+    return md_atomic_load(&md_cache_state.cached_bytes);
+}
+
+void md_free(void* ptr)
+{
+    md_release(ptr, 1);
+}
+
+void md_tcache_set_limit(size_t max_bytes)
+{
+#ifdef MD_MALLOC_HAVE_THREAD_CACHE
+    md_tcache* tc;
+    md_atomic_store(&md_tcache_state.limit, max_bytes);
+    if(max_bytes!=0)
+        return;
+    md_tcache_flush();
+    md_lock(&md_tcache_state.lock);
+    for(tc = md_tcache_state.all; tc!=NULL; tc = tc->next){
+        md_lock(&tc->lock);
+        tc->hits = tc->misses = 0;
+        md_unlock(&tc->lock);
+    }
+    md_unlock(&md_tcache_state.lock);
+#else
+    (void)max_bytes;
+#endif
+}
+
+size_t md_tcache_flush(void)
+{
+    size_t released = 0;
+#ifdef MD_MALLOC_HAVE_THREAD_CACHE
+    md_tcache* tc;
+    md_cache_entry* victims;
+    md_cache_entry* e;
+    victims = NULL;
+    md_lock(&md_tcache_state.lock);
+    for(tc = md_tcache_state.all; tc!=NULL; tc = tc->next){
+        md_lock(&tc->lock);
+        released += tc->cached_bytes;
+        e = md_tcache_empty(tc);
+        md_unlock(&tc->lock);
+        /* (append to "victims") */
+        while(e!=NULL){
+            md_cache_entry* next = e->next;
+            e->next = victims;
+            victims = e;
+            e = next;
+        }
+    }
+    md_unlock(&md_tcache_state.lock);
+    md_cache_release(victims);
+#endif
+    return released;
+}
+
+size_t md_tcache_info(size_t* hits, size_t* misses)
+{
+    size_t bytes, h, m;
+#ifdef MD_MALLOC_HAVE_THREAD_CACHE
+    md_tcache* tc;
+#endif
+    bytes = h = m = 0;
+#ifdef MD_MALLOC_HAVE_THREAD_CACHE
+    md_lock(&md_tcache_state.lock);
+    for(tc = md_tcache_state.all; tc!=NULL; tc = tc->next){
+        md_lock(&tc->lock);
+        bytes += tc->cached_bytes;
+        h += tc->hits;
+        m += tc->misses;
+        md_unlock(&tc->lock);
+    }
+    md_unlock(&md_tcache_state.lock);
+#endif
+    if(hits!=NULL)
+        *hits = h;
+    if(misses!=NULL)
+        *misses = m;
+    return bytes;
+}
+
+void md_huge_set_threshold(size_t bytes)
+{
+    md_atomic_store(&md_cache_state.huge_threshold, bytes);
+}
+
+void* mallocNd_huge(size_t ndims, const size_t* dims, size_t data_size)
+{
+    if(ndims==0)
+        return NULL;
+    return md_alloc_mapped(ndims, dims, data_size, MD_MODE_MALLOC, 1);
+}
+
+void* callocNd_huge(size_t ndims, const size_t* dims, size_t data_size)
+{
+    if(ndims==0)
+        return NULL;
+    return md_alloc_mapped(ndims, dims, data_size, MD_MODE_CALLOC, 1);
+}
+
+void** malloc2d_huge(size_t dim1, size_t dim2, size_t data_size)
+{
+    size_t dims[2];
+    dims[0] = dim1; dims[1] = dim2;
+    return (void**)mallocNd_huge(2, dims, data_size);
+}
+
+void** calloc2d_huge(size_t dim1, size_t dim2, size_t data_size)
+{
+    size_t dims[2];
+    dims[0] = dim1; dims[1] = dim2;
+    return (void**)callocNd_huge(2, dims, data_size);
+}
+
+void*** malloc3d_huge(size_t dim1, size_t dim2, size_t dim3, size_t data_size)
+{
+    size_t dims[3];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3;
+    return (void***)mallocNd_huge(3, dims, data_size);
+}
+
+void*** calloc3d_huge(size_t dim1, size_t dim2, size_t dim3, size_t data_size)
+{
+    size_t dims[3];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3;
+    return (void***)callocNd_huge(3, dims, data_size);
+}
+
+void**** malloc4d_huge(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t data_size)
+{
+    size_t dims[4];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4;
+    return (void****)mallocNd_huge(4, dims, data_size);
+}
+
+void**** calloc4d_huge(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t data_size)
+{
+    size_t dims[4];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4;
+    return (void****)callocNd_huge(4, dims, data_size);
+}
+
+void***** malloc5d_huge(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t data_size)
+{
+    size_t dims[5];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5;
+    return (void*****)mallocNd_huge(5, dims, data_size);
+}
+
+void***** calloc5d_huge(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t data_size)
+{
+    size_t dims[5];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5;
+    return (void*****)callocNd_huge(5, dims, data_size);
+}
+
+void****** malloc6d_huge(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t dim6, size_t data_size)
+{
+    size_t dims[6];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5; dims[5] = dim6;
+    return (void******)mallocNd_huge(6, dims, data_size);
+}
+
+void****** calloc6d_huge(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t dim6, size_t data_size)
+{
+    size_t dims[6];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5; dims[5] = dim6;
+    return (void******)callocNd_huge(6, dims, data_size);
+}
+
+/* Parses the decimal number at "str" into "*value", and sets "end" to the
+ * first character after it. Returns 0 if there are no digits, or if the number
+ * does not fit in a size_t */
+static int md_npy_number(const char* str, const char** end, size_t* value)
+{
+    size_t v, digit;
+    if(*str<'0' || *str>'9')
+        return 0;
+    for(v=0; *str>='0' && *str<='9'; str++){
+        digit = (size_t)(*str-'0');
+        if(v > (((size_t)-1) - digit)/10)
+            return 0;
+        v = v*10 + digit;
+    }
+    *end = str;
+    *value = v;
+    return 1;
+}
+
+/* Element size (in bytes) of a NumPy type string, e.g. 8 for "<f8" or 40 for
+ * "<U10" (whose characters are UCS-4); "end" is set to the first character
+ * after it. Returns 0 if it is not of a supported form */
+static size_t md_npy_itemsize(const char* descr, const char** end)
+{
+    size_t size;
+    if(descr[0]=='\0' || descr[1]=='\0' || !md_npy_number(descr+2, end, &size))
+        return 0;
+    if(descr[1]=='U')
+        size = size > ((size_t)-1)/4 ? 0 : size*4;
+    return size;
+}
+
+/* Returns 1 if an "ndims" array of the given shape fits in the "len" bytes of
+ * a file after its "offset" bytes of header, and if its pointer tables may be
+ * sized; i.e. no product overflows a size_t. (The shape is read from the file,
+ * and so cannot be trusted) */
+static int md_npy_fits(size_t ndims, const size_t* dims, size_t data_size,
+                       size_t offset, size_t len)
+{
+    size_t l, numel, count, total;
+    numel = 1;
+    for(l=0; l<ndims; l++){
+        if(dims[l]!=0 && numel > ((size_t)-1)/dims[l])
+            return 0;
+        numel *= dims[l];
+    }
+    if(data_size!=0 && numel > ((size_t)-1)/data_size)
+        return 0;
+    if(offset>len || numel*data_size > len-offset)
+        return 0;
+    /* (the tables are sized separately, as a zero dimension need not come first) */
+    count = 1;
+    total = 0;
+    for(l=0; l<ndims-1; l++){
+        if(dims[l]!=0 && count > ((size_t)-1)/dims[l])
+            return 0;
+        count *= dims[l];
+        if(total > ((size_t)-1) - count)
+            return 0;
+        total += count;
+    }
+    return total <= ((size_t)-1)/sizeof(void*);
+}
+
+/* Parses the header dictionary of a .npy file, e.g.
+ * "{'descr': '<f4', 'fortran_order': False, 'shape': (3, 4), }". Returns 0 if
+ * it is not of a supported form */
+static int md_npy_parse(const char* header, size_t* ndims, size_t* dims,
+                        size_t* data_size)
+{
+    const char* p;
+    const char* end;
+    p = strstr(header, "'descr'");
+    if(p==NULL || (p = strchr(p+7, '\'')) == NULL)
+        return 0;
+    p++;
+    *data_size = md_npy_itemsize(p, &end);
+    if(*data_size==0 || *end!='\'')
+        return 0;
+    /* only little-endian (or byte-sized) elements, in native order */
+    if(p[0]!='<' && p[0]!='|' && !(p[0]=='>' && *data_size==1))
+        return 0;
+    p = strstr(header, "'fortran_order'");
+    if(p==NULL || (p = strchr(p+15, ':')) == NULL)
+        return 0;
+    for(p++; *p==' '; p++) {}
+    if(strncmp(p, "False", 5)!=0)
+        return 0;
+    p = strstr(header, "'shape'");
+    if(p==NULL || (p = strchr(p+7, '(')) == NULL)
+        return 0;
+    for(*ndims=0, p++;;){
+        for(; *p==' ' || *p==','; p++) {}
+        if(*p==')')
+            break;
+        if(*ndims==MD_MAX_NDIMS || !md_npy_number(p, &end, &dims[*ndims]))
+            return 0;
+        (*ndims)++;
+        p = end;
+    }
+    return 1;
+}
+
+void* md_mmapNd(const char* filename, int mode, size_t ndims, size_t* dims, size_t* data_size)
+{
+#if defined(MD_MALLOC_HAVE_FILE_MMAP)
+    size_t l, len, hstart, offset, table_bytes, file_ndims, file_dims[MD_MAX_NDIMS];
+    unsigned char* map;
+    void* ptr;
+    char* header;
+    md_cache_entry* e;
+# if defined(_WIN32)
+    HANDLE file, mapping;
+    LARGE_INTEGER size;
+# else
+    int fd;
+    struct stat st;
+# endif
+    if(ndims<2 || ndims>MD_MAX_NDIMS)
+        return NULL;
+    len = 0;
+    /* map the whole file */
+# if defined(_WIN32)
+    file = CreateFileA(filename, mode==MD_MMAP_READWRITE ? GENERIC_READ|GENERIC_WRITE : GENERIC_READ,
+                       FILE_SHARE_READ|FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file==INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size) || size.QuadPart==0){
+        if(file!=INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        map = NULL;
+    }
+    else{
+        len = (size_t)size.QuadPart;
+        mapping = CreateFileMappingA(file, NULL, mode==MD_MMAP_READWRITE ? PAGE_READWRITE : PAGE_READONLY, 0, 0, NULL);
+        map = mapping==NULL ? NULL : (unsigned char*)MapViewOfFile(mapping,
+                  mode==MD_MMAP_READWRITE ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+        if(mapping!=NULL)
+            CloseHandle(mapping);
+        CloseHandle(file);
+    }
+# else
+    fd = open(filename, mode==MD_MMAP_READWRITE ? O_RDWR : O_RDONLY);
+    map = NULL;
+    if(fd>=0 && fstat(fd, &st)==0 && st.st_size>0){
+        len = (size_t)st.st_size;
+        map = (unsigned char*)mmap(NULL, len, mode==MD_MMAP_READWRITE ? PROT_READ|PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        if(map==(unsigned char*)MAP_FAILED)
+            map = NULL;
+    }
+    if(fd>=0)
+        close(fd);
+# endif
+    if(map==NULL){
+#if !defined(NDEBUG)
+        fprintf(stderr, "Error: 'md_mmapNd' failed to map '%s'.\n", filename);
+#endif
+        return NULL;
+    }
+
+    /* .npy header: magic string, version, header length, and then the header
+     * dictionary, padded so that the data is 64-byte aligned */
+    hstart = offset = file_ndims = 0;
+    if(len>=12 && memcmp(map, "\x93NUMPY", 6)==0){
+        hstart = map[6]==1 ? 10 : 12;
+        offset = hstart + (size_t)map[8] + ((size_t)map[9]<<8);
+        if(hstart==12)
+            offset += ((size_t)map[10]<<16) + ((size_t)map[11]<<24);
+    }
+    if(hstart!=0 && offset<=len && (header = (char*)malloc(offset-hstart+1)) != NULL){
+        /* (copied, so that it may be parsed as a string) */
+        memcpy(header, map+hstart, offset-hstart);
+        header[offset-hstart] = '\0';
+        if(!md_npy_parse(header, &file_ndims, file_dims, data_size))
+            file_ndims = 0;
+        free(header);
+    }
+    if(file_ndims==ndims)
+        for(l=0; l<ndims; l++)
+            dims[l] = file_dims[l];
+    if(file_ndims!=ndims || !md_npy_fits(ndims, dims, *data_size, offset, len)){
+#if !defined(NDEBUG)
+        fprintf(stderr, "Error: '%s' is not a supported %d-D .npy file.\n", filename, (int)ndims);
+#endif
+        md_unmap_file(map, len);
+        return NULL;
+    }
+
+    /* only the pointer tables are allocated */
+    table_bytes = md_table_count(ndims, dims)*sizeof(void*);
+    md_stats_count(MD_STATS_MALLOC, ndims, table_bytes, table_bytes);
+    ptr = md_sys_malloc(table_bytes);
+    e = (md_cache_entry*)malloc(sizeof(md_cache_entry));
+    if(ptr==NULL || e==NULL){
+        md_sys_free(ptr);
+        free(e);
+        md_unmap_file(map, len);
+        return NULL;
+    }
+    md_build_tables(ptr, ndims, dims, map + offset, dims[ndims-1]*(*data_size));
+    e->ptr = ptr;
+    e->header = 0;
+    e->owner = NULL;
+    e->mapped = len;
+    e->map = map;
+    e->file = 1;
+    md_cache_set_shape(e, ndims, dims, *data_size);
+    md_cache_insert(e);
+    return ptr;
+#else
+    (void)filename; (void)mode; (void)ndims; (void)dims; (void)data_size;
+    return NULL;
+#endif
+}
+
+void** md_mmap2d(const char* filename, int mode, size_t* dim1, size_t* dim2, size_t* data_size)
+{
+    size_t dims[2];
+    void* ptr = md_mmapNd(filename, mode, 2, dims, data_size);
+    if(ptr!=NULL){
+        *dim1 = dims[0]; *dim2 = dims[1];
+    }
+    return (void**)ptr;
+}
+
+void*** md_mmap3d(const char* filename, int mode, size_t* dim1, size_t* dim2, size_t* dim3, size_t* data_size)
+{
+    size_t dims[3];
+    void* ptr = md_mmapNd(filename, mode, 3, dims, data_size);
+    if(ptr!=NULL){
+        *dim1 = dims[0]; *dim2 = dims[1]; *dim3 = dims[2];
+    }
+    return (void***)ptr;
+}
+
+void**** md_mmap4d(const char* filename, int mode, size_t* dim1, size_t* dim2, size_t* dim3, size_t* dim4, size_t* data_size)
+{
+    size_t dims[4];
+    void* ptr = md_mmapNd(filename, mode, 4, dims, data_size);
+    if(ptr!=NULL){
+        *dim1 = dims[0]; *dim2 = dims[1]; *dim3 = dims[2]; *dim4 = dims[3];
+    }
+    return (void****)ptr;
+}
+
+void***** md_mmap5d(const char* filename, int mode, size_t* dim1, size_t* dim2, size_t* dim3, size_t* dim4, size_t* dim5, size_t* data_size)
+{
+    size_t dims[5];
+    void* ptr = md_mmapNd(filename, mode, 5, dims, data_size);
+    if(ptr!=NULL){
+        *dim1 = dims[0]; *dim2 = dims[1]; *dim3 = dims[2]; *dim4 = dims[3]; *dim5 = dims[4];
+    }
+    return (void*****)ptr;
+}
+
+void****** md_mmap6d(const char* filename, int mode, size_t* dim1, size_t* dim2, size_t* dim3, size_t* dim4, size_t* dim5, size_t* dim6, size_t* data_size)
+{
+    size_t dims[6];
+    void* ptr = md_mmapNd(filename, mode, 6, dims, data_size);
+    if(ptr!=NULL){
+        *dim1 = dims[0]; *dim2 = dims[1]; *dim3 = dims[2]; *dim4 = dims[3]; *dim5 = dims[4]; *dim6 = dims[5];
+    }
+    return (void******)ptr;
+}
+
+int md_save_npy(const char* filename, const void* ptr, size_t ndims, const size_t* dims, const char* descr)
+{
+    FILE* file;
+    char header[192 + 24*MD_MAX_NDIMS];
+    const char* end;
+    size_t l, len, numel, data_size, written;
+    if(ndims==0 || ndims>MD_MAX_NDIMS || descr==NULL || strlen(descr)<3 || strlen(descr)>16)
+        return -1;
+    data_size = md_npy_itemsize(descr, &end);
+    if(data_size==0 || *end!='\0'){
+#if !defined(NDEBUG)
+        fprintf(stderr, "Error: 'md_save_npy' does not support the type string '%s'.\n", descr);
+#endif
+        return -1;
+    }
+    /* header dictionary, e.g. "{'descr': '<f4', 'fortran_order': False, 'shape': (3, 4), }" */
+    len = (size_t)sprintf(header+10, "{'descr': '%s', 'fortran_order': False, 'shape': (", descr) + 10;
+    numel = 1;
+    for(l=0; l<ndims; l++){
+        len += (size_t)sprintf(header+len, ndims==1 ? "%zu," : (l==0 ? "%zu" : ", %zu"), dims[l]);
+        numel *= dims[l];
+    }
+    len += (size_t)sprintf(header+len, "), }");
+    /* padded with spaces and a newline, so that the data is 64-byte aligned */
+    while((len+1)%64!=0)
+        header[len++] = ' ';
+    header[len++] = '\n';
+    memcpy(header, "\x93NUMPY\x01\x00", 8);
+    header[8] = (char)((len-10) & 0xff);
+    header[9] = (char)((len-10) >> 8);
+    file = fopen(filename, "wb");
+    if(file==NULL){
+#if !defined(NDEBUG)
+        fprintf(stderr, "Error: 'md_save_npy' failed to open '%s'.\n", filename);
+#endif
+        return -1;
+    }
+    written = fwrite(header, 1, len, file);
+    if(numel!=0 && data_size!=0)
+        written += fwrite(flattenNd((void*)ptr, ndims), data_size, numel, file)*data_size;
+    if(fclose(file)!=0 || written != len + numel*data_size){
+#if !defined(NDEBUG)
+        fprintf(stderr, "Error: 'md_save_npy' failed to write '%s'.\n", filename);
+#endif
+        return -1;
+    }
+    return 0;
+}
+
+void* callocNd_numa(size_t ndims, const size_t* dims, size_t data_size, int policy)
+{
+    size_t l, slab, table_bytes;
+    unsigned char* ptr;
+    if(ndims==0)
+        return NULL;
+    /* (not huge pages, as slabs are usually much smaller than them) */
+    ptr = (unsigned char*)md_alloc_mapped(ndims, dims, data_size, MD_MODE_MALLOC, 0);
+    if(ptr==NULL)
+        return NULL;
+    slab = data_size;
+    for(l=1; l<ndims; l++)
+        slab *= dims[l];
+    md_sizeof(ndims, dims, data_size, &table_bytes);
+    md_numa_place(ptr + table_bytes, dims[0], slab, policy);
+    return ptr;
+}
+
+void** calloc2d_numa(size_t dim1, size_t dim2, size_t data_size, int policy)
+{
+    size_t dims[2];
+    dims[0] = dim1; dims[1] = dim2;
+    return (void**)callocNd_numa(2, dims, data_size, policy);
+}
+
+void*** calloc3d_numa(size_t dim1, size_t dim2, size_t dim3, size_t data_size, int policy)
+{
+    size_t dims[3];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3;
+    return (void***)callocNd_numa(3, dims, data_size, policy);
+}
+
+void**** calloc4d_numa(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t data_size, int policy)
+{
+    size_t dims[4];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4;
+    return (void****)callocNd_numa(4, dims, data_size, policy);
+}
+
+void***** calloc5d_numa(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t data_size, int policy)
+{
+    size_t dims[5];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5;
+    return (void*****)callocNd_numa(5, dims, data_size, policy);
+}
+
+void****** calloc6d_numa(size_t dim1, size_t dim2, size_t dim3, size_t dim4, size_t dim5, size_t dim6, size_t data_size, int policy)
+{
+    size_t dims[6];
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3; dims[3] = dim4; dims[4] = dim5; dims[5] = dim6;
+    return (void******)callocNd_numa(6, dims, data_size, policy);
+}
+
+int md_numa_node(const void* ptr)
+{
+#ifdef MD_MALLOC_ENABLE_NUMA
+    void* page;
+    int status;
+    if(ptr==NULL || numa_available()<0)
+        return -1;
+    page = (void*)((size_t)ptr & ~((size_t)numa_pagesize()-1));
+    status = -1;
+    if(numa_move_pages(0, 1, &page, NULL, &status, 0)!=0 || status<0)
+        return -1;
+    return status;
+#else
+    (void)ptr;
+    return -1;
+#endif
+}
 
 #endif /* MD_MALLOC_ENABLE */
 
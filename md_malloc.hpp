@@ -0,0 +1,451 @@
+/*
+ Copyright (c) 2019 Leo McCormack
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+/**
+ * @file md_malloc.hpp
+ * @brief C++ (11 or later) wrappers around the md_malloc.h allocators
+ *
+ * An example of allocating, indexing and (automatically) freeing a 3-D
+ * "array":
+ * \code{.cpp}
+ *   md_array<float, 3> example3D(10, 20, 5);  // same as malloc3d(10, 20, 5, sizeof(float))
+ *   std::memset(example3D.data(), 0, example3D.size()*sizeof(float));
+ *   example3D[3][19][2] = 22.0f;              // no casts
+ *   // freed when it goes out of scope
+ * \endcode
+ *
+ * As with md_malloc.h, the implementation of the C functions must be compiled
+ * in exactly one source file, by defining MD_MALLOC_ENABLE before including
+ * either header.
+ *
+ * @author Leo McCormack
+ * @date 11.06.2019
+ */
+
+#ifndef MD_MALLOC_HPP_INCLUDED
+#define MD_MALLOC_HPP_INCLUDED
+
+#include "md_malloc.h"
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+#if __cplusplus >= 202002L && defined(__has_include)
+# if __has_include(<span>)
+#  include <span>
+# endif
+# if __has_include(<mdspan>)
+#  include <mdspan>
+# endif
+#endif
+
+/** The type of an "N" dimensional md array of "T"; i.e. T with N stars */
+template<typename T, std::size_t N>
+struct md_pointer { typedef typename md_pointer<T, N-1>::type* type; };
+
+template<typename T>
+struct md_pointer<T, 0> { typedef T type; };
+
+/**
+ * Owns an "N" dimensional contiguous md array of "T" (allocated with
+ * mallocNd()/callocNd(), and freed with md_free())
+ *
+ * md_array is move-only, so it is never copied without that being asked for
+ * (see clone()); and may be returned from functions without reallocating.
+ * Indexing goes through the same pointer tables as the C arrays, and so
+ * compiles down to the same loads:
+ * \code{.cpp}
+ *   md_array<float, 3> make(std::size_t A, std::size_t B, std::size_t C){
+ *       md_array<float, 3> X = md_array<float, 3>::zeros(A, B, C);
+ *       X[0][1][2] = 1.0f;
+ *       return X;                          // moved, not copied
+ *   }
+ *   md_array<float, 3> Y = make(10, 20, 5);
+ *   float*** raw = Y.get();                // for passing on to C functions
+ *   std::size_t n = Y.extent(1);           // 20
+ * \endcode
+ * Since no constructors/destructors are run for the elements, "T" must be
+ * trivially copyable (as with the C allocators).
+ */
+template<typename T, std::size_t N>
+class md_array {
+    static_assert(N>=1, "md_array must have at least one dimension");
+    static_assert(std::is_trivially_copyable<T>::value, "md_array elements must be trivially copyable");
+public:
+    typedef T value_type;
+    typedef typename md_pointer<T, N>::type pointer;
+    typedef typename md_pointer<T, N-1>::type element; /**< Type of X[i] */
+
+    /** Rank of the array */
+    static constexpr std::size_t rank() { return N; }
+
+    /** An empty array (nothing is allocated) */
+    md_array() noexcept : ptr_(nullptr), dims_() {}
+
+    /**
+     * Allocates a dim1 x dim2 x ... array (uninitialised, as with malloc*d());
+     * throws std::bad_alloc if this fails
+     */
+    template<typename... Dims>
+    explicit md_array(std::size_t dim1, Dims... dims) : ptr_(nullptr), dims_()
+    {
+        static_assert(sizeof...(Dims)+1==N, "md_array needs one extent per dimension");
+        set_dims(dim1, dims...);
+        allocate(false);
+    }
+
+    /** Allocates a zero-initialised array (as with calloc*d()) */
+    template<typename... Dims>
+    static md_array zeros(Dims... dims)
+    {
+        static_assert(sizeof...(Dims)==N, "md_array needs one extent per dimension");
+        md_array a;
+        a.set_dims(dims...);
+        a.allocate(true);
+        return a;
+    }
+
+    /**
+     * Takes ownership of an existing md array (e.g. from malloc3d()), which
+     * will then be freed with md_free()
+     */
+    static md_array adopt(pointer ptr, const std::size_t (&dims)[N]) noexcept
+    {
+        md_array a;
+        a.ptr_ = ptr;
+        for(std::size_t l=0; l<N; l++)
+            a.dims_[l] = dims[l];
+        return a;
+    }
+
+    md_array(const md_array&) = delete;
+    md_array& operator=(const md_array&) = delete;
+
+    md_array(md_array&& other) noexcept : ptr_(other.ptr_)
+    {
+        for(std::size_t l=0; l<N; l++)
+            dims_[l] = other.dims_[l];
+        other.ptr_ = nullptr;
+    }
+
+    md_array& operator=(md_array&& other) noexcept
+    {
+        if(this!=&other){
+            md_free(ptr_);
+            ptr_ = other.ptr_;
+            for(std::size_t l=0; l<N; l++)
+                dims_[l] = other.dims_[l];
+            other.ptr_ = nullptr;
+        }
+        return *this;
+    }
+
+    ~md_array() { md_free(ptr_); }
+
+    /** A deep copy of the array */
+    md_array clone() const
+    {
+        md_array a;
+        for(std::size_t l=0; l<N; l++)
+            a.dims_[l] = dims_[l];
+        if(ptr_!=nullptr){
+            a.allocate(false);
+            std::memcpy(a.data(), data(), size()*sizeof(T));
+        }
+        return a;
+    }
+
+    /**
+     * Resizes the array, keeping the elements common to both shapes at the
+     * same indices (see reallocNd_preserve()); throws std::bad_alloc if this
+     * fails (in which case the array is left unchanged)
+     */
+    template<typename... Dims>
+    void resize(Dims... dims)
+    {
+        static_assert(sizeof...(Dims)==N, "md_array needs one extent per dimension");
+        std::size_t old_dims[N];
+        for(std::size_t l=0; l<N; l++)
+            old_dims[l] = dims_[l];
+        set_dims(dims...);
+        void* ptr = reallocNd_preserve(ptr_, N, old_dims, dims_, sizeof(T));
+        if(ptr==nullptr && md_sizeof(N, dims_, sizeof(T), nullptr)!=0){
+            for(std::size_t l=0; l<N; l++)
+                dims_[l] = old_dims[l];
+            throw std::bad_alloc();
+        }
+        ptr_ = static_cast<pointer>(ptr);
+    }
+
+    /** Element/sub-array "i" (i.e. X[i][j]..[k] indexes as for raw pointers) */
+    element& operator[](std::size_t i) const noexcept { return ptr_[i]; }
+
+    /** The md array itself (e.g. float*** for md_array<float, 3>) */
+    pointer get() const noexcept { return ptr_; }
+
+    /** Gives up ownership of the md array (which must then be md_free()'d) */
+    pointer release() noexcept { pointer p = ptr_; ptr_ = nullptr; return p; }
+
+    /** The flat contiguous block of data (same as FLATTENnD()) */
+    T* data() const noexcept { return static_cast<T*>(flattenNd(ptr_, N)); }
+
+    /** Total number of elements */
+    std::size_t size() const noexcept
+    {
+        std::size_t n = ptr_==nullptr ? 0 : 1;
+        for(std::size_t l=0; l<N; l++)
+            n *= dims_[l];
+        return n;
+    }
+
+    /** Length of dimension "k" */
+    std::size_t extent(std::size_t k) const noexcept { return dims_[k]; }
+
+    /** Lengths of all dimensions */
+    const std::size_t* extents() const noexcept { return dims_; }
+
+    bool empty() const noexcept { return ptr_==nullptr; }
+    explicit operator bool() const noexcept { return ptr_!=nullptr; }
+
+    /** Iteration over all elements, in memory order */
+    T* begin() const noexcept { return data(); }
+    T* end() const noexcept { return data()+size(); }
+
+    /** An md_view of the array (see md_malloc.h) */
+    md_view view() const noexcept
+    {
+        md_view v;
+        md_view_wrap(&v, data(), N, dims_, sizeof(T));
+        return v;
+    }
+
+#if defined(__cpp_lib_span)
+    /** All elements as a std::span (C++20) */
+    std::span<T> span() const noexcept { return std::span<T>(data(), size()); }
+#endif
+
+#if defined(__cpp_lib_mdspan)
+    /** A std::mdspan of the array (C++23); indexed as X(i, j, k), without
+     *  going through the pointer tables */
+    std::mdspan<T, std::dextents<std::size_t, N>> mdspan() const noexcept
+    {
+        return to_mdspan(std::make_index_sequence<N>());
+    }
+#endif
+
+private:
+    pointer ptr_;
+    std::size_t dims_[N];
+
+    void set_dims() noexcept {}
+
+    template<typename... Dims>
+    void set_dims(std::size_t dim, Dims... dims) noexcept
+    {
+        dims_[N-1-sizeof...(Dims)] = dim;
+        set_dims(dims...);
+    }
+
+    void allocate(bool zero)
+    {
+        void* ptr = zero ? callocNd(N, dims_, sizeof(T)) : mallocNd(N, dims_, sizeof(T));
+        if(ptr==nullptr && md_sizeof(N, dims_, sizeof(T), nullptr)!=0)
+            throw std::bad_alloc();
+        ptr_ = static_cast<pointer>(ptr);
+    }
+
+#if defined(__cpp_lib_mdspan)
+    template<std::size_t... L>
+    std::mdspan<T, std::dextents<std::size_t, N>> to_mdspan(std::index_sequence<L...>) const noexcept
+    {
+        return std::mdspan<T, std::dextents<std::size_t, N>>(data(), dims_[L]...);
+    }
+#endif
+};
+
+/** Marks the (outermost) extent of an md_fixed_array as given at run time */
+constexpr std::size_t md_dynamic = static_cast<std::size_t>(-1);
+
+/** The built-in array type T[E1][E2]..[En] */
+template<typename T, std::size_t... E>
+struct md_fixed_type;
+
+template<typename T>
+struct md_fixed_type<T> { typedef T type; };
+
+template<typename T, std::size_t E1, std::size_t... E>
+struct md_fixed_type<T, E1, E...> { typedef typename md_fixed_type<T, E...>::type type[E1]; };
+
+/**
+ * Owns a dim1 x E2 x .. x En contiguous array of "T", in which only the
+ * outermost extent is known at run time (passed as md_dynamic)
+ *
+ * Only the data block is allocated (as a 1-D array of dim1 rows, with
+ * mallocNd()/callocNd(), and freed with md_free()); there are no pointer
+ * tables. X[i] is a reference to a built-in T[E2]..[En] array, so
+ * X[i][j][k] compiles to the same address arithmetic as a mangled array
+ * (X[(i*E2+j)*E3+k]), with the inner strides as constants the compiler can
+ * unroll and vectorise against:
+ * \code{.cpp}
+ *   md_fixed_array<float, md_dynamic, 64, 4> X(nFrames); // nFrames x 64 x 4
+ *   for(std::size_t i=0; i<X.extent(0); i++)
+ *       for(std::size_t j=0; j<64; j++)
+ *           for(std::size_t k=0; k<4; k++)
+ *               X[i][j][k] = 0.0f;
+ *   float (*raw)[64][4] = X.get();                        // for passing on to C99 code
+ * \endcode
+ */
+template<typename T, std::size_t D1, std::size_t... E>
+class md_fixed_array {
+    static_assert(D1==md_dynamic, "the outermost extent of an md_fixed_array is given at run time (md_dynamic)");
+    static_assert(sizeof...(E)>=1, "md_fixed_array must have at least one fixed inner extent");
+    static_assert(std::is_trivially_copyable<T>::value, "md_fixed_array elements must be trivially copyable");
+public:
+    typedef T value_type;
+    typedef typename md_fixed_type<T, E...>::type element; /**< Type of X[i] (i.e. T[E2]..[En]) */
+    typedef element* pointer;
+
+    /** Rank of the array */
+    static constexpr std::size_t rank() { return sizeof...(E)+1; }
+
+    /** Number of elements in each X[i] */
+    static constexpr std::size_t row_size() { return sizeof(element)/sizeof(T); }
+
+    /** An empty array (nothing is allocated) */
+    md_fixed_array() noexcept : ptr_(nullptr), dim1_(0) {}
+
+    /**
+     * Allocates a dim1 x E2 x .. x En array (uninitialised); throws
+     * std::bad_alloc if this fails
+     */
+    explicit md_fixed_array(std::size_t dim1) : ptr_(nullptr), dim1_(dim1) { allocate(false); }
+
+    /** Allocates a zero-initialised array */
+    static md_fixed_array zeros(std::size_t dim1)
+    {
+        md_fixed_array a;
+        a.dim1_ = dim1;
+        a.allocate(true);
+        return a;
+    }
+
+    md_fixed_array(const md_fixed_array&) = delete;
+    md_fixed_array& operator=(const md_fixed_array&) = delete;
+
+    md_fixed_array(md_fixed_array&& other) noexcept : ptr_(other.ptr_), dim1_(other.dim1_)
+    {
+        other.ptr_ = nullptr;
+        other.dim1_ = 0;
+    }
+
+    md_fixed_array& operator=(md_fixed_array&& other) noexcept
+    {
+        if(this!=&other){
+            md_free(ptr_);
+            ptr_ = other.ptr_;
+            dim1_ = other.dim1_;
+            other.ptr_ = nullptr;
+            other.dim1_ = 0;
+        }
+        return *this;
+    }
+
+    ~md_fixed_array() { md_free(ptr_); }
+
+    /** A deep copy of the array */
+    md_fixed_array clone() const
+    {
+        md_fixed_array a;
+        a.dim1_ = dim1_;
+        if(ptr_!=nullptr){
+            a.allocate(false);
+            std::memcpy(a.ptr_, ptr_, dim1_*sizeof(element));
+        }
+        return a;
+    }
+
+    /**
+     * Changes the outermost extent, keeping the first min(old, new) X[i] in
+     * place (a single realloc); throws std::bad_alloc if this fails
+     */
+    void resize(std::size_t dim1)
+    {
+        void* ptr = reallocNd(ptr_, 1, &dim1, sizeof(element));
+        if(ptr==nullptr && dim1!=0)
+            throw std::bad_alloc();
+        ptr_ = static_cast<pointer>(ptr);
+        dim1_ = dim1;
+    }
+
+    /** Sub-array "i" (a built-in array, so X[i][j]..[k] indexes as usual) */
+    element& operator[](std::size_t i) const noexcept { return ptr_[i]; }
+
+    /** The array as a pointer to built-in T[E2]..[En] arrays */
+    pointer get() const noexcept { return ptr_; }
+
+    /** Gives up ownership of the array (which must then be md_free()'d) */
+    pointer release() noexcept { pointer p = ptr_; ptr_ = nullptr; dim1_ = 0; return p; }
+
+    /** The flat contiguous block of data */
+    T* data() const noexcept { return reinterpret_cast<T*>(ptr_); }
+
+    /** Total number of elements */
+    std::size_t size() const noexcept { return ptr_==nullptr ? 0 : dim1_*row_size(); }
+
+    /** Length of dimension "k" */
+    std::size_t extent(std::size_t k) const noexcept
+    {
+        const std::size_t inner[] = { E... };
+        return k==0 ? dim1_ : inner[k-1];
+    }
+
+    bool empty() const noexcept { return ptr_==nullptr; }
+    explicit operator bool() const noexcept { return ptr_!=nullptr; }
+
+    /** Iteration over all elements, in memory order */
+    T* begin() const noexcept { return data(); }
+    T* end() const noexcept { return data()+size(); }
+
+    /** An md_view of the array (see md_malloc.h) */
+    md_view view() const noexcept
+    {
+        const std::size_t dims[] = { dim1_, E... };
+        md_view v;
+        md_view_wrap(&v, data(), rank(), dims, sizeof(T));
+        return v;
+    }
+
+private:
+    pointer ptr_;
+    std::size_t dim1_;
+
+    void allocate(bool zero)
+    {
+        void* ptr = zero ? callocNd(1, &dim1_, sizeof(element)) : mallocNd(1, &dim1_, sizeof(element));
+        if(ptr==nullptr && dim1_!=0)
+            throw std::bad_alloc();
+        ptr_ = static_cast<pointer>(ptr);
+    }
+};
+
+#endif /* MD_MALLOC_HPP_INCLUDED */
@@ -0,0 +1,310 @@
+/*
+ Copyright (c) 2019 Leo McCormack
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+/**
+ * @file md_perf.h
+ * @brief Hardware performance counters for timing regions of code (e.g. loops
+ *        over md arrays)
+ *
+ * An example of counting the cache/TLB misses of a loop over a 3-D array:
+ * \code{.c}
+ *   md_perf perf;
+ *   md_perf_open(&perf);          // returns 0 if only timing is available
+ *   md_perf_start(&perf);
+ *   for(i=0; i<A; i++) for(j=0; j<B; j++) for(k=0; k<C; k++)
+ *       sum += example3D[i][j][k];
+ *   md_perf_stop(&perf);
+ *   md_perf_print(stdout, &perf, "3-D row-major", A*B*C);
+ *   md_perf_close(&perf);
+ * \endcode
+ *
+ * The counters are read using perf_event_open() on Linux (user-space only, so
+ * kernel.perf_event_paranoid must be 2 or lower). On other platforms, or when
+ * a counter is not supported by the CPU/kernel (e.g. in many virtual
+ * machines), it is simply marked as unavailable, and the wall-clock time is
+ * still measured.
+ *
+ * As with md_malloc.h, the implementation must be compiled in exactly one
+ * source file, by defining MD_PERF_ENABLE before including this header. On
+ * Linux, the counters also need the POSIX/GNU extensions (syscall() and
+ * CLOCK_MONOTONIC), which strict ISO modes such as -std=c99 hide; so either
+ * compile that file in a GNU mode (e.g. -std=gnu99, CMake's default), or
+ * define _GNU_SOURCE before its first #include:
+ * \code{.c}
+ *   #define _GNU_SOURCE
+ *   #include <stdio.h>
+ *   ...
+ *   #define MD_PERF_ENABLE
+ *   #include "md_perf.h"
+ * \endcode
+ * Otherwise, md_perf_open() returns 0 and only the (wall-clock) time is
+ * measured.
+ *
+ * @author Leo McCormack
+ * @date 11.06.2019
+ */
+
+/**********
+ * PUBLIC:
+ *********/
+
+#ifndef MD_PERF_INCLUDED
+#define MD_PERF_INCLUDED
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Hardware counters measured by md_perf */
+typedef enum _MD_PERF_COUNTERS {
+    MD_PERF_CYCLES = 0,      /**< CPU cycles */
+    MD_PERF_INSTRUCTIONS,    /**< Retired instructions */
+    MD_PERF_L1D_MISSES,      /**< L1 data cache read misses */
+    MD_PERF_LLC_MISSES,      /**< Last level cache misses */
+    MD_PERF_DTLB_MISSES,     /**< Data TLB read misses */
+    MD_PERF_BRANCH_MISSES,   /**< Mispredicted branches */
+
+    MD_PERF_NUM_COUNTERS
+} MD_PERF_COUNTERS;
+
+/**
+ * A set of hardware counters, and the results of the last measured region
+ *
+ * "values" are scaled up if the kernel had to multiplex the counters (i.e.
+ * when more counters are open than the CPU has registers for).
+ */
+typedef struct _md_perf {
+    int fd[MD_PERF_NUM_COUNTERS];                 /**< -1 if unavailable */
+    double values[MD_PERF_NUM_COUNTERS];          /**< Counts of the last region */
+    double elapsed_ns;                            /**< Wall-clock time of the last region */
+    double start_ns;
+} md_perf;
+
+/**
+ * Opens the hardware counters (all disabled until md_perf_start()), and
+ * returns how many of them are available; 0 means timing only
+ */
+int md_perf_open(md_perf* perf);
+
+/** Closes the counters */
+void md_perf_close(md_perf* perf);
+
+/** Returns non-zero if "counter" (see MD_PERF_COUNTERS) is available */
+int md_perf_available(const md_perf* perf, int counter);
+
+/** Name of a counter (e.g. "dtlb_misses") */
+const char* md_perf_name(int counter);
+
+/** Resets and starts the counters, and the wall-clock timer */
+void md_perf_start(md_perf* perf);
+
+/**
+ * Stops the counters and the timer, and stores the counts of the region since
+ * md_perf_start() in perf->values and perf->elapsed_ns
+ */
+void md_perf_stop(md_perf* perf);
+
+/**
+ * Prints the results of the last region on one line, as "label", the time,
+ * and each available counter, both in total and per "n" (e.g. per element
+ * accessed; pass 0 to omit); unavailable counters are printed as "n/a"
+ */
+void md_perf_print(FILE* stream, const md_perf* perf, const char* label,
+                   size_t n);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /* MD_PERF_INCLUDED */
+
+
+/************
+ * INTERNAL:
+ ***********/
+
+#if defined(MD_PERF_ENABLE) && !defined(MD_PERF_IMPLEMENTED)
+#define MD_PERF_IMPLEMENTED
+
+#include <string.h>
+#include <time.h>
+#if defined(__unix__) || defined(__APPLE__)
+# include <sys/time.h>
+#endif
+#if defined(__linux__)
+# include <unistd.h>
+# if defined(_DEFAULT_SOURCE) || defined(_GNU_SOURCE) /* syscall() is hidden in strict ISO modes (see above) */
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#  include <linux/perf_event.h>
+#  if defined(SYS_perf_event_open)
+#   define MD_PERF_HAVE_COUNTERS
+#  endif
+# endif
+#elif defined(_WIN32)
+# include <windows.h>
+#endif
+
+/* Wall-clock time in nanoseconds */
+static double md_perf_time_ns(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER f, t;
+    QueryPerformanceFrequency(&f);
+    QueryPerformanceCounter(&t);
+    return (double)t.QuadPart*1.0e9/(double)f.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec*1.0e9 + (double)ts.tv_nsec;
+#elif defined(__unix__) || defined(__APPLE__)
+    struct timeval tv; /* (-std=c99 hides CLOCK_MONOTONIC, and clock() is CPU time) */
+    gettimeofday(&tv, NULL);
+    return (double)tv.tv_sec*1.0e9 + (double)tv.tv_usec*1.0e3;
+#else
+    return (double)clock()*1.0e9/(double)CLOCKS_PER_SEC;
+#endif
+}
+
+#ifdef MD_PERF_HAVE_COUNTERS
+/* Opens one (disabled, user-space only) counter, or returns -1 */
+static int md_perf_event_open(__u32 type, __u64 config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/* Cache event "config" for perf_event_open (see PERF_TYPE_HW_CACHE) */
+#define MD_PERF_CACHE_MISS(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ<<8) | (PERF_COUNT_HW_CACHE_RESULT_MISS<<16))
+#endif
+
+int md_perf_open(md_perf* perf)
+{
+    int c, n;
+    memset(perf, 0, sizeof(md_perf));
+    for(c=0; c<MD_PERF_NUM_COUNTERS; c++)
+        perf->fd[c] = -1;
+#ifdef MD_PERF_HAVE_COUNTERS
+    perf->fd[MD_PERF_CYCLES]        = md_perf_event_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    perf->fd[MD_PERF_INSTRUCTIONS]  = md_perf_event_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    perf->fd[MD_PERF_L1D_MISSES]    = md_perf_event_open(PERF_TYPE_HW_CACHE, MD_PERF_CACHE_MISS(PERF_COUNT_HW_CACHE_L1D));
+    perf->fd[MD_PERF_LLC_MISSES]    = md_perf_event_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    perf->fd[MD_PERF_DTLB_MISSES]   = md_perf_event_open(PERF_TYPE_HW_CACHE, MD_PERF_CACHE_MISS(PERF_COUNT_HW_CACHE_DTLB));
+    perf->fd[MD_PERF_BRANCH_MISSES] = md_perf_event_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+#endif
+    for(c=0, n=0; c<MD_PERF_NUM_COUNTERS; c++)
+        n += perf->fd[c]>=0;
+    return n;
+}
+
+void md_perf_close(md_perf* perf)
+{
+    int c;
+    for(c=0; c<MD_PERF_NUM_COUNTERS; c++){
+#ifdef MD_PERF_HAVE_COUNTERS
+        if(perf->fd[c]>=0)
+            close(perf->fd[c]);
+#endif
+        perf->fd[c] = -1;
+    }
+}
+
+int md_perf_available(const md_perf* perf, int counter)
+{
+    return counter>=0 && counter<MD_PERF_NUM_COUNTERS && perf->fd[counter]>=0;
+}
+
+const char* md_perf_name(int counter)
+{
+    static const char* names[MD_PERF_NUM_COUNTERS] = {
+        "cycles", "instructions", "l1d_misses", "llc_misses", "dtlb_misses", "branch_misses"
+    };
+    return counter>=0 && counter<MD_PERF_NUM_COUNTERS ? names[counter] : "unknown";
+}
+
+void md_perf_start(md_perf* perf)
+{
+    int c;
+    for(c=0; c<MD_PERF_NUM_COUNTERS; c++){
+        perf->values[c] = 0.0;
+#ifdef MD_PERF_HAVE_COUNTERS
+        if(perf->fd[c]>=0){
+            ioctl(perf->fd[c], PERF_EVENT_IOC_RESET, 0);
+            ioctl(perf->fd[c], PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+    perf->start_ns = md_perf_time_ns();
+}
+
+void md_perf_stop(md_perf* perf)
+{
+    int c;
+#ifdef MD_PERF_HAVE_COUNTERS
+    __u64 buf[3]; /* value, time enabled, time running */
+#endif
+    perf->elapsed_ns = md_perf_time_ns() - perf->start_ns;
+    for(c=0; c<MD_PERF_NUM_COUNTERS; c++){
+#ifdef MD_PERF_HAVE_COUNTERS
+        if(perf->fd[c]<0)
+            continue;
+        ioctl(perf->fd[c], PERF_EVENT_IOC_DISABLE, 0);
+        if(read(perf->fd[c], buf, sizeof(buf))!=(ssize_t)sizeof(buf))
+            perf->values[c] = 0.0;
+        else if(buf[2]!=0 && buf[2]<buf[1]) /* multiplexed; scale up to the full region */
+            perf->values[c] = (double)buf[0]*(double)buf[1]/(double)buf[2];
+        else
+            perf->values[c] = (double)buf[0];
+#endif
+    }
+}
+
+void md_perf_print(FILE* stream, const md_perf* perf, const char* label, size_t n)
+{
+    int c;
+    fprintf(stream, "%-28s %12.0f ns", label, perf->elapsed_ns);
+    if(n!=0)
+        fprintf(stream, " (%7.3f/elem)", perf->elapsed_ns/(double)n);
+    for(c=0; c<MD_PERF_NUM_COUNTERS; c++){
+        if(perf->fd[c]<0)
+            fprintf(stream, "  %s n/a", md_perf_name(c));
+        else if(n!=0)
+            fprintf(stream, "  %s %.0f (%.3f/elem)", md_perf_name(c), perf->values[c],
+                    perf->values[c]/(double)n);
+        else
+            fprintf(stream, "  %s %.0f", md_perf_name(c), perf->values[c]);
+    }
+    fprintf(stream, "\n");
+}
+
+#endif /* MD_PERF_ENABLE */
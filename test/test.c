@@ -29,12 +29,21 @@
 
 /* include md_malloc like so: */
 #define MD_MALLOC_ENABLE
+#define MD_MALLOC_ENABLE_SIMD    /* optional: SIMD pointer-table construction */
+#define MD_MALLOC_ENABLE_OPENMP  /* optional: multithreaded pointer-table construction (if built with OpenMP) */
+#define MD_MALLOC_ENABLE_STATS   /* optional: allocation statistics (see md_stats_snapshot) */
+#define MD_MALLOC_ENABLE_THREAD_CACHE /* optional: per-thread recycling caches (see md_tcache_set_limit) */
 #include "../md_malloc.h"
 
 /* TEST CONFIGURATION */
-#define ENABLE_C99_SPEED_TESTS  /* compares m_malloc also to C99-style.  */
-#define ENABLE_CBLAS_TESTS
-#define MAX_DIMENSION_LENGTH 300  /* beware stack overflows */
+#ifndef DISABLE_CBLAS_TESTS
+# define ENABLE_CBLAS_TESTS
+#endif
+#define MAX_DIMENSION_LENGTH 300
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+/* element "k" of the (float or double) data block of an md array, for the bulk operations test */
+#define BULK_AT(p, k) (bulk_es==sizeof(float) ? (double)((float*)FLATTEN3D(p))[k] : ((double*)FLATTEN3D(p))[k])
+#define BULK_SET(p, k, v) do{ if(bulk_es==sizeof(float)) ((float*)FLATTEN3D(p))[k] = (float)(v); else ((double*)FLATTEN3D(p))[k] = (v); }while(0)
 typedef float test_data_type;
 
 #ifdef ENABLE_CBLAS_TESTS
@@ -50,24 +59,66 @@ typedef float test_data_type;
 
 int main(int argc, const char * argv[])
 {
-    int iter, i, j, k, dim1, dim2, dim3;
+    int iter, i, j, k, l, p, q, r, s, dim1, dim2, dim3, dim4, dim5;
+    size_t n, dims8d[8], old_dims4d[4], new_dims4d[4], index6d[6];
+    md_view view, view2;
+    size_t alignment, pitch, overhead;
+    md_stats stats, stats2;
+    md_arena arena;
+    size_t mark, hits, misses;
+    md_batch_desc descs[4];
+    size_t batch_dims[4][4];
+    void* batch[4];
+    void* block;
+    size_t perm[6], pdims[6], pidx[6];
+    unsigned char* src_bytes;
+    unsigned char* dst_bytes;
+    void* permuted;
+    void* result;
+    md_range ranges[4];
+    test_data_type*** sub3d;
+    test_data_type**** sub4d;
+    test_data_type*** split_re;
+    test_data_type*** split_im;
+    test_data_type* cplx;
+    double* planes_d;
+    double* cplx_d;
+    int bulk_type;
+    size_t bulk_es;
+    float alpha_f[2];
+    double alpha_d[2];
+    double* bulk_ref;
+    void*** bulk_x;
+    void*** bulk_y;
+    void*** bulk_z;
+    void* clone;
+    size_t clone_bytes;
+    md_ring ring;
+    md_grow grow;
+    unsigned char* walk;
+    void* recycled;
+    size_t data_size;
+    int status;
+    test_data_type*** mapped3d;
     test_data_type** array2d_dynamic;
     test_data_type** array2d_dynamic2;
-    test_data_type** array2d_dynamic3;
     test_data_type*** array3d_dynamic;
-    test_data_type* mangled_array2d_dynamic;
-    test_data_type* mangled_array3d_dynamic;
-    test_data_type array2d_static_rand[MAX_DIMENSION_LENGTH*MAX_DIMENSION_LENGTH];
-    test_data_type array2d_static_rand2[MAX_DIMENSION_LENGTH*MAX_DIMENSION_LENGTH];
-    test_data_type array2d_static_rand3[MAX_DIMENSION_LENGTH*MAX_DIMENSION_LENGTH];
-    test_data_type array3d_static[MAX_DIMENSION_LENGTH*MAX_DIMENSION_LENGTH*MAX_DIMENSION_LENGTH];
+    test_data_type***** array5d_dynamic;
+    test_data_type******** array8d_dynamic;
+    test_data_type**** array4d_dynamic;
+    test_data_type****** array6d_dynamic;
+    static test_data_type array2d_static_rand[MAX_DIMENSION_LENGTH*MAX_DIMENSION_LENGTH];
+    static test_data_type array3d_static[MAX_DIMENSION_LENGTH*MAX_DIMENSION_LENGTH*MAX_DIMENSION_LENGTH];
+#ifdef ENABLE_CBLAS_TESTS
+    size_t pitch2;
+    test_data_type** array2d_dynamic3;
+    static test_data_type array2d_static_rand2[MAX_DIMENSION_LENGTH*MAX_DIMENSION_LENGTH];
+    static test_data_type array2d_static_rand3[MAX_DIMENSION_LENGTH*MAX_DIMENSION_LENGTH];
+#endif
     float error;
-    int msec, msec2;
+    int msec;
     clock_t difference;
     clock_t before;
-#ifdef ENABLE_C99_SPEED_TESTS
-    int msec3;
-#endif
     
     /*********************************************************************************************************/
     printf("********** Malloc Contiguity Test - RANDOM 2D DATA **********\n");
@@ -88,7 +139,7 @@ int main(int argc, const char * argv[])
             for(j=0; j<dim2; j++)
                 error += fabs(array2d_dynamic[i][j]-array2d_static_rand[i*dim2 + j]);
         assert(error <= 2.23e-8f); /* if you land on this assertion, "array2d_dynamic" is not contiguously allocated */
-        free2d((void**)array2d_dynamic);
+        free(array2d_dynamic);
     }
     difference = clock() - before;
     msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
@@ -109,7 +160,7 @@ int main(int argc, const char * argv[])
             for(j=0; j<dim2; j++)
                 error += fabs(array2d_dynamic[i][j]);
         assert(error <= 2.23e-8f); /* if you land on this assertion, "array2d_dynamic" was not correctly allocated and/or zero'd */
-        free2d((void**)array2d_dynamic);
+        free(array2d_dynamic);
     }
     difference = clock() - before;
     msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
@@ -117,91 +168,188 @@ int main(int argc, const char * argv[])
 
 
     /*********************************************************************************************************/
-    printf("********** Malloc Speed Test - 2D DATA **********\n");
+    printf("********** Realloc Contiguity Test - RANDOM 2D DATA **********\n");
+    error = 0.0f;
     before = clock();
-    dim1 = MAX_DIMENSION_LENGTH-10;
-    dim2 = MAX_DIMENSION_LENGTH;
-    for(iter=0; iter<30000; iter++){
-        mangled_array2d_dynamic = malloc(dim1* dim2* sizeof(test_data_type));
-        /* populate array */
+    array2d_dynamic = (test_data_type**)malloc2d(20, 20, sizeof(test_data_type));
+    for(iter=0; iter<100000; iter++){
+        dim1 = (int)((float)MAX_DIMENSION_LENGTH*(float)rand()/(float)RAND_MAX);
+        dim2 = (int)((float)MAX_DIMENSION_LENGTH*(float)rand()/(float)RAND_MAX);
+        if(dim1<1 || dim1>MAX_DIMENSION_LENGTH) dim1 = 1;
+        if(dim2<1 || dim2>MAX_DIMENSION_LENGTH) dim2 = 1;
+
+        array2d_dynamic = (test_data_type**)realloc2d((void**)array2d_dynamic, dim1, dim2, sizeof(test_data_type));
         for(i=0; i<dim1; i++)
             for(j=0; j<dim2; j++)
-                mangled_array2d_dynamic[i*dim2+j] = rand();
-        free(mangled_array2d_dynamic);
+                array2d_dynamic[i][j] = rand()/RAND_MAX;
+        /* only passes this test if "array2d_dynamic" is truely contiguous */
+        memcpy(&array2d_static_rand[0], FLATTEN2D(array2d_dynamic), dim1*dim2*sizeof(test_data_type));
+        for(i=0; i<dim1; i++)
+            for(j=0; j<dim2; j++)
+                error += fabs(array2d_dynamic[i][j]-array2d_static_rand[i*dim2 + j]);
+        assert(error <= 2.23e-8f); /* if you land on this assertion, "array2d_dynamic" is not contiguously allocated */
     }
+    free(array2d_dynamic);
     difference = clock() - before;
     msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
-    printf(" - Mangled array time taken %d seconds %d milliseconds\n", msec/1000, msec%1000);
-    
+    printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
+
+
+    /*********************************************************************************************************/
+    printf("********** Aligned Malloc Test - RANDOM 2D/5D DATA **********\n");
+    error = 0.0f;
     before = clock();
-    for(iter=0; iter<30000; iter++){
-        array2d_dynamic = (test_data_type**)malloc2d(dim1, dim2, sizeof(test_data_type));
-        /* populate array */
+    for(iter=0; iter<10000; iter++){
+        dim1 = (int)((float)MAX_DIMENSION_LENGTH*(float)rand()/(float)RAND_MAX);
+        dim2 = (int)((float)MAX_DIMENSION_LENGTH*(float)rand()/(float)RAND_MAX);
+        if(dim1<1 || dim1>MAX_DIMENSION_LENGTH) dim1 = 1;
+        if(dim2<1 || dim2>MAX_DIMENSION_LENGTH) dim2 = 1;
+        alignment = (size_t)16 << (iter%4); /* 16, 32, 64, 128 */
+        array2d_dynamic = (test_data_type**)aligned_calloc2d(dim1, dim2, sizeof(test_data_type), alignment, 0);
+        assert((size_t)FLATTEN2D(array2d_dynamic) % alignment == 0);
         for(i=0; i<dim1; i++)
             for(j=0; j<dim2; j++)
-                array2d_dynamic[i][j] = rand();
+                error += fabs(array2d_dynamic[i][j]);
+        array2d_dynamic = (test_data_type**)aligned_realloc2d((void**)array2d_dynamic, dim2, dim1, sizeof(test_data_type), alignment, 1);
+        for(i=0; i<dim2; i++){
+            assert((size_t)array2d_dynamic[i] % alignment == 0); /* each row should also be aligned */
+            for(j=0; j<dim1; j++)
+                array2d_dynamic[i][j] = rand()/RAND_MAX;
+        }
+        assert(error <= 2.23e-8f);
         free(array2d_dynamic);
     }
-    difference = clock() - before;
-    msec2 = difference * 1000.0f / (float)CLOCKS_PER_SEC;
-    printf(" - md_malloc time taken %d seconds %d milliseconds\n", msec2/1000, msec2%1000);
-
-#ifdef ENABLE_C99_SPEED_TESTS
-    /* run same test using C99 dynamic arrays */
-    before = clock();
-    for(iter=0; iter<30000; iter++){
-        test_data_type (*array2d_dynamic)[dim2] = malloc(sizeof(test_data_type[dim1][dim2]));
-        /* populate array */
+    for(iter=0; iter<100; iter++){
+        dim1 = 1+rand()%12; dim2 = 1+rand()%12; dim3 = 1+rand()%12; dim4 = 1+rand()%12; dim5 = 1+rand()%12;
+        array5d_dynamic = (test_data_type*****)aligned_malloc5d(dim1, dim2, dim3, dim4, dim5, sizeof(test_data_type), 4096, 0);
+        assert((size_t)FLATTEN5D(array5d_dynamic) % 4096 == 0);
         for(i=0; i<dim1; i++)
             for(j=0; j<dim2; j++)
-                array2d_dynamic[i][j] = rand();
-        free(array2d_dynamic);
+                for(k=0; k<dim3; k++)
+                    for(l=0; l<dim4; l++)
+                        for(p=0; p<dim5; p++)
+                            array5d_dynamic[i][j][k][l][p] = (test_data_type)(i*dim2*dim3*dim4*dim5 + j*dim3*dim4*dim5 + k*dim4*dim5 + l*dim5 + p);
+        /* only passes this test if "array5d_dynamic" is truely contiguous */
+        for(i=0; i<dim1*dim2*dim3*dim4*dim5; i++)
+            error += fabs(FLATTEN5D(array5d_dynamic)[i] - (test_data_type)i);
+        assert(error <= 2.23e-8f);
+        free(array5d_dynamic);
     }
     difference = clock() - before;
-    msec3 = difference * 1000.0f / (float)CLOCKS_PER_SEC;
-    printf(" - C99-style malloc time taken %d seconds %d milliseconds\n", msec3/1000, msec3%1000);
-#endif
-    
-    if(msec2>msec)
-        printf("md_malloc was %d seconds %d milliseconds SLOWER than Mangled array\n", (msec2-msec)/1000, (msec2-msec)%1000);
-    else
-        printf("md_malloc was %d seconds %d milliseconds FASTER than Mangled array\n", (msec-msec2)/1000, (msec-msec2)%1000);
-#ifdef ENABLE_C99_SPEED_TESTS
-    if(msec2>msec3)
-        printf("md_malloc was %d seconds %d milliseconds SLOWER than C99-style array\n", (msec2-msec3)/1000, (msec2-msec3)%1000);
-    else
-        printf("md_malloc was %d seconds %d milliseconds FASTER than C99-style array\n", (msec3-msec2)/1000, (msec3-msec2)%1000);
-#endif
-    printf("\n");
+    msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
 
-    
     /*********************************************************************************************************/
-    printf("********** Realloc Contiguity Test - RANDOM 2D DATA **********\n");
+    printf("********** Pitched Malloc Test - RANDOM 2D/3D DATA **********\n");
     error = 0.0f;
     before = clock();
-    array2d_dynamic = (test_data_type**)malloc2d(20, 20, sizeof(test_data_type));
-    for(iter=0; iter<100000; iter++){
+    for(iter=0; iter<10000; iter++){
         dim1 = (int)((float)MAX_DIMENSION_LENGTH*(float)rand()/(float)RAND_MAX);
         dim2 = (int)((float)MAX_DIMENSION_LENGTH*(float)rand()/(float)RAND_MAX);
         if(dim1<1 || dim1>MAX_DIMENSION_LENGTH) dim1 = 1;
         if(dim2<1 || dim2>MAX_DIMENSION_LENGTH) dim2 = 1;
-
-        array2d_dynamic = (test_data_type**)realloc2d((void**)array2d_dynamic, dim1, dim2, sizeof(test_data_type));
+        array2d_dynamic = (test_data_type**)calloc2d_pitched(dim1, dim2, sizeof(test_data_type), 64, iter%2, &pitch);
+        assert(pitch>=(size_t)dim2 && (pitch*sizeof(test_data_type))%64 == 0);
+        if(iter%2)
+            assert(((pitch*sizeof(test_data_type))/64)%2 == 1); /* odd number of cache lines */
+        for(i=0; i<dim1; i++){
+            /* rows should be "pitch" elements apart, and cache line aligned */
+            assert(array2d_dynamic[i] == FLATTEN2D(array2d_dynamic) + i*pitch);
+            assert((size_t)array2d_dynamic[i] % 64 == 0);
+            for(j=0; j<dim2; j++)
+                error += fabs(array2d_dynamic[i][j]);
+        }
+        assert(error <= 2.23e-8f);
+        free(array2d_dynamic);
+    }
+    array2d_dynamic = (test_data_type**)malloc2d_pitched(64, 1024, sizeof(float), 64, 1, &pitch);
+    assert(pitch == 1040);
+    free(array2d_dynamic);
+    for(iter=0; iter<100; iter++){
+        dim1 = 1+rand()%40; dim2 = 1+rand()%40; dim3 = 1+rand()%40;
+        array3d_dynamic = (test_data_type***)malloc3d_pitched(dim1, dim2, dim3, sizeof(test_data_type), 0, 1, &pitch);
+        assert(pitch>=(size_t)dim3 && pitch%2 == 1);
         for(i=0; i<dim1; i++)
             for(j=0; j<dim2; j++)
-                array2d_dynamic[i][j] = rand()/RAND_MAX;
-        /* only passes this test if "array2d_dynamic" is truely contiguous */
-        memcpy(&array2d_static_rand[0], FLATTEN2D(array2d_dynamic), dim1*dim2*sizeof(test_data_type));
+                for(k=0; k<dim3; k++)
+                    array3d_dynamic[i][j][k] = (test_data_type)k;
         for(i=0; i<dim1; i++)
             for(j=0; j<dim2; j++)
-                error += fabs(array2d_dynamic[i][j]-array2d_static_rand[i*dim2 + j]);
-        assert(error <= 2.23e-8f); /* if you land on this assertion, "array2d_dynamic" is not contiguously allocated */
+                for(k=0; k<dim3; k++)
+                    error += fabs(FLATTEN3D(array3d_dynamic)[(i*dim2+j)*pitch + k] - (test_data_type)k);
+        assert(error <= 2.23e-8f);
+        free(array3d_dynamic);
     }
-    free(array2d_dynamic);
     difference = clock() - before;
     msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
     printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
 
+    /*********************************************************************************************************/
+    printf("********** Order-Preserving Realloc Test - RANDOM 2D/3D/4D DATA **********\n");
+    error = 0.0f;
+    before = clock();
+    dim1 = dim2 = 20;
+    array2d_dynamic = (test_data_type**)malloc2d(dim1, dim2, sizeof(test_data_type));
+    for(i=0; i<dim1; i++)
+        for(j=0; j<dim2; j++)
+            array2d_dynamic[i][j] = (test_data_type)(i*1000 + j);
+    for(iter=0; iter<10000; iter++){
+        k = 1+rand()%MAX_DIMENSION_LENGTH; /* new dim1 */
+        l = 1+rand()%MAX_DIMENSION_LENGTH; /* new dim2 */
+        array2d_dynamic = (test_data_type**)realloc2d_preserve((void**)array2d_dynamic, dim1, dim2, k, l, sizeof(test_data_type));
+        /* the overlapping region should be intact */
+        for(i=0; i<MIN(dim1,k); i++)
+            for(j=0; j<MIN(dim2,l); j++)
+                error += fabs(array2d_dynamic[i][j] - (test_data_type)(i*1000 + j));
+        assert(error <= 2.23e-8f);
+        dim1 = k;
+        dim2 = l;
+        for(i=0; i<dim1; i++)
+            for(j=0; j<dim2; j++)
+                array2d_dynamic[i][j] = (test_data_type)(i*1000 + j);
+    }
+    free(array2d_dynamic);
+    dim1 = dim2 = dim3 = 10;
+    array3d_dynamic = (test_data_type***)calloc3d(dim1, dim2, dim3, sizeof(test_data_type));
+    for(iter=0; iter<1000; iter++){
+        for(i=0; i<dim1; i++)
+            for(j=0; j<dim2; j++)
+                for(k=0; k<dim3; k++)
+                    array3d_dynamic[i][j][k] = (test_data_type)(i*10000 + j*100 + k);
+        l = 1+rand()%40; p = 1+rand()%40; q = 1+rand()%40;
+        array3d_dynamic = (test_data_type***)realloc3d_preserve((void***)array3d_dynamic, dim1, dim2, dim3, l, p, q, sizeof(test_data_type));
+        for(i=0; i<MIN(dim1,l); i++)
+            for(j=0; j<MIN(dim2,p); j++)
+                for(k=0; k<MIN(dim3,q); k++)
+                    error += fabs(array3d_dynamic[i][j][k] - (test_data_type)(i*10000 + j*100 + k));
+        assert(error <= 2.23e-8f);
+        dim1 = l; dim2 = p; dim3 = q;
+    }
+    free(array3d_dynamic);
+    for(i=0; i<4; i++)
+        old_dims4d[i] = 1+rand()%12;
+    array4d_dynamic = (test_data_type****)mallocNd(4, old_dims4d, sizeof(test_data_type));
+    for(iter=0; iter<1000; iter++){
+        for(i=0; i<(int)old_dims4d[0]; i++)
+            for(j=0; j<(int)old_dims4d[1]; j++)
+                for(k=0; k<(int)old_dims4d[2]; k++)
+                    for(l=0; l<(int)old_dims4d[3]; l++)
+                        array4d_dynamic[i][j][k][l] = (test_data_type)(i*1000 + j*100 + k*10 + l);
+        for(i=0; i<4; i++)
+            new_dims4d[i] = rand()%2 ? old_dims4d[i] : (size_t)(1+rand()%12); /* some dimensions stay the same */
+        array4d_dynamic = (test_data_type****)reallocNd_preserve(array4d_dynamic, 4, old_dims4d, new_dims4d, sizeof(test_data_type));
+        for(i=0; i<(int)MIN(old_dims4d[0],new_dims4d[0]); i++)
+            for(j=0; j<(int)MIN(old_dims4d[1],new_dims4d[1]); j++)
+                for(k=0; k<(int)MIN(old_dims4d[2],new_dims4d[2]); k++)
+                    for(l=0; l<(int)MIN(old_dims4d[3],new_dims4d[3]); l++)
+                        error += fabs(array4d_dynamic[i][j][k][l] - (test_data_type)(i*1000 + j*100 + k*10 + l));
+        assert(error <= 2.23e-8f);
+        memcpy(old_dims4d, new_dims4d, sizeof(old_dims4d));
+    }
+    free(array4d_dynamic);
+    difference = clock() - before;
+    msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
 
 #ifdef ENABLE_CBLAS_TESTS
     /*********************************************************************************************************/
@@ -248,6 +396,48 @@ int main(int argc, const char * argv[])
     difference = clock() - before;
     msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
     printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
+    /*********************************************************************************************************/
+    printf("********** Pitched Malloc Test - CBLAS WITH RANDOM 2D DATA **********\n");
+    error = 0.0f;
+    before = clock();
+    for(iter=0; iter<20000; iter++){
+        dim1 = (int)((float)MAX_DIMENSION_LENGTH*(float)rand()/(float)RAND_MAX);
+        dim2 = (int)((float)MAX_DIMENSION_LENGTH*(float)rand()/(float)RAND_MAX);
+        dim3 = (int)((float)MAX_DIMENSION_LENGTH*(float)rand()/(float)RAND_MAX);
+        if(dim1<1 || dim1>MAX_DIMENSION_LENGTH) dim1 = 1;
+        if(dim2<1 || dim2>MAX_DIMENSION_LENGTH) dim2 = 1;
+        if(dim3<1 || dim3>MAX_DIMENSION_LENGTH) dim3 = 1;
+
+        array2d_dynamic = (test_data_type**)malloc2d_pitched(dim1, dim2, sizeof(test_data_type), 64, 1, &pitch);
+        array2d_dynamic2 = (test_data_type**)malloc2d(dim2, dim3, sizeof(test_data_type));
+        array2d_dynamic3 = (test_data_type**)malloc2d_pitched(dim1, dim3, sizeof(test_data_type), 64, 1, &pitch2);
+
+        for(i=0; i<dim1; i++)
+            for(j=0; j<dim2; j++)
+                array2d_static_rand[i*dim2 + j] = array2d_dynamic[i][j] = rand()/RAND_MAX;
+        for(i=0; i<dim2; i++)
+            for(j=0; j<dim3; j++)
+                array2d_static_rand2[i*dim3 + j] = array2d_dynamic2[i][j] = rand()/RAND_MAX;
+
+        cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, dim1, dim3, dim2, 1.0f,
+                    FLATTEN2D(array2d_dynamic), (int)pitch,
+                    FLATTEN2D(array2d_dynamic2), dim3, 0.0f,
+                    FLATTEN2D(array2d_dynamic3), (int)pitch2);
+        cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, dim1, dim3, dim2, 1.0f,
+                    array2d_static_rand, dim2,
+                    array2d_static_rand2, dim3, 0.0f,
+                    array2d_static_rand3, dim3);
+        for(i=0; i<dim1; i++)
+            for(j=0; j<dim3; j++)
+                error += fabs(array2d_dynamic3[i][j]-array2d_static_rand3[i*dim3 + j]);
+        assert(error <= 2.23e-8f);
+        free(array2d_dynamic);
+        free(array2d_dynamic2);
+        free(array2d_dynamic3);
+    }
+    difference = clock() - before;
+    msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
 #endif
  
     
@@ -283,66 +473,1018 @@ int main(int argc, const char * argv[])
 
     
     /*********************************************************************************************************/
-    printf("********** Malloc Speed Test - 3D DATA **********\n");
+    printf("********** Malloc Contiguity Test - RANDOM 8D DATA **********\n");
+    error = 0.0f;
     before = clock();
-    dim1 = MAX_DIMENSION_LENGTH-10;
-    dim2 = MAX_DIMENSION_LENGTH;
-    dim3 = MAX_DIMENSION_LENGTH-5;
-    for(iter=0; iter<100; iter++){
-        mangled_array3d_dynamic = malloc(dim1* dim2* dim3 * sizeof(test_data_type));
-        /* populate array */
+    for(iter=0; iter<200; iter++){
+        for(i=0; i<8; i++)
+            dims8d[i] = 1+rand()%5;
+        array8d_dynamic = iter%2 ? (test_data_type********)mallocNd(8, dims8d, sizeof(test_data_type)) :
+                                   (test_data_type********)callocNd(8, dims8d, sizeof(test_data_type));
+        n = 0;
+        for(i=0; i<(int)dims8d[0]; i++)
+            for(j=0; j<(int)dims8d[1]; j++)
+                for(k=0; k<(int)dims8d[2]; k++)
+                    for(l=0; l<(int)dims8d[3]; l++)
+                        for(p=0; p<(int)dims8d[4]; p++)
+                            for(q=0; q<(int)dims8d[5]; q++)
+                                for(r=0; r<(int)dims8d[6]; r++)
+                                    for(s=0; s<(int)dims8d[7]; s++)
+                                        array8d_dynamic[i][j][k][l][p][q][r][s] = (test_data_type)(n++);
+        /* only passes this test if "array8d_dynamic" is truely contiguous */
+        assert(FLATTEN8D(array8d_dynamic) == flattenNd(array8d_dynamic, 8));
+        for(i=0; i<(int)n; i++)
+            error += fabs(FLATTEN8D(array8d_dynamic)[i] - (test_data_type)i);
+        assert(error <= 2.23e-8f);
+        dims8d[0] = 1+rand()%5;
+        array8d_dynamic = (test_data_type********)reallocNd(array8d_dynamic, 8, dims8d, sizeof(test_data_type));
+        assert(array8d_dynamic[dims8d[0]-1][0][0][0][0][0][0] == FLATTEN8D(array8d_dynamic) + (dims8d[0]-1)*dims8d[1]*dims8d[2]*dims8d[3]*dims8d[4]*dims8d[5]*dims8d[6]*dims8d[7]);
+        free(array8d_dynamic);
+    }
+    difference = clock() - before;
+    msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
+
+    /*********************************************************************************************************/
+    printf("********** Pointer Table Test - LARGE 4D/6D DATA **********\n");
+    before = clock();
+    for(iter=0; iter<10; iter++){
+        /* third level table holds 262144 pointers */
+        dim1 = 64-iter; dim2 = 64; dim3 = 64; dim4 = 16+iter;
+        array4d_dynamic = iter%2 ? (test_data_type****)malloc4d(dim1, dim2, dim3, dim4, sizeof(test_data_type)) :
+                                   (test_data_type****)realloc4d((void****)NULL, dim1, dim2, dim3, dim4, sizeof(test_data_type));
+        for(i=0; i<dim1; i++){
+            assert(array4d_dynamic[i] == (test_data_type***)(array4d_dynamic + dim1) + i*dim2);
+            for(j=0; j<dim2; j++){
+                assert(array4d_dynamic[i][j] == (test_data_type**)(array4d_dynamic + dim1 + dim1*dim2) + (i*dim2 + j)*dim3);
+                for(k=0; k<dim3; k++)
+                    assert(array4d_dynamic[i][j][k] == FLATTEN4D(array4d_dynamic) + ((i*dim2 + j)*dim3 + k)*dim4);
+            }
+        }
+        free(array4d_dynamic);
+    }
+    array6d_dynamic = (test_data_type******)malloc6d(8, 8, 8, 8, 8, 3, sizeof(test_data_type));
+    for(i=0; i<8*8*8*8*8; i++)
+        assert(((test_data_type**)(array6d_dynamic + 8 + 8*8 + 8*8*8 + 8*8*8*8))[i] == FLATTEN6D(array6d_dynamic) + i*3);
+    free(array6d_dynamic);
+    difference = clock() - before;
+    msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
+
+    /*********************************************************************************************************/
+    printf("********** Strided View Test - RANDOM 6D DATA **********\n");
+    error = 0.0f;
+    before = clock();
+    for(iter=0; iter<200; iter++){
+        for(i=0; i<6; i++)
+            dims8d[i] = 1+rand()%6;
+        array6d_dynamic = (test_data_type******)malloc6d(dims8d[0], dims8d[1], dims8d[2], dims8d[3], dims8d[4], dims8d[5], sizeof(test_data_type));
+        md_view_wrap(&view, FLATTEN6D(array6d_dynamic), 6, dims8d, sizeof(test_data_type));
+        md_view_calloc(&view2, 6, dims8d, sizeof(test_data_type));
+        assert(md_view_numel(&view2) == dims8d[0]*dims8d[1]*dims8d[2]*dims8d[3]*dims8d[4]*dims8d[5]);
+        for(i=0; i<(int)dims8d[0]; i++)
+            for(j=0; j<(int)dims8d[1]; j++)
+                for(k=0; k<(int)dims8d[2]; k++)
+                    for(l=0; l<(int)dims8d[3]; l++)
+                        for(p=0; p<(int)dims8d[4]; p++)
+                            for(q=0; q<(int)dims8d[5]; q++){
+                                error += fabs(MD_VIEW_AT6D(test_data_type, &view2, i, j, k, l, p, q)); /* should be zero'd */
+                                array6d_dynamic[i][j][k][l][p][q] = (test_data_type)rand();
+                                MD_VIEW_AT6D(test_data_type, &view2, i, j, k, l, p, q) = MD_VIEW_AT6D(test_data_type, &view, i, j, k, l, p, q);
+                                index6d[0] = i; index6d[1] = j; index6d[2] = k; index6d[3] = l; index6d[4] = p; index6d[5] = q;
+                                assert(md_view_offset(&view, index6d) == (size_t)(&array6d_dynamic[i][j][k][l][p][q] - FLATTEN6D(array6d_dynamic)));
+                            }
+        /* both should share the same contiguous data layout */
+        assert(memcmp(view2.data, FLATTEN6D(array6d_dynamic), md_view_numel(&view)*sizeof(test_data_type)) == 0);
+        assert(error <= 2.23e-8f);
+        md_view_free(&view2);
+        free(array6d_dynamic);
+    }
+    difference = clock() - before;
+    msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
+
+    /*********************************************************************************************************/
+    printf("********** Allocation Stats Test - RANDOM 3D DATA **********\n");
+    before = clock();
+    md_stats_reset();
+    md_stats_snapshot(&stats);
+    for(iter=0; iter<1000; iter++){
+        dim1 = 1+rand()%MAX_DIMENSION_LENGTH;
+        dim2 = 1+rand()%MAX_DIMENSION_LENGTH;
+        dim3 = 1+rand()%20;
+        dims8d[0] = dim1; dims8d[1] = dim2; dims8d[2] = dim3;
+        n = md_sizeof(3, dims8d, sizeof(test_data_type), &overhead);
+        assert(overhead == (dim1 + dim1*dim2)*sizeof(void*));
+        assert(n == overhead + dim1*dim2*dim3*sizeof(test_data_type));
+        array3d_dynamic = (test_data_type***)malloc3d(dim1, dim2, dim3, sizeof(test_data_type));
+        array3d_dynamic = (test_data_type***)realloc3d((void***)array3d_dynamic, dim1, dim2, dim3, sizeof(test_data_type));
+        free1d(array3d_dynamic);
+        array3d_dynamic = (test_data_type***)calloc3d(dim1, dim2, dim3, sizeof(test_data_type));
+        free1d(array3d_dynamic);
+        n = 2*n + md_sizeof(3, dims8d, sizeof(test_data_type), NULL);
+        stats.bytes_requested += n;
+        stats.table_bytes += 3*overhead;
+        if(n/3 >= MD_MALLOC_STATS_LARGE_BYTES)
+            stats.large_calls[MD_STATS_MALLOC][2]++;
+    }
+    md_stats_snapshot(&stats2);
+#ifdef MD_MALLOC_ENABLE_STATS
+    assert(stats2.calls[MD_STATS_MALLOC][2] == (size_t)iter && stats2.calls[MD_STATS_CALLOC][2] == (size_t)iter);
+    assert(stats2.calls[MD_STATS_REALLOC][2] == (size_t)iter && stats2.calls[MD_STATS_MALLOC][0] == 0);
+    assert(stats2.large_calls[MD_STATS_MALLOC][2] == stats.large_calls[MD_STATS_MALLOC][2]);
+    assert(stats2.bytes_requested == stats.bytes_requested);
+    assert(stats2.table_bytes == stats.table_bytes);
+    assert(stats2.frees == 2*(size_t)iter);
+    assert(stats2.live_bytes == stats.live_bytes); /* all freed again */
+    assert(stats2.peak_live_bytes >= stats2.live_bytes);
+#if defined(__linux__) || defined(__APPLE__) || defined(_WIN32)
+    assert(stats2.peak_live_bytes > stats.live_bytes);
+#endif
+#endif
+    difference = clock() - before;
+    msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
+
+    /*********************************************************************************************************/
+    printf("********** Arena Test - RANDOM 2D/3D/4D DATA **********\n");
+    before = clock();
+    block = md_arena_create(&arena, 1<<23, 64);
+    assert(block != NULL);
+    assert(((size_t)arena.base % 64) == 0);
+    md_stats_snapshot(&stats);
+    for(iter=0; iter<1000; iter++){
+        md_arena_reset(&arena);
+        dim1 = 1+rand()%MAX_DIMENSION_LENGTH;
+        dim2 = 1+rand()%MAX_DIMENSION_LENGTH;
+        array2d_dynamic = (test_data_type**)calloc2d_arena(&arena, dim1, dim2, sizeof(test_data_type));
+        assert(array2d_dynamic != NULL && ((size_t)FLATTEN2D(array2d_dynamic) % 64) == 0);
+        for(i=0; i<dim1; i++)
+            for(j=0; j<dim2; j++){
+                assert(array2d_dynamic[i][j] == 0.0f);
+                array2d_dynamic[i][j] = (test_data_type)(i*dim2+j);
+            }
+        /* nested scope, rewound afterwards */
+        mark = md_arena_mark(&arena);
+        dim3 = 1+rand()%8;
+        array3d_dynamic = (test_data_type***)malloc3d_arena(&arena, dim1, dim2, dim3, sizeof(test_data_type));
+        assert(array3d_dynamic != NULL && ((size_t)FLATTEN3D(array3d_dynamic) % 64) == 0);
         for(i=0; i<dim1; i++)
             for(j=0; j<dim2; j++)
                 for(k=0; k<dim3; k++)
-                    mangled_array3d_dynamic[i*dim2*dim3 +j*dim3 +k] = rand();
-        free(mangled_array3d_dynamic);
+                    assert(&array3d_dynamic[i][j][k] == FLATTEN3D(array3d_dynamic) + (i*dim2+j)*dim3 + k);
+        memset(FLATTEN3D(array3d_dynamic), 0xff, dim1*dim2*dim3*sizeof(test_data_type));
+        md_arena_rewind(&arena, mark);
+        assert(md_arena_mark(&arena) == mark);
+        /* the 2-D array is unaffected */
+        for(i=0; i<dim1; i++)
+            for(j=0; j<dim2; j++)
+                assert(array2d_dynamic[i][j] == (test_data_type)(i*dim2+j));
     }
+    /* requests which do not fit fail cleanly, without changing the arena */
+    array4d_dynamic = (test_data_type****)malloc4d_arena(&arena, MAX_DIMENSION_LENGTH, MAX_DIMENSION_LENGTH, 8, 8, sizeof(test_data_type));
+    assert(array4d_dynamic == NULL);
+    assert(md_arena_mark(&arena) == mark);
+    md_stats_snapshot(&stats2);
+    assert(stats2.bytes_requested == stats.bytes_requested); /* no system allocator calls */
+    md_arena_destroy(&arena);
     difference = clock() - before;
     msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
-    printf(" - Mangled array time taken %d seconds %d milliseconds\n", msec/1000, msec%1000);
-    
+    printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
+
+    /*********************************************************************************************************/
+    printf("********** Batch Malloc Test - RANDOM 1D/2D/3D/4D DATA **********\n");
     before = clock();
+    for(iter=0; iter<1000; iter++){
+        for(i=0; i<4; i++){
+            descs[i].ndims = (size_t)i+1;
+            descs[i].dims = batch_dims[i];
+            descs[i].data_size = sizeof(test_data_type);
+            descs[i].alignment = iter%2 ? (size_t)8<<(i+rand()%3) : 0; /* (some over-aligned) */
+            for(j=0; j<=i; j++)
+                batch_dims[i][j] = (size_t)(1+rand()%(i<2 ? MAX_DIMENSION_LENGTH : 20));
+        }
+        block = iter%3==0 ? md_calloc_batch(4, descs, batch) : md_malloc_batch(4, descs, batch);
+        assert(block != NULL);
+        /* the tables come first, then the data blocks, in order and without overlapping */
+        assert((unsigned char*)batch[1] < (unsigned char*)batch[2] && (unsigned char*)batch[2] < (unsigned char*)batch[3]);
+        assert((unsigned char*)batch[3] < (unsigned char*)batch[0]);
+        array2d_dynamic = (test_data_type**)batch[1];
+        array3d_dynamic = (test_data_type***)batch[2];
+        array4d_dynamic = (test_data_type****)batch[3];
+        assert((test_data_type*)batch[0] + batch_dims[0][0] <= FLATTEN2D(array2d_dynamic));
+        assert(&array2d_dynamic[batch_dims[1][0]-1][batch_dims[1][1]] <= FLATTEN3D(array3d_dynamic));
+        assert(&array3d_dynamic[batch_dims[2][0]-1][batch_dims[2][1]-1][batch_dims[2][2]] <= FLATTEN4D(array4d_dynamic));
+        assert((unsigned char*)&array4d_dynamic[batch_dims[3][0]-1][batch_dims[3][1]-1][batch_dims[3][2]-1][batch_dims[3][3]] <= (unsigned char*)block + md_sizeof_batch(4, descs));
+        assert(descs[0].alignment == 0 || (size_t)batch[0] % descs[0].alignment == 0);
+        assert(descs[1].alignment == 0 || (size_t)FLATTEN2D(array2d_dynamic) % descs[1].alignment == 0);
+        assert(descs[2].alignment == 0 || (size_t)FLATTEN3D(array3d_dynamic) % descs[2].alignment == 0);
+        assert(descs[3].alignment == 0 || (size_t)FLATTEN4D(array4d_dynamic) % descs[3].alignment == 0);
+        for(i=0; i<(int)batch_dims[1][0]; i++)
+            for(j=0; j<(int)batch_dims[1][1]; j++){
+                assert(iter%3!=0 || array2d_dynamic[i][j] == 0.0f);
+                assert(&array2d_dynamic[i][j] == FLATTEN2D(array2d_dynamic) + i*batch_dims[1][1] + j);
+            }
+        for(i=0; i<(int)batch_dims[2][0]; i++)
+            for(j=0; j<(int)batch_dims[2][1]; j++)
+                for(k=0; k<(int)batch_dims[2][2]; k++)
+                    assert(&array3d_dynamic[i][j][k] == FLATTEN3D(array3d_dynamic) + (i*batch_dims[2][1]+j)*batch_dims[2][2] + k);
+        for(i=0; i<(int)batch_dims[3][0]; i++)
+            for(j=0; j<(int)batch_dims[3][1]; j++)
+                for(k=0; k<(int)batch_dims[3][2]; k++)
+                    for(l=0; l<(int)batch_dims[3][3]; l++){
+                        assert(iter%3!=0 || array4d_dynamic[i][j][k][l] == 0.0f);
+                        assert(&array4d_dynamic[i][j][k][l] == FLATTEN4D(array4d_dynamic) + ((i*batch_dims[3][1]+j)*batch_dims[3][2]+k)*batch_dims[3][3] + l);
+                    }
+        md_free(block); /* all four at once */
+    }
+    /* invalid descriptors */
+    descs[1].alignment = 24;
+    block = md_malloc_batch(4, descs, batch);
+    assert(block == NULL && md_sizeof_batch(4, descs) == 0);
+    difference = clock() - before;
+    msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
+
+    /*********************************************************************************************************/
+    printf("********** Transpose/Permute Test - RANDOM 2D..6D DATA **********\n");
+    before = clock();
+    /* 2-D, against plain indexing (sizes which are and are not multiples of the SIMD/tile sizes) */
     for(iter=0; iter<100; iter++){
+        dim1 = 1+rand()%(iter%2 ? 8 : MAX_DIMENSION_LENGTH);
+        dim2 = 1+rand()%(iter%2 ? 8 : MAX_DIMENSION_LENGTH);
+        array2d_dynamic = (test_data_type**)malloc2d(dim1, dim2, sizeof(test_data_type));
+        for(i=0; i<dim1; i++)
+            for(j=0; j<dim2; j++)
+                array2d_dynamic[i][j] = (test_data_type)(i*dim2+j);
+        array2d_dynamic2 = (test_data_type**)md_transpose2d(NULL, (void**)array2d_dynamic, dim1, dim2, sizeof(test_data_type));
+        for(i=0; i<dim1; i++)
+            for(j=0; j<dim2; j++)
+                assert(array2d_dynamic2[j][i] == array2d_dynamic[i][j]);
+        for(i=0; i<dim2; i++)
+            for(j=0; j<dim1; j++)
+                assert(&array2d_dynamic2[i][j] == FLATTEN2D(array2d_dynamic2) + i*dim1 + j);
+        free(array2d_dynamic);
+        free(array2d_dynamic2);
+    }
+    /* 2-D..6-D, with random permutations and element sizes, into a preallocated destination */
+    for(iter=0; iter<2000; iter++){
+        n = 2+iter%5;
+        data_size = (size_t)1<<(rand()%5); /* 1, 2, 4, 8 or 16 bytes */
+        for(l=0; l<(int)n; l++){
+            pdims[l] = (size_t)(1+rand()%(n<4 ? 40 : 7));
+            perm[l] = (size_t)l;
+        }
+        for(l=(int)n-1; l>0; l--){ /* (Fisher-Yates shuffle) */
+            k = rand()%(l+1);
+            pidx[0] = perm[l]; perm[l] = perm[k]; perm[k] = pidx[0];
+        }
+        for(l=0; l<(int)n; l++)
+            dims8d[l] = pdims[perm[l]];
+        block = (test_data_type**)mallocNd(n, pdims, data_size);
+        permuted = mallocNd(n, dims8d, data_size);
+        src_bytes = (unsigned char*)flattenNd(block, n);
+        dst_bytes = (unsigned char*)flattenNd(permuted, n);
+        overhead = data_size;
+        for(l=0; l<(int)n; l++)
+            overhead *= pdims[l];
+        for(i=0; i<(int)overhead; i++)
+            src_bytes[i] = (unsigned char)rand();
+        switch(n){
+            case 2: result = md_permuteNd(permuted, block, 2, pdims, perm, data_size); break;
+            case 3: result = md_permute3d((void***)permuted, (void***)block, pdims[0], pdims[1], pdims[2], perm, data_size); break;
+            case 4: result = md_permute4d((void****)permuted, (void****)block, pdims[0], pdims[1], pdims[2], pdims[3], perm, data_size); break;
+            case 5: result = md_permute5d((void*****)permuted, (void*****)block, pdims[0], pdims[1], pdims[2], pdims[3], pdims[4], perm, data_size); break;
+            case 6: result = md_permute6d((void******)permuted, (void******)block, pdims[0], pdims[1], pdims[2], pdims[3], pdims[4], pdims[5], perm, data_size); break;
+            default: result = NULL; break;
+        }
+        assert(result == permuted);
+        /* every element of "dst", at index (i_0..i_n-1), is src[.., i_l at axis perm[l], ..] */
+        for(i=0; i<(int)(overhead/data_size); i++){
+            size_t rem = (size_t)i, soff = 0;
+            for(l=(int)n-1; l>=0; l--){
+                pidx[perm[l]] = rem%dims8d[l];
+                rem /= dims8d[l];
+            }
+            for(l=0; l<(int)n; l++)
+                soff = soff*pdims[l] + pidx[l];
+            assert(memcmp(dst_bytes + (size_t)i*data_size, src_bytes + soff*data_size, data_size) == 0);
+        }
+        md_free(block);
+        md_free(permuted);
+    }
+    /* invalid permutations */
+    perm[0] = 0; perm[1] = 0; perm[2] = 1;
+    array3d_dynamic = (test_data_type***)malloc3d(2, 2, 2, sizeof(test_data_type));
+    result = md_permute3d(NULL, (void***)array3d_dynamic, 2, 2, 2, perm, sizeof(test_data_type));
+    assert(result == NULL);
+    free(array3d_dynamic);
+    difference = clock() - before;
+    msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
+
+    /*********************************************************************************************************/
+    printf("********** Slice Test - RANDOM 2D/3D/4D DATA **********\n");
+    before = clock();
+    for(iter=0; iter<1000; iter++){
+        dim1 = 1+rand()%20;
+        dim2 = 1+rand()%20;
+        dim3 = 1+rand()%20;
         array3d_dynamic = (test_data_type***)malloc3d(dim1, dim2, dim3, sizeof(test_data_type));
-        /* populate array */
         for(i=0; i<dim1; i++)
             for(j=0; j<dim2; j++)
                 for(k=0; k<dim3; k++)
-                    array3d_dynamic[i][j][k] = rand();
+                    array3d_dynamic[i][j][k] = (test_data_type)((i*dim2+j)*dim3+k);
+        /* fixed index on the first or second axis */
+        l = rand()%2;
+        p = rand()%(l==0 ? dim1 : dim2);
+        array2d_dynamic = (test_data_type**)md_slice3d((void***)array3d_dynamic, dim1, dim2, dim3, l, p, sizeof(test_data_type));
+        for(i=0; i<(l==0 ? dim2 : dim1); i++)
+            for(j=0; j<dim3; j++)
+                assert(&array2d_dynamic[i][j] == (l==0 ? &array3d_dynamic[p][i][j] : &array3d_dynamic[i][p][j])); /* no copies */
+        free(array2d_dynamic);
+        /* strided sub-block (every "q"th index of the first two axes, and a range of the last) */
+        q = 1+rand()%3;
+        ranges[0].start = rand()%dim1; ranges[0].step = q; ranges[0].count = 1+(dim1-1-ranges[0].start)/q;
+        ranges[1].start = rand()%dim2; ranges[1].step = q; ranges[1].count = 1+(dim2-1-ranges[1].start)/q;
+        ranges[2].start = rand()%dim3; ranges[2].step = 1; ranges[2].count = dim3-ranges[2].start;
+        dims8d[0] = dim1; dims8d[1] = dim2; dims8d[2] = dim3;
+        sub3d = (test_data_type***)md_slice((void*)array3d_dynamic, 3, dims8d, ranges, sizeof(test_data_type));
+        assert(sub3d != NULL);
+        for(i=0; i<(int)ranges[0].count; i++)
+            for(j=0; j<(int)ranges[1].count; j++)
+                for(k=0; k<(int)ranges[2].count; k++)
+                    assert(&sub3d[i][j][k] == &array3d_dynamic[ranges[0].start+i*q][ranges[1].start+j*q][ranges[2].start+k]);
+        /* a slice of a slice */
+        array2d_dynamic = (test_data_type**)md_subarray2d((void**)sub3d[0], ranges[1].count, ranges[2].count, ranges[1].count-1, 0, 1, ranges[2].count, sizeof(test_data_type));
+        for(k=0; k<(int)ranges[2].count; k++)
+            assert(&array2d_dynamic[0][k] == &sub3d[0][ranges[1].count-1][k]);
+        free(array2d_dynamic);
+        free(sub3d);
+        /* and as an md_view, with any axis fixed or strided */
+        md_view_wrap(&view, FLATTEN3D(array3d_dynamic), 3, dims8d, sizeof(test_data_type));
+        ranges[0].step = 0; ranges[2].step = q; ranges[2].count = 1+(dim3-1-ranges[2].start)/q;
+        md_view_slice(&view2, &view, ranges);
+        assert(view2.ndims == 2);
+        for(j=0; j<(int)ranges[1].count; j++)
+            for(k=0; k<(int)ranges[2].count; k++)
+                assert(&MD_VIEW_AT2D(test_data_type, &view2, j, k) == &array3d_dynamic[ranges[0].start][ranges[1].start+j*q][ranges[2].start+k*q]);
+        /* pointer-table slices must keep the last axis contiguous */
+        if(iter==0){
+            ranges[2].step = 2;
+            ranges[2].count = 1;
+            result = md_slice((void*)array3d_dynamic, 3, dims8d, ranges, sizeof(test_data_type));
+            assert(result == NULL);
+        }
         free(array3d_dynamic);
     }
+    /* 4-D sub-array (out of bounds requests fail) */
+    array4d_dynamic = (test_data_type****)calloc4d(5, 6, 7, 8, sizeof(test_data_type));
+    for(l=0; l<4; l++){
+        ranges[l].start = (size_t)l;
+        ranges[l].count = 2;
+        ranges[l].step = 1;
+        dims8d[l] = (size_t)(5+l);
+    }
+    sub4d = (test_data_type****)md_slice((void*)array4d_dynamic, 4, dims8d, ranges, sizeof(test_data_type));
+    sub4d[1][1][1][1] = 1.0f;
+    assert(array4d_dynamic[1][2][3][4] == 1.0f);
+    free(sub4d);
+    ranges[3].count = 6;
+    result = md_slice((void*)array4d_dynamic, 4, dims8d, ranges, sizeof(test_data_type));
+    assert(result == NULL);
+    free(array4d_dynamic);
     difference = clock() - before;
-    msec2 = difference * 1000.0f / (float)CLOCKS_PER_SEC;
-    printf(" - md_malloc time taken %d seconds %d milliseconds\n", msec2/1000, msec2%1000);
-    
-#ifdef ENABLE_C99_SPEED_TESTS
-    /* run same test using C99 dynamic arrays */
+    msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
+
+    /*********************************************************************************************************/
+    printf("********** Split Complex Test - RANDOM 1D/3D DATA **********\n");
+    before = clock();
+    for(iter=0; iter<1000; iter++){
+        dim1 = 1+rand()%20;
+        dim2 = 1+rand()%20;
+        dim3 = 1+rand()%20;
+        n = (size_t)(dim1*dim2*dim3);
+        if(iter%2==0)
+            split_re = (test_data_type***)malloc3d_split_complex(dim1, dim2, dim3, sizeof(test_data_type), (void****)&split_im);
+        else{
+            split_re = (test_data_type***)calloc3d_split_complex(dim1, dim2, dim3, sizeof(test_data_type), (void****)&split_im);
+            for(k=0; k<(int)n; k++)
+                assert(FLATTEN3D(split_re)[k] == 0.0f && FLATTEN3D(split_im)[k] == 0.0f);
+        }
+        assert(split_re != NULL && split_im != NULL);
+        assert((size_t)FLATTEN3D(split_re) % MD_SPLIT_COMPLEX_ALIGNMENT == 0);
+        assert((size_t)FLATTEN3D(split_im) % MD_SPLIT_COMPLEX_ALIGNMENT == 0);
+        assert(FLATTEN3D(split_im) >= FLATTEN3D(split_re) + n); /* separate planes */
+        /* interleaved -> planes -> interleaved */
+        cplx = (test_data_type*)malloc1d(2*n*sizeof(test_data_type));
+        for(k=0; k<(int)n; k++){
+            cplx[2*k] = (test_data_type)k;
+            cplx[2*k+1] = -(test_data_type)k;
+        }
+        md_deinterleave_complex(FLATTEN3D(split_re), FLATTEN3D(split_im), cplx, n, sizeof(test_data_type));
+        for(i=0; i<dim1; i++)
+            for(j=0; j<dim2; j++)
+                for(k=0; k<dim3; k++){
+                    assert(split_re[i][j][k] == (test_data_type)((i*dim2+j)*dim3+k));
+                    assert(split_im[i][j][k] == -(test_data_type)((i*dim2+j)*dim3+k));
+                }
+        memset(cplx, 0, 2*n*sizeof(test_data_type));
+        md_interleave_complex(cplx, FLATTEN3D(split_re), FLATTEN3D(split_im), n, sizeof(test_data_type));
+        for(k=0; k<(int)n; k++)
+            assert(cplx[2*k] == (test_data_type)k && cplx[2*k+1] == -(test_data_type)k);
+        free(cplx);
+        md_free(split_re);
+
+        /* double parts, in 1-D */
+        n = (size_t)(1+rand()%100);
+        planes_d = (double*)mallocNd_split_complex(1, &n, sizeof(double), (void**)&cplx_d);
+        assert(planes_d != NULL && cplx_d >= planes_d + n);
+        cplx = (test_data_type*)malloc1d(2*n*sizeof(double));
+        for(k=0; k<(int)(2*n); k++)
+            ((double*)cplx)[k] = (double)rand();
+        md_deinterleave_complex(planes_d, cplx_d, cplx, n, sizeof(double));
+        for(k=0; k<(int)n; k++)
+            assert(planes_d[k] == ((double*)cplx)[2*k] && cplx_d[k] == ((double*)cplx)[2*k+1]);
+        md_interleave_complex(cplx, cplx_d, planes_d, n, sizeof(double)); /* (swapped) */
+        for(k=0; k<(int)n; k++)
+            assert(((double*)cplx)[2*k] == cplx_d[k] && ((double*)cplx)[2*k+1] == planes_d[k]);
+        free(cplx);
+        free(planes_d);
+    }
+    difference = clock() - before;
+    msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
+
+    /*********************************************************************************************************/
+    printf("********** Bulk Operations Test - RANDOM 1D/3D DATA **********\n");
+    before = clock();
+    alpha_f[0] = 3.0f; alpha_f[1] = -2.0f;
+    alpha_d[0] = 3.0;  alpha_d[1] = -2.0;
+    for(iter=0; iter<400; iter++){
+        bulk_type = iter%4;
+        bulk_es = bulk_type==MD_FLOAT || bulk_type==MD_FLOAT_COMPLEX ? sizeof(float) : sizeof(double);
+        q = bulk_type==MD_FLOAT_COMPLEX || bulk_type==MD_DOUBLE_COMPLEX ? 2 : 1;
+        dims8d[0] = dim1 = 1+rand()%20;
+        dims8d[1] = dim2 = 1+rand()%20;
+        dims8d[2] = dim3 = 1+rand()%20;
+        if(iter>=396){ /* the last of each type is above MD_MALLOC_OPENMP_COPY_THRESHOLD (threaded chunks) */
+            dims8d[0] = dim1 = 64;
+            dims8d[1] = dim2 = 64;
+            dims8d[2] = dim3 = 65+rand()%20;
+        }
+        n = (size_t)(dim1*dim2*dim3*q); /* reals */
+        assert(iter<396 || n*bulk_es >= MD_MALLOC_OPENMP_COPY_THRESHOLD);
+        md_stream_set_threshold(iter%8<4 ? 1 : 0); /* half with streaming stores */
+        bulk_x = malloc3d(dim1, dim2, dim3, q*bulk_es);
+        bulk_y = malloc3d(dim1, dim2, dim3, q*bulk_es);
+        bulk_z = malloc3d(dim1, dim2, dim3, q*bulk_es);
+        bulk_ref = (double*)malloc1d(n*sizeof(double));
+        for(k=0; k<(int)n; k++){
+            BULK_SET(bulk_x, k, (double)(rand()%17-8));
+            BULK_SET(bulk_z, k, (double)(rand()%17-8));
+        }
+        /* y = alpha */
+        md_set((void*)bulk_y, 3, dims8d, bulk_type, bulk_es==sizeof(float) ? (void*)alpha_f : (void*)alpha_d);
+        for(k=0; k<(int)n; k++)
+            assert(BULK_AT(bulk_y, k) == (q==2 && k%2==1 ? -2.0 : 3.0));
+        /* y = x */
+        md_copy((void*)bulk_y, (void*)bulk_x, 3, dims8d, bulk_type);
+        for(k=0; k<(int)n; k++)
+            assert(BULK_AT(bulk_y, k) == BULK_AT(bulk_x, k));
+        /* y = alpha*y */
+        md_scale((void*)bulk_y, 3, dims8d, bulk_type, bulk_es==sizeof(float) ? (void*)alpha_f : (void*)alpha_d);
+        for(k=0; k<(int)n; k+=q){
+            bulk_ref[k] = q==1 ? 3.0*BULK_AT(bulk_x, k) : 3.0*BULK_AT(bulk_x, k) + 2.0*BULK_AT(bulk_x, k+1);
+            if(q==2)
+                bulk_ref[k+1] = -2.0*BULK_AT(bulk_x, k) + 3.0*BULK_AT(bulk_x, k+1);
+        }
+        for(k=0; k<(int)n; k++)
+            assert(BULK_AT(bulk_y, k) == bulk_ref[k]);
+        /* y = y + alpha*z */
+        md_axpy((void*)bulk_y, (void*)bulk_z, 3, dims8d, bulk_type, bulk_es==sizeof(float) ? (void*)alpha_f : (void*)alpha_d);
+        for(k=0; k<(int)n; k+=q){
+            bulk_ref[k] += q==1 ? 3.0*BULK_AT(bulk_z, k) : 3.0*BULK_AT(bulk_z, k) + 2.0*BULK_AT(bulk_z, k+1);
+            if(q==2)
+                bulk_ref[k+1] += -2.0*BULK_AT(bulk_z, k) + 3.0*BULK_AT(bulk_z, k+1);
+        }
+        for(k=0; k<(int)n; k++)
+            assert(BULK_AT(bulk_y, k) == bulk_ref[k]);
+        /* y = x*z, then in place: x = x*z */
+        md_mul((void*)bulk_y, (void*)bulk_x, (void*)bulk_z, 3, dims8d, bulk_type);
+        for(k=0; k<(int)n; k+=q){
+            if(q==1)
+                bulk_ref[k] = BULK_AT(bulk_x, k)*BULK_AT(bulk_z, k);
+            else{
+                bulk_ref[k]   = BULK_AT(bulk_x, k)*BULK_AT(bulk_z, k) - BULK_AT(bulk_x, k+1)*BULK_AT(bulk_z, k+1);
+                bulk_ref[k+1] = BULK_AT(bulk_x, k)*BULK_AT(bulk_z, k+1) + BULK_AT(bulk_x, k+1)*BULK_AT(bulk_z, k);
+            }
+        }
+        for(k=0; k<(int)n; k++)
+            assert(BULK_AT(bulk_y, k) == bulk_ref[k]);
+        md_mul((void*)bulk_x, (void*)bulk_x, (void*)bulk_z, 3, dims8d, bulk_type);
+        for(k=0; k<(int)n; k++)
+            assert(BULK_AT(bulk_x, k) == bulk_ref[k]);
+        /* flat, and not vector-aligned */
+        if(n>=2*(size_t)q){
+            dims8d[0] = n/(size_t)q-1;
+            md_copy((unsigned char*)FLATTEN3D(bulk_y) + (size_t)q*bulk_es, FLATTEN3D(bulk_z), 1, dims8d, bulk_type);
+            for(k=0; k<(int)(n-(size_t)q); k++)
+                assert(BULK_AT(bulk_y, k+q) == BULK_AT(bulk_z, k));
+        }
+        free(bulk_x);
+        free(bulk_y);
+        free(bulk_z);
+        free(bulk_ref);
+    }
+    md_stream_set_threshold(0);
+    difference = clock() - before;
+    msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
+
+    /*********************************************************************************************************/
+    printf("********** Clone Test - RANDOM 2D..6D DATA **********\n");
+    before = clock();
+    for(iter=0; iter<1000; iter++){
+        q = 2+rand()%5; /* ndims */
+        n = 1;
+        for(l=0; l<q; l++){
+            pdims[l] = (size_t)(1+rand()%(q<4 ? 40 : 8));
+            n *= pdims[l];
+        }
+        permuted = mallocNd((size_t)q, pdims, sizeof(test_data_type));
+        for(k=0; k<(int)n; k++)
+            ((test_data_type*)flattenNd(permuted, (size_t)q))[k] = (test_data_type)k;
+        clone = q==3 ? (void*)md_clone3d((void***)permuted, pdims[0], pdims[1], pdims[2], sizeof(test_data_type)) :
+                       md_cloneNd(permuted, (size_t)q, pdims, sizeof(test_data_type));
+        assert(clone != NULL);
+        /* every table pointer lands in the clone's own block */
+        clone_bytes = md_sizeof((size_t)q, pdims, sizeof(test_data_type), &overhead);
+        for(k=0; k<(int)(overhead/sizeof(void*)); k++)
+            assert((unsigned char*)((void**)clone)[k] >= (unsigned char*)clone &&
+                   (unsigned char*)((void**)clone)[k] < (unsigned char*)clone + clone_bytes);
+        /* and indexing through the tables gives the same elements */
+        for(r=0; r<10; r++){
+            walk = (unsigned char*)clone;
+            for(l=0; l<q; l++)
+                pidx[l] = (size_t)(rand()%(int)pdims[l]);
+            for(l=0, s=0; l<q; l++)
+                s = s*(int)pdims[l] + (int)pidx[l];
+            for(l=0; l<q-1; l++)
+                walk = (unsigned char*)((void**)walk)[pidx[l]];
+            assert(((test_data_type*)walk)[pidx[q-1]] == (test_data_type)s);
+        }
+        ((test_data_type*)flattenNd(clone, (size_t)q))[0] = -1.0f;
+        assert(((test_data_type*)flattenNd(permuted, (size_t)q))[0] == 0.0f);
+        /* copying back into the original (restores it), and into a raw block */
+        md_copy_into(permuted, clone, (size_t)q, pdims, sizeof(test_data_type));
+        assert(((test_data_type*)flattenNd(permuted, (size_t)q))[0] == -1.0f);
+        assert(flattenNd(permuted, (size_t)q) == (unsigned char*)permuted + overhead); /* (tables intact) */
+        recycled = malloc1d(clone_bytes);
+        result = md_copy_into(recycled, permuted, (size_t)q, pdims, sizeof(test_data_type));
+        assert(result == recycled);
+        for(k=0; k<(int)n; k++)
+            assert(((test_data_type*)flattenNd(recycled, (size_t)q))[k] == (k==0 ? -1.0f : (test_data_type)k));
+        free(recycled);
+        md_free(clone);
+        md_free(permuted);
+    }
+    /* arrays with other layouts are refused */
+    array3d_dynamic = (test_data_type***)malloc3d(4, 5, 6, sizeof(test_data_type));
+    array2d_dynamic = (test_data_type**)md_slice3d((void***)array3d_dynamic, 4, 5, 6, 0, 1, sizeof(test_data_type));
+    clone = md_clone2d((void**)array2d_dynamic, 5, 6, sizeof(test_data_type));
+    assert(clone == NULL);
+    free(array2d_dynamic);
+    free(array3d_dynamic);
+    /* (even pitched and aligned-row arrays, whose data happens to directly follow the tables) */
+    array2d_dynamic = (test_data_type**)malloc2d_pitched(4, 3, sizeof(test_data_type), 16, 0, &pitch);
+    assert(flattenNd((void*)array2d_dynamic, 2) == (void*)(array2d_dynamic + 4));
+    clone = md_clone2d((void**)array2d_dynamic, 4, 3, sizeof(test_data_type));
+    assert(clone == NULL);
+    free(array2d_dynamic);
+    array3d_dynamic = (test_data_type***)aligned_malloc3d(2, 4, 3, sizeof(test_data_type), sizeof(void*), 1);
+    assert(flattenNd((void*)array3d_dynamic, 3) == (void*)((void**)array3d_dynamic + 2 + 2*4));
+    clone = md_clone3d((void***)array3d_dynamic, 2, 4, 3, sizeof(test_data_type));
+    assert(clone == NULL);
+    free(array3d_dynamic);
+    difference = clock() - before;
+    msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
+
+    /*********************************************************************************************************/
+    printf("********** SPSC Ring Test - RANDOM 2D/3D FRAMES **********\n");
+    before = clock();
+    for(iter=0; iter<100; iter++){
+        dims8d[0] = dim1 = 1+rand()%8;
+        dims8d[1] = dim2 = 1+rand()%64;
+        dims8d[2] = dim3 = 1+rand()%4;
+        q = 1+rand()%8; /* frames */
+        result = md_ring_create(&ring, (size_t)q, 3, dims8d, sizeof(test_data_type));
+        assert(result != NULL);
+        assert(ring.stride % MD_RING_PAD == 0 && (size_t)ring.base % MD_RING_PAD == 0);
+        /* random interleaving of the two sides, from one thread */
+        p = s = 0; /* frames written, read */
+        for(r=0; r<1000; r++){
+            if(rand()%2){
+                array3d_dynamic = (test_data_type***)md_ring_acquire_write(&ring);
+                assert((array3d_dynamic == NULL) == (p-s == q));
+                if(array3d_dynamic != NULL){
+                    array3d_dynamic[dim1-1][dim2-1][dim3-1] = (test_data_type)p;
+                    md_ring_commit_write(&ring);
+                    p++;
+                }
+            }
+            else{
+                array3d_dynamic = (test_data_type***)md_ring_acquire_read(&ring);
+                assert((array3d_dynamic == NULL) == (p == s));
+                if(array3d_dynamic != NULL){
+                    assert(array3d_dynamic[dim1-1][dim2-1][dim3-1] == (test_data_type)s); /* in order */
+                    md_ring_release_read(&ring);
+                    s++;
+                }
+            }
+            assert(md_ring_count(&ring) == (size_t)(p-s));
+        }
+        md_ring_destroy(&ring);
+    }
+    /* a producer and a consumer thread */
+    dims8d[0] = 4; dims8d[1] = 256;
+    md_ring_create(&ring, 4, 2, dims8d, sizeof(test_data_type));
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(2) private(i, j, array2d_dynamic)
+#endif
+    {
+#ifdef _OPENMP
+        int producer = omp_get_thread_num()==0, both = omp_get_num_threads()==2;
+#else
+        int producer = 1, both = 0;
+#endif
+        for(i=0; both && i<500; i++){
+            if(producer){
+                while((array2d_dynamic = (test_data_type**)md_ring_acquire_write(&ring)) == NULL)
+                    ;
+                for(j=0; j<256; j++)
+                    array2d_dynamic[i%4][j] = (test_data_type)(i+j);
+                md_ring_commit_write(&ring);
+            }
+            else{
+                while((array2d_dynamic = (test_data_type**)md_ring_acquire_read(&ring)) == NULL)
+                    ;
+                for(j=0; j<256; j++)
+                    assert(array2d_dynamic[i%4][j] == (test_data_type)(i+j));
+                md_ring_release_read(&ring);
+            }
+        }
+    }
+    assert(md_ring_count(&ring) == 0);
+    md_ring_destroy(&ring);
+    difference = clock() - before;
+    msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
+
+    /*********************************************************************************************************/
+    printf("********** Growable Array Test - RANDOM 2D/3D APPENDS **********\n");
+    before = clock();
+    for(iter=0; iter<200; iter++){
+        q = 2+rand()%2; /* ndims */
+        dims8d[0] = 0;
+        dims8d[1] = dim2 = 1+rand()%16;
+        dims8d[2] = dim3 = q==3 ? 1+rand()%8 : 1;
+        n = (size_t)(dim2*dim3); /* elements per slab */
+        result = md_grow_create(&grow, (size_t)q, dims8d, (size_t)(rand()%4), sizeof(test_data_type));
+        assert(result != NULL);
+        assert(grow.dims[0] == 0 && grow.capacity >= 1);
+        p = 0; /* slabs appended */
+        for(r=0; r<50; r++){
+            s = rand()%4;
+            for(i=0; i<s*(int)n; i++)
+                array3d_static[i] = (test_data_type)(p*(int)n + i);
+            block = grow.array;
+            mark = grow.capacity;
+            result = md_grow_append(&grow, array3d_static, (size_t)s);
+            assert(result == grow.array);
+            p += s;
+            assert(grow.dims[0] == (size_t)p && grow.capacity >= (size_t)p);
+            /* the array only moves once its capacity is exceeded, which then (at least) doubles */
+            assert(grow.capacity == mark ? grow.array == block : grow.capacity >= 2*mark);
+        }
+        for(l=0; l<3; l++){
+            if(l==1){
+                result = md_grow_shrink_to_fit(&grow);
+                assert(result != NULL);
+                assert(grow.capacity == (size_t)(p>0 ? p : 1));
+            }
+            else if(l==2){
+                result = md_grow_reserve(&grow, (size_t)p+10);
+                assert(result != NULL);
+                assert(grow.capacity == (size_t)p+10 && grow.dims[0] == (size_t)p);
+            }
+            /* same indexing (and layout) as a malloc2d()/malloc3d() array */
+            dims8d[0] = grow.capacity;
+            md_sizeof((size_t)q, dims8d, sizeof(test_data_type), &overhead);
+            assert(flattenNd(grow.array, (size_t)q) == (unsigned char*)grow.array + overhead);
+            for(i=0; i<p; i++)
+                for(j=0; j<dim2; j++)
+                    for(k=0; k<dim3; k++)
+                        assert((q==2 ? ((test_data_type**)grow.array)[i][j] :
+                                ((test_data_type***)grow.array)[i][j][k]) == (test_data_type)((i*dim2 + j)*dim3 + k));
+        }
+        /* shrinking the count keeps the capacity */
+        block = grow.array;
+        result = md_grow_resize(&grow, (size_t)p/2);
+        assert(result == block && grow.capacity == (size_t)p+10);
+        md_grow_destroy(&grow);
+        assert(grow.array == NULL);
+    }
+    /* one row at a time */
+    dims8d[0] = 0; dims8d[1] = 64;
+    md_grow_create(&grow, 2, dims8d, 1, sizeof(test_data_type));
+    for(i=0, k=0; i<100000; i++){
+        mark = grow.capacity;
+        md_grow_append(&grow, NULL, 1);
+        ((test_data_type**)grow.array)[i][63] = (test_data_type)i;
+        k += grow.capacity != mark; /* number of times the array was moved */
+    }
+    assert(k <= 17); /* log2(100000) */
+    for(i=0; i<100000; i++)
+        assert(((test_data_type**)grow.array)[i][63] == (test_data_type)i);
+    md_grow_destroy(&grow);
+    difference = clock() - before;
+    msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
+
+    /*********************************************************************************************************/
+    printf("********** Recycling Cache Test - RANDOM 2D/3D DATA **********\n");
     before = clock();
+    md_cache_set_limit(64<<20);
+    recycled = NULL;
+    for(iter=0; iter<1000; iter++){
+        /* same shape each time: the block comes back with its tables intact */
+        array2d_dynamic = (test_data_type**)malloc2d(MAX_DIMENSION_LENGTH-10, MAX_DIMENSION_LENGTH, sizeof(test_data_type));
+        assert(recycled == NULL || (void*)array2d_dynamic == recycled);
+        recycled = (void*)array2d_dynamic;
+        for(i=0; i<MAX_DIMENSION_LENGTH-10; i++)
+            for(j=0; j<MAX_DIMENSION_LENGTH; j++)
+                assert(&array2d_dynamic[i][j] == FLATTEN2D(array2d_dynamic) + i*MAX_DIMENSION_LENGTH + j);
+        array2d_dynamic[iter%(MAX_DIMENSION_LENGTH-10)][iter%MAX_DIMENSION_LENGTH] = 1.0f;
+        md_free(array2d_dynamic);
+
+        /* random shapes, some recycled, some calloc'd (which must be zeroed again) */
+        dim1 = 1+rand()%4;
+        dim2 = 1+rand()%4;
+        dim3 = 1+rand()%4;
+        array3d_dynamic = (test_data_type***)calloc3d(dim1, dim2, dim3, sizeof(test_data_type));
+        for(i=0; i<dim1; i++)
+            for(j=0; j<dim2; j++)
+                for(k=0; k<dim3; k++){
+                    assert(array3d_dynamic[i][j][k] == 0.0f);
+                    assert(&array3d_dynamic[i][j][k] == FLATTEN3D(array3d_dynamic) + (i*dim2+j)*dim3 + k);
+                    array3d_dynamic[i][j][k] = 2.0f;
+                }
+        if(iter%3==0){
+            /* reallocated arrays are tracked under their new shape */
+            array3d_dynamic = (test_data_type***)realloc3d((void***)array3d_dynamic, dim3, dim2, dim1, sizeof(test_data_type));
+            for(i=0; i<dim3; i++)
+                for(j=0; j<dim2; j++)
+                    for(k=0; k<dim1; k++)
+                        assert(&array3d_dynamic[i][j][k] == FLATTEN3D(array3d_dynamic) + (i*dim2+j)*dim1 + k);
+        }
+        md_free(array3d_dynamic);
+    }
+    n = md_cache_info(&hits, &misses);
+    assert(n <= (size_t)(64<<20));
+    assert(hits+misses == 2*(size_t)iter && hits >= (size_t)iter-1);
+    /* a limit smaller than one array means nothing is kept */
+    n = md_cache_trim(0);
+    assert(n > 0 && md_cache_info(NULL, NULL) == 0);
+    md_cache_set_limit(16);
+    array2d_dynamic = (test_data_type**)malloc2d(10, 10, sizeof(test_data_type));
+    md_free(array2d_dynamic);
+    assert(md_cache_info(NULL, NULL) == 0);
+    /* only recyclable arrays (those from the cache) are recycled; not e.g. a malloc1d() block of the same size */
+    md_cache_set_limit(64<<20);
+    dims8d[0] = dims8d[1] = 10;
     for(iter=0; iter<100; iter++){
-        test_data_type (*array3d_dynamic)[dim2][dim3] = malloc(sizeof(test_data_type[dim1][dim2][dim3]));
-        /* populate array */
+        recycled = malloc1d(md_sizeof(2, dims8d, sizeof(test_data_type), NULL));
+        md_free(recycled);
+        assert(md_cache_info(NULL, NULL) == 0);
+        array2d_dynamic = (test_data_type**)realloc2d(NULL, 10, 10, sizeof(test_data_type)); /* (not recyclable either) */
+        md_free(array2d_dynamic);
+        assert(md_cache_info(NULL, NULL) == 0);
+    }
+    md_cache_set_limit(0);
+    difference = clock() - before;
+    msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
+
+    /*********************************************************************************************************/
+    printf("********** Thread Cache Test - RANDOM 2D/3D DATA **********\n");
+    before = clock();
+    md_tcache_set_limit(8<<20);
+    recycled = NULL;
+    for(iter=0; iter<1000; iter++){
+        /* same as the global cache, for a single thread */
+        array2d_dynamic = (test_data_type**)malloc2d(MAX_DIMENSION_LENGTH-10, MAX_DIMENSION_LENGTH, sizeof(test_data_type));
+#ifdef MD_MALLOC_HAVE_THREAD_CACHE
+        assert(recycled == NULL || (void*)array2d_dynamic == recycled);
+#endif
+        recycled = (void*)array2d_dynamic;
+        array2d_dynamic[iter%(MAX_DIMENSION_LENGTH-10)][iter%MAX_DIMENSION_LENGTH] = 1.0f;
+        md_free(array2d_dynamic);
+    }
+    /* arrays freed by other threads go back to the cache of the thread that allocated them */
+    {
+        void* shared[64];
+#ifdef _OPENMP
+        #pragma omp parallel for
+#endif
+        for(i=0; i<64; i++){
+            test_data_type*** a = (test_data_type***)calloc3d(1+i%4, 5, 6, sizeof(test_data_type));
+            assert(a[i%4][4][5] == 0.0f);
+            a[i%4][4][5] = (test_data_type)i;
+            shared[i] = (void*)a;
+        }
+#ifdef _OPENMP
+        #pragma omp parallel for schedule(static, 1)
+#endif
+        for(i=0; i<64; i++){
+            test_data_type*** a = (test_data_type***)shared[63-i];
+            assert(a[(63-i)%4][4][5] == (test_data_type)(63-i));
+            md_free(a);
+        }
+#ifdef _OPENMP
+        #pragma omp parallel for
+#endif
+        for(i=0; i<64; i++){
+            test_data_type*** a = (test_data_type***)calloc3d(1+i%4, 5, 6, sizeof(test_data_type));
+            assert(a[i%4][4][5] == 0.0f); /* (re-zeroed, if recycled) */
+            md_free(a);
+        }
+    }
+#ifdef MD_MALLOC_HAVE_THREAD_CACHE
+    n = md_tcache_info(&hits, &misses);
+    assert(n > 0);
+    assert(hits+misses == (size_t)iter+128 && hits >= (size_t)iter-1);
+    /* reallocated arrays stay with their owner, under their new shape */
+    n = md_tcache_info(NULL, NULL);
+    array3d_dynamic = (test_data_type***)calloc3d(4, 3, 2, sizeof(test_data_type));
+    array3d_dynamic = (test_data_type***)realloc3d_preserve((void***)array3d_dynamic, 4, 3, 2, 7, 3, 2, sizeof(test_data_type));
+    recycled = (void*)array3d_dynamic;
+    md_free(array3d_dynamic);
+    dims8d[0] = 7; dims8d[1] = 3; dims8d[2] = 2;
+    assert(md_tcache_info(NULL, NULL) == n + md_sizeof(3, dims8d, sizeof(test_data_type), NULL));
+    array3d_dynamic = (test_data_type***)malloc3d(7, 3, 2, sizeof(test_data_type));
+    assert((void*)array3d_dynamic == recycled && &array3d_dynamic[6][2][1] == FLATTEN3D(array3d_dynamic) + 7*3*2 - 1);
+    md_free(array3d_dynamic);
+    /* and unregistered blocks never enter them */
+    recycled = malloc1d(md_sizeof(3, dims8d, sizeof(test_data_type), NULL));
+    md_free(recycled);
+    assert(md_tcache_info(NULL, NULL) == n + md_sizeof(3, dims8d, sizeof(test_data_type), NULL));
+#endif
+    md_tcache_set_limit(0);
+    n = md_tcache_info(&hits, &misses);
+    assert(n == 0 && hits == 0 && misses == 0);
+    difference = clock() - before;
+    msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
+
+    /*********************************************************************************************************/
+    printf("********** Huge Page Malloc Test - LARGE 3D DATA **********\n");
+    before = clock();
+    for(iter=0; iter<4; iter++){
+        dim1 = MAX_DIMENSION_LENGTH-rand()%100;
+        dim2 = MAX_DIMENSION_LENGTH;
+        dim3 = MAX_DIMENSION_LENGTH-rand()%100;
+        array3d_dynamic = (test_data_type***)calloc3d_huge(dim1, dim2, dim3, sizeof(test_data_type));
+        assert(array3d_dynamic != NULL);
+        for(i=0; i<dim1; i++)
+            for(j=0; j<dim2; j++)
+                for(k=0; k<dim3; k++){
+                    assert(array3d_dynamic[i][j][k] == 0.0f); /* zero'd by the OS (or calloc) */
+                    assert(&array3d_dynamic[i][j][k] == FLATTEN3D(array3d_dynamic) + (i*dim2+j)*dim3 + k);
+                    array3d_dynamic[i][j][k] = (test_data_type)(i+j+k);
+                }
+        /* may be resized like any other md array (moving it off the mapping) */
+        array3d_dynamic = (test_data_type***)realloc3d_preserve((void***)array3d_dynamic, dim1, dim2, dim3, dim1, dim2, dim3+1, sizeof(test_data_type));
+        for(i=0; i<dim1; i++)
+            for(j=0; j<dim2; j++)
+                for(k=0; k<dim3; k++)
+                    assert(array3d_dynamic[i][j][k] == (test_data_type)(i+j+k));
+        md_free(array3d_dynamic);
+
+        /* or selected by size */
+        md_huge_set_threshold(MAX_DIMENSION_LENGTH*MAX_DIMENSION_LENGTH*sizeof(test_data_type));
+        array2d_dynamic = (test_data_type**)malloc2d(dim1, dim2, sizeof(test_data_type));
+        array3d_dynamic = (test_data_type***)malloc3d(dim1, dim2, dim3, sizeof(test_data_type));
+        md_huge_set_threshold(0);
+        memset(FLATTEN2D(array2d_dynamic), 0, dim1*dim2*sizeof(test_data_type));
+        memset(FLATTEN3D(array3d_dynamic), 0, dim1*dim2*dim3*sizeof(test_data_type));
+        assert(&array3d_dynamic[dim1-1][dim2-1][dim3-1] == FLATTEN3D(array3d_dynamic) + dim1*dim2*dim3 - 1);
+        /* arrays allocated internally are never mapped, so free() still applies to them */
+        md_huge_set_threshold(1);
+        array2d_dynamic2 = (test_data_type**)md_transpose2d(NULL, (void**)array2d_dynamic, dim1, dim2, sizeof(test_data_type));
+        md_huge_set_threshold(0);
+        assert(array2d_dynamic2[dim2-1][dim1-1] == 0.0f);
+        free(array2d_dynamic2);
+        free1d(array2d_dynamic);
+        free1d(array3d_dynamic);
+    }
+    difference = clock() - before;
+    msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
+
+    /*********************************************************************************************************/
+    printf("********** Mapped .npy File Test - RANDOM 3D DATA **********\n");
+    before = clock();
+    for(iter=0; iter<50; iter++){
+        dim1 = 1+rand()%40;
+        dim2 = 1+rand()%40;
+        dim3 = 1+rand()%100;
+        array3d_dynamic = (test_data_type***)malloc3d(dim1, dim2, dim3, sizeof(test_data_type));
         for(i=0; i<dim1; i++)
             for(j=0; j<dim2; j++)
                 for(k=0; k<dim3; k++)
-                    array3d_dynamic[i][j][k] = rand();
+                    array3d_dynamic[i][j][k] = (test_data_type)rand()/(test_data_type)RAND_MAX;
+        dims8d[0] = dim1; dims8d[1] = dim2; dims8d[2] = dim3;
+        status = md_save_npy("md_malloc_test.npy", array3d_dynamic, 3, dims8d, "<f4");
+        assert(status == 0);
+
+        /* read-only: same shape and values */
+        mapped3d = (test_data_type***)md_mmap3d("md_malloc_test.npy", MD_MMAP_READONLY, &dims8d[3], &dims8d[4], &dims8d[5], &data_size);
+        assert(mapped3d != NULL && data_size == sizeof(test_data_type));
+        assert(dims8d[3] == (size_t)dim1 && dims8d[4] == (size_t)dim2 && dims8d[5] == (size_t)dim3);
+        assert(((size_t)FLATTEN3D(mapped3d) % 64) == 0);
+        for(i=0; i<dim1; i++)
+            for(j=0; j<dim2; j++)
+                for(k=0; k<dim3; k++)
+                    assert(mapped3d[i][j][k] == array3d_dynamic[i][j][k]);
+        result = md_mmap2d("md_malloc_test.npy", MD_MMAP_READONLY, &dims8d[3], &dims8d[4], &data_size);
+        assert(result == NULL); /* wrong rank */
+        md_free(mapped3d);
+
+        /* read-write: changes end up in the file */
+        mapped3d = (test_data_type***)md_mmapNd("md_malloc_test.npy", MD_MMAP_READWRITE, 3, &dims8d[3], &data_size);
+        assert(mapped3d != NULL);
+        mapped3d[dim1-1][dim2-1][dim3-1] = -1.0f;
+        md_free(mapped3d);
+        mapped3d = (test_data_type***)md_mmapNd("md_malloc_test.npy", MD_MMAP_READONLY, 3, &dims8d[3], &data_size);
+        assert(mapped3d != NULL && mapped3d[dim1-1][dim2-1][dim3-1] == -1.0f);
+        assert(memcmp(FLATTEN3D(mapped3d), FLATTEN3D(array3d_dynamic), (dim1*dim2*dim3-1)*sizeof(test_data_type)) == 0);
+        free1d(mapped3d);
+
+        /* the characters of NumPy unicode strings are 4 bytes each */
+        status = md_save_npy("md_malloc_test.npy", array3d_dynamic, 3, dims8d, "<U1");
+        assert(status == 0);
+        mapped3d = (test_data_type***)md_mmap3d("md_malloc_test.npy", MD_MMAP_READONLY, &dims8d[3], &dims8d[4], &dims8d[5], &data_size);
+        assert(mapped3d != NULL && data_size == 4);
+        md_free(mapped3d);
+        status = md_save_npy("md_malloc_test.npy", array3d_dynamic, 3, dims8d, "<M8[ns]"); /* unsupported */
+        assert(status != 0);
         free(array3d_dynamic);
     }
+    /* shapes whose sizes overflow a size_t (e.g. from a corrupt or malicious
+     * file) are rejected, rather than mapped with undersized pointer tables */
+    array3d_dynamic = (test_data_type***)malloc3d(1, 1, 1, sizeof(test_data_type));
+    for(i=0; i<2; i++){
+        dims8d[0] = i==0 ? (size_t)1<<(8*sizeof(size_t)-2) : 1;
+        dims8d[1] = i==0 ? 0 : (size_t)1<<(8*sizeof(size_t)-2);
+        dims8d[2] = 4;
+        status = md_save_npy("md_malloc_test.npy", array3d_dynamic, 3, dims8d, "<f4"); /* (header only) */
+        assert(status == 0);
+        mapped3d = (test_data_type***)md_mmap3d("md_malloc_test.npy", MD_MMAP_READONLY, &dims8d[3], &dims8d[4], &dims8d[5], &data_size);
+        assert(mapped3d == NULL);
+    }
+    free(array3d_dynamic);
+    remove("md_malloc_test.npy");
     difference = clock() - before;
-    msec3 = difference * 1000.0f / (float)CLOCKS_PER_SEC;
-    printf(" - C99-style malloc time taken %d seconds %d milliseconds\n", msec3/1000, msec3%1000);
-#endif
-    
-    if(msec2>msec)
-        printf("md_malloc was %d seconds %d milliseconds SLOWER than Mangled array\n", (msec2-msec)/1000, (msec2-msec)%1000);
-    else
-        printf("md_malloc was %d seconds %d milliseconds FASTER than Mangled array\n", (msec-msec2)/1000, (msec-msec2)%1000);
-#ifdef ENABLE_C99_SPEED_TESTS
-    if(msec2>msec3)
-        printf("md_malloc was %d seconds %d milliseconds SLOWER than C99-style array\n", (msec2-msec3)/1000, (msec2-msec3)%1000);
-    else
-        printf("md_malloc was %d seconds %d milliseconds FASTER than C99-style array\n", (msec3-msec2)/1000, (msec3-msec2)%1000);
+    msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
+
+    /*********************************************************************************************************/
+    printf("********** NUMA Placement Test - LARGE 3D DATA **********\n");
+    before = clock();
+    for(iter=0; iter<4; iter++){
+        dim1 = 64+rand()%64;
+        dim2 = MAX_DIMENSION_LENGTH;
+        dim3 = 1+rand()%MAX_DIMENSION_LENGTH;
+        array3d_dynamic = (test_data_type***)calloc3d_numa(dim1, dim2, dim3, sizeof(test_data_type), iter%2==0 ? MD_NUMA_BLOCK : MD_NUMA_INTERLEAVE);
+        assert(array3d_dynamic != NULL);
+        for(i=0; i<dim1; i++){
+            for(j=0; j<dim2; j++)
+                for(k=0; k<dim3; k++){
+                    assert(array3d_dynamic[i][j][k] == 0.0f);
+                    assert(&array3d_dynamic[i][j][k] == FLATTEN3D(array3d_dynamic) + (i*dim2+j)*dim3 + k);
+                }
+#ifdef MD_MALLOC_ENABLE_NUMA
+            assert(md_numa_node(array3d_dynamic[i][0]) >= 0); /* (already touched) */
 #endif
-    printf("\n");
-    
+        }
+        md_free(array3d_dynamic);
+    }
+    difference = clock() - before;
+    msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
+
     return 0;
 }
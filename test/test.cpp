@@ -0,0 +1,227 @@
+/*
+ Copyright (c) 2019 Leo McCormack
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <cstring>
+#include <ctime>
+#include <utility>
+
+/* include md_malloc (C++ wrappers) like so: */
+#define MD_MALLOC_ENABLE
+#include "../md_malloc.hpp"
+
+/* TEST CONFIGURATION */
+#define MAX_DIMENSION_LENGTH 300
+typedef float test_data_type;
+
+static md_array<test_data_type, 3> make_ramp3d(std::size_t dim1, std::size_t dim2, std::size_t dim3)
+{
+    md_array<test_data_type, 3> a(dim1, dim2, dim3);
+    for(std::size_t i=0; i<dim1; i++)
+        for(std::size_t j=0; j<dim2; j++)
+            for(std::size_t k=0; k<dim3; k++)
+                a[i][j][k] = (test_data_type)((i*dim2+j)*dim3+k);
+    return a; /* moved out, not copied */
+}
+
+int main(int argc, const char * argv[])
+{
+    int iter;
+    std::size_t i, j, k, dim1, dim2, dim3;
+    clock_t before, difference;
+    int msec, msec2, msec3;
+    test_data_type* mangled_array3d_dynamic;
+    double sum, sum2, sum3;
+    test_data_type acc[MAX_DIMENSION_LENGTH];
+    (void)argc; (void)argv;
+
+    /*********************************************************************************************************/
+    printf("********** md_array Test - RANDOM 1D/2D/3D DATA **********\n");
+    before = clock();
+    for(iter=0; iter<200; iter++){
+        dim1 = 1+rand()%MAX_DIMENSION_LENGTH;
+        dim2 = 1+rand()%MAX_DIMENSION_LENGTH;
+        dim3 = 1+rand()%10;
+
+        /* construction, indexing and the raw pointers agree with the C API */
+        md_array<test_data_type, 3> a = make_ramp3d(dim1, dim2, dim3);
+        assert(a.rank() == 3 && a.size() == dim1*dim2*dim3);
+        assert(a.extent(0) == dim1 && a.extent(1) == dim2 && a.extent(2) == dim3);
+        test_data_type*** raw = a.get();
+        assert(a.data() == FLATTEN3D(raw));
+        for(i=0; i<dim1*dim2*dim3; i++)
+            assert(a.data()[i] == (test_data_type)i);
+        assert(&a[dim1-1][dim2-1][dim3-1] == &raw[dim1-1][dim2-1][dim3-1]);
+
+        /* moves transfer ownership; clones are deep copies */
+        md_array<test_data_type, 3> b(std::move(a));
+        assert(a.empty() && !b.empty() && b.get() == raw);
+        md_array<test_data_type, 3> c = b.clone();
+        assert(c.get() != b.get() && std::memcmp(c.data(), b.data(), b.size()*sizeof(test_data_type)) == 0);
+        c[0][0][0] = -1.0f;
+        assert(b[0][0][0] == 0.0f);
+        a = std::move(c);
+        assert(c.empty() && a[0][0][0] == -1.0f);
+
+        /* zeros, resize (keeping the common elements in place), and views */
+        md_array<test_data_type, 2> z = md_array<test_data_type, 2>::zeros(dim1, dim2);
+        for(test_data_type* p = z.begin(); p != z.end(); p++)
+            assert(*p == 0.0f);
+        z[dim1-1][dim2-1] = 1.0f;
+        z.resize(dim1+1, dim2);
+        assert(z[dim1-1][dim2-1] == 1.0f && z.extent(0) == dim1+1);
+        md_view v = b.view();
+        assert(v.ndims == 3 && MD_VIEW_AT3D(test_data_type, &v, dim1-1, dim2-1, dim3-1) == b[dim1-1][dim2-1][dim3-1]);
+        md_array<double, 1> d(dim1);
+        d[dim1-1] = 1.0;
+        assert(d.data() == d.get() && d.size() == dim1);
+
+        /* adopting arrays from the C API */
+        std::size_t dims[2] = {dim2, dim3};
+        md_array<test_data_type, 2> e = md_array<test_data_type, 2>::adopt((test_data_type**)calloc2d(dim2, dim3, sizeof(test_data_type)), dims);
+        assert(e[dim2-1][dim3-1] == 0.0f);
+        test_data_type** released = e.release();
+        assert(e.empty());
+        md_free(released);
+    }
+    difference = clock() - before;
+    msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
+
+    /*********************************************************************************************************/
+    printf("********** md_fixed_array Test - RANDOM 3D DATA **********\n");
+    before = clock();
+    for(iter=0; iter<200; iter++){
+        dim1 = 1+rand()%MAX_DIMENSION_LENGTH;
+
+        /* same memory layout as a mangled array; no pointer tables */
+        md_fixed_array<test_data_type, md_dynamic, 64, 4> a(dim1);
+        assert(a.rank() == 3 && a.row_size() == 64*4 && a.size() == dim1*64*4);
+        assert(a.extent(0) == dim1 && a.extent(1) == 64 && a.extent(2) == 4);
+        for(i=0; i<dim1; i++)
+            for(j=0; j<64; j++)
+                for(k=0; k<4; k++)
+                    a[i][j][k] = (test_data_type)((i*64+j)*4+k);
+        for(i=0; i<a.size(); i++)
+            assert(a.data()[i] == (test_data_type)i);
+        assert(&a.get()[dim1-1][63][3] == &a.data()[dim1*64*4-1]);
+
+        /* moves, clones, resizing the outermost extent, and views */
+        md_fixed_array<test_data_type, md_dynamic, 64, 4> b = a.clone();
+        assert(std::memcmp(a.data(), b.data(), a.size()*sizeof(test_data_type)) == 0);
+        md_fixed_array<test_data_type, md_dynamic, 64, 4> c(std::move(a));
+        assert(a.empty() && a.size() == 0 && c.size() == b.size());
+        c.resize(dim1+10);
+        assert(c.extent(0) == dim1+10 && c[dim1-1][63][3] == b[dim1-1][63][3]);
+        md_view v = b.view();
+        assert(v.ndims == 3 && &MD_VIEW_AT3D(test_data_type, &v, dim1-1, 5, 2) == &b[dim1-1][5][2]);
+        md_fixed_array<double, md_dynamic, 3> z = md_fixed_array<double, md_dynamic, 3>::zeros(dim1);
+        for(double* p = z.begin(); p != z.end(); p++)
+            assert(*p == 0.0);
+    }
+    difference = clock() - before;
+    msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf("PASSED! - Time taken %d seconds %d milliseconds\n\n", msec/1000, msec%1000);
+
+    /*********************************************************************************************************/
+    /* md_fixed_array indexing, with the inner extents known at compile time, should be on par with (or faster
+     * than) mangled indexing; whereas md_array goes through its pointer tables for every row of 4 */
+    printf("********** Indexing Speed Test - 3D DATA **********\n");
+    dim1 = MAX_DIMENSION_LENGTH-10;
+    dim2 = 64;
+    dim3 = 4;
+    before = clock();
+    memset(acc, 0, sizeof(acc));
+    for(iter=0; iter<3000; iter++){
+        mangled_array3d_dynamic = (test_data_type*)malloc(dim1*dim2*dim3*sizeof(test_data_type));
+        /* populate array, and then sum over its first two dimensions */
+        for(i=0; i<dim1; i++)
+            for(j=0; j<dim2; j++)
+                for(k=0; k<dim3; k++)
+                    mangled_array3d_dynamic[i*dim2*dim3 +j*dim3 +k] = (test_data_type)(i+j+k+iter);
+        for(i=0; i<dim1; i++)
+            for(j=0; j<dim2; j++)
+                for(k=0; k<dim3; k++)
+                    acc[k] += mangled_array3d_dynamic[i*dim2*dim3 +j*dim3 +k];
+        free(mangled_array3d_dynamic);
+    }
+    for(k=0, sum=0.0; k<dim3; k++)
+        sum += acc[k];
+    difference = clock() - before;
+    msec = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf(" - Mangled array time taken %d seconds %d milliseconds\n", msec/1000, msec%1000);
+
+    before = clock();
+    memset(acc, 0, sizeof(acc));
+    for(iter=0; iter<3000; iter++){
+        md_array<test_data_type, 3> array3d(dim1, dim2, dim3);
+        /* populate array, and then sum over its first two dimensions */
+        for(i=0; i<dim1; i++)
+            for(j=0; j<dim2; j++)
+                for(k=0; k<dim3; k++)
+                    array3d[i][j][k] = (test_data_type)(i+j+k+iter);
+        for(i=0; i<dim1; i++)
+            for(j=0; j<dim2; j++)
+                for(k=0; k<dim3; k++)
+                    acc[k] += array3d[i][j][k];
+    }
+    for(k=0, sum2=0.0; k<dim3; k++)
+        sum2 += acc[k];
+    difference = clock() - before;
+    msec2 = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf(" - md_array time taken %d seconds %d milliseconds\n", msec2/1000, msec2%1000);
+
+    before = clock();
+    memset(acc, 0, sizeof(acc));
+    for(iter=0; iter<3000; iter++){
+        md_fixed_array<test_data_type, md_dynamic, 64, 4> array3d(dim1);
+        /* populate array, and then sum over its first two dimensions */
+        for(i=0; i<dim1; i++)
+            for(j=0; j<dim2; j++)
+                for(k=0; k<dim3; k++)
+                    array3d[i][j][k] = (test_data_type)(i+j+k+iter);
+        for(i=0; i<dim1; i++)
+            for(j=0; j<dim2; j++)
+                for(k=0; k<dim3; k++)
+                    acc[k] += array3d[i][j][k];
+    }
+    for(k=0, sum3=0.0; k<dim3; k++)
+        sum3 += acc[k];
+    difference = clock() - before;
+    msec3 = difference * 1000.0f / (float)CLOCKS_PER_SEC;
+    printf(" - md_fixed_array time taken %d seconds %d milliseconds\n", msec3/1000, msec3%1000);
+    assert(sum == sum2 && sum == sum3);
+
+    if(msec3>msec)
+        printf("md_fixed_array was %d seconds %d milliseconds SLOWER than Mangled array\n", (msec3-msec)/1000, (msec3-msec)%1000);
+    else
+        printf("md_fixed_array was %d seconds %d milliseconds FASTER than Mangled array\n", (msec-msec3)/1000, (msec-msec3)%1000);
+    if(msec3>msec2)
+        printf("md_fixed_array was %d seconds %d milliseconds SLOWER than md_array\n", (msec3-msec2)/1000, (msec3-msec2)%1000);
+    else
+        printf("md_fixed_array was %d seconds %d milliseconds FASTER than md_array\n", (msec2-msec3)/1000, (msec2-msec3)%1000);
+    printf("\n");
+
+    return 0;
+}